@@ -0,0 +1,125 @@
+# Builds decode-gen with atomic and non atomic reference counting and compares
+# generation time of the same project
+#
+# cmake -DPROJECT=<project.toml> [-DBUILD_DIR=<dir>] [-DRUNS=<n>] [-DJOBS=<n>] -P cmake/BenchmarkRc.cmake
+#
+# every build is run once before measuring so that both builds skip unchanged files equally
+
+if(NOT PROJECT)
+    message(FATAL_ERROR "PROJECT must point to project file")
+endif()
+get_filename_component(PROJECT "${PROJECT}" ABSOLUTE)
+if(NOT SOURCE_DIR)
+    get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+endif()
+if(NOT BUILD_DIR)
+    set(BUILD_DIR "${CMAKE_CURRENT_BINARY_DIR}/benchmark-rc")
+endif()
+if(NOT RUNS)
+    set(RUNS 5)
+endif()
+if(NOT JOBS)
+    set(JOBS 1)
+endif()
+if(NOT BUILD_TYPE)
+    set(BUILD_TYPE Release)
+endif()
+if(CMAKE_HOST_WIN32)
+    set(EXE_SUFFIX ".exe")
+endif()
+
+set(RC_POLICIES atomic non_atomic)
+
+foreach(RC_POLICY ${RC_POLICIES})
+    if(RC_POLICY STREQUAL "atomic")
+        set(ATOMIC_RC ON)
+    else()
+        set(ATOMIC_RC OFF)
+    endif()
+    set(DIR "${BUILD_DIR}/${RC_POLICY}")
+    file(MAKE_DIRECTORY "${DIR}")
+    message(STATUS "Building decode-gen with DECODE_ATOMIC_RC=${ATOMIC_RC}")
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} "${SOURCE_DIR}" -DCMAKE_BUILD_TYPE=${BUILD_TYPE} -DDECODE_ATOMIC_RC=${ATOMIC_RC}
+        WORKING_DIRECTORY "${DIR}"
+        RESULT_VARIABLE RV
+        OUTPUT_QUIET
+    )
+    if(NOT RV EQUAL 0)
+        message(FATAL_ERROR "Configuring ${RC_POLICY} build failed")
+    endif()
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} --build . --target decode-gen --config ${BUILD_TYPE}
+        WORKING_DIRECTORY "${DIR}"
+        RESULT_VARIABLE RV
+        OUTPUT_QUIET
+    )
+    if(NOT RV EQUAL 0)
+        message(FATAL_ERROR "Building ${RC_POLICY} decode-gen failed")
+    endif()
+    file(GLOB_RECURSE EXE "${DIR}/decode-gen${EXE_SUFFIX}")
+    if(NOT EXE)
+        message(FATAL_ERROR "decode-gen executable not found in ${DIR}")
+    endif()
+    list(GET EXE 0 EXE)
+    set(EXE_${RC_POLICY} "${EXE}")
+    set(TIMES_${RC_POLICY})
+endforeach()
+
+# returns generation time in microseconds
+function(run_generator RC_POLICY DEST)
+    execute_process(
+        COMMAND "${EXE_${RC_POLICY}}" -p "${PROJECT}" -o "${BUILD_DIR}/${RC_POLICY}/out" -j ${JOBS}
+        RESULT_VARIABLE RV
+        OUTPUT_VARIABLE OUT
+        ERROR_VARIABLE OUT
+    )
+    if(NOT RV EQUAL 0)
+        message(FATAL_ERROR "decode-gen (${RC_POLICY}) failed:\n${OUT}")
+    endif()
+    string(REPLACE "_" " " TAG "${RC_POLICY}")
+    if(NOT OUT MATCHES "Generated[^\n]* in ([0-9]+)\\.([0-9][0-9][0-9][0-9][0-9][0-9])s \\(${TAG} rc\\)")
+        message(FATAL_ERROR "Generation time of ${TAG} rc build not found in output:\n${OUT}")
+    endif()
+    math(EXPR TIME "${CMAKE_MATCH_1} * 1000000 + 1${CMAKE_MATCH_2} - 1000000")
+    set(${DEST} ${TIME} PARENT_SCOPE)
+endfunction()
+
+foreach(RC_POLICY ${RC_POLICIES})
+    run_generator(${RC_POLICY} TIME)
+endforeach()
+
+# builds are interleaved so that both are equally affected by system load changes
+foreach(RUN RANGE 1 ${RUNS})
+    foreach(RC_POLICY ${RC_POLICIES})
+        run_generator(${RC_POLICY} TIME)
+        list(APPEND TIMES_${RC_POLICY} ${TIME})
+    endforeach()
+endforeach()
+
+message("")
+message("Generation time of ${PROJECT}, ${RUNS} runs, ${JOBS} jobs:")
+message("  policy        min (ms)   mean (ms)")
+foreach(RC_POLICY ${RC_POLICIES})
+    set(SUM 0)
+    list(GET TIMES_${RC_POLICY} 0 MIN)
+    foreach(TIME ${TIMES_${RC_POLICY}})
+        math(EXPR SUM "${SUM} + ${TIME}")
+        if(TIME LESS MIN)
+            set(MIN ${TIME})
+        endif()
+    endforeach()
+    math(EXPR MEAN "${SUM} / ${RUNS} / 1000")
+    math(EXPR MIN_MS "${MIN} / 1000")
+    set(MIN_${RC_POLICY} ${MIN})
+    string(REPLACE "_" " " TAG "${RC_POLICY}")
+    set(LINE "  ${TAG}                ")
+    string(SUBSTRING "${LINE}" 0 16 LINE)
+    set(MIN_COL "${MIN_MS}            ")
+    string(SUBSTRING "${MIN_COL}" 0 11 MIN_COL)
+    message("${LINE}${MIN_COL}${MEAN}")
+endforeach()
+if(MIN_atomic GREATER 0)
+    math(EXPR RATIO "${MIN_non_atomic} * 100 / ${MIN_atomic}")
+    message("  non atomic / atomic (min): ${RATIO}%")
+endif()
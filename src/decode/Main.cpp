@@ -9,17 +9,113 @@
 #include "decode/core/Diagnostics.h"
 #include "decode/core/Configuration.h"
 #include "decode/core/ProgressPrinter.h"
+#include "decode/core/Compression.h"
 #include "decode/parser/Project.h"
+#include "decode/parser/Package.h"
+#include "decode/parser/Lexer.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/ModuleInfo.h"
 #include "decode/generator/Generator.h"
 
+#include <bmcl/Buffer.h>
 #include <bmcl/Result.h>
 
 #include <tclap/CmdLine.h>
 
 #include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
 
 using namespace decode;
 
+static std::string toSeconds(std::chrono::steady_clock::duration delta)
+{
+    double microseconds = std::chrono::duration_cast<std::chrono::microseconds>(delta).count();
+    return std::to_string(microseconds / 1000000) + "s";
+}
+
+// compares ratio and speed of all codecs on serialized project
+static void benchmarkCompression(const Project* project, const Configuration* cfg)
+{
+    ProgressPrinter printer(true);
+    bmcl::Buffer data;
+    if (!project->encode(&data)) {
+        return;
+    }
+    printer.printActionProgress("Benchmarking", "compression of " + std::to_string(data.size()) + " bytes");
+
+    std::vector<std::pair<CompressionCodec, unsigned>> methods = {{CompressionCodec::Stored, 0}, {CompressionCodec::Fast, 0}};
+    for (unsigned level = 1; level <= 5; level++) {
+        methods.emplace_back(CompressionCodec::Zpaq, level);
+    }
+
+    for (const auto& method : methods) {
+        std::string name = compressionCodecName(method.first);
+        if (method.first == CompressionCodec::Zpaq) {
+            name += " level " + std::to_string(method.second);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        CompressionResult compressed = compressData(method.first, data.data(), data.size(), method.second, cfg->numJobs());
+        auto decompressionStart = std::chrono::steady_clock::now();
+        if (compressed.isErr()) {
+            printer.printActionProgress("Failed", name + " (" + compressed.unwrapErr() + ")");
+            continue;
+        }
+        CompressionResult decompressed = decompressData(compressed.unwrap().data(), compressed.unwrap().size(), cfg->numJobs());
+        auto end = std::chrono::steady_clock::now();
+        bool isValid = decompressed.isOk()
+                       && decompressed.unwrap().size() == data.size()
+                       && std::memcmp(decompressed.unwrap().data(), data.data(), data.size()) == 0;
+        if (!isValid) {
+            printer.printActionProgress("Failed", name + " (decompressed data does not match)");
+            continue;
+        }
+
+        double ratio = data.size() == 0 ? 1 : double(compressed.unwrap().size()) / data.size();
+        printer.printActionProgress("Compressed", "with " + name + " to " + std::to_string(compressed.unwrap().size()) + " bytes"
+                                    + " (ratio " + std::to_string(ratio) + ") in " + toSeconds(decompressionStart - start)
+                                    + ", decompressed in " + toSeconds(end - decompressionStart));
+    }
+}
+
+// compares throughput of lexer backends on project sources
+static void benchmarkLexer(const Project* project)
+{
+    ProgressPrinter printer(true);
+    std::vector<bmcl::StringView> sources;
+    std::size_t totalSize = 0;
+    for (const Ast* ast : project->package()->modules()) {
+        sources.push_back(ast->moduleInfo()->contents());
+        totalSize += sources.back().size();
+    }
+    printer.printActionProgress("Benchmarking", "lexing of " + std::to_string(sources.size()) + " modules (" + std::to_string(totalSize) + " bytes)");
+
+    constexpr std::size_t numIterations = 20;
+    std::vector<std::pair<LexerBackend, std::string>> backends = {{LexerBackend::Scanner, "scanner"}, {LexerBackend::Pegtl, "pegtl"}};
+    for (const auto& backend : backends) {
+        std::size_t numTokens = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < numIterations; i++) {
+            for (bmcl::StringView src : sources) {
+                Rc<Lexer> lexer = new Lexer(src, backend.first);
+                Token tok;
+                do {
+                    lexer->consumeNextToken(&tok);
+                    numTokens++;
+                } while (tok.kind() != TokenKind::Eof && tok.kind() != TokenKind::Invalid);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000000.0;
+        double throughput = seconds == 0 ? 0 : totalSize * numIterations / seconds / 1000000;
+        printer.printActionProgress("Lexed", "with " + backend.second + " " + std::to_string(numTokens / numIterations) + " tokens in "
+                                    + toSeconds((end - start) / numIterations) + " (" + std::to_string(throughput) + " MB/s)");
+    }
+}
+
 int main(int argc, char* argv[])
 {
     TCLAP::CmdLine cmdLine("Decode source generator");
@@ -28,7 +124,20 @@ int main(int argc, char* argv[])
     TCLAP::ValueArg<unsigned> debugLevelArg("d", "debug-level", "Generated code debug level", false, 0, "0-5");
     TCLAP::SwitchArg verbLevelArg("v", "verbose", "Enable verbose output", false);
     TCLAP::ValueArg<unsigned> compLevelArg("c", "compression-level", "Package compression level", false, 4, "0-5");
+    TCLAP::SwitchArg alwaysWriteArg("", "always-write", "Rewrite generated files even if their contents did not change", false);
     TCLAP::SwitchArg absArg("a", "abs-path", "Use absolute paths for bundled src", false);
+    TCLAP::ValueArg<unsigned> jobsArg("j", "jobs", "Number of files parsed in parallel", false, 1, "number");
+    TCLAP::SwitchArg pegtlArg("", "pegtl-lexer", "Use PEGTL grammar instead of table-driven lexer", false);
+    TCLAP::ValueArg<std::string> cacheDirArg("", "cache-dir", "Directory for parsed module cache", false, "", "path");
+    std::vector<std::string> encodings = {"sources", "indexed", "preparsed"};
+    TCLAP::ValuesConstraint<std::string> encodingConstraint(encodings);
+    std::vector<std::string> compressions = {"fast", "max", "none"};
+    TCLAP::ValuesConstraint<std::string> compressionConstraint(compressions);
+    TCLAP::ValueArg<std::string> compressionArg("", "compression", "Package compression, max uses zpaq with selected compression level", false, "max", &compressionConstraint);
+    TCLAP::ValueArg<std::string> deltaBaseArg("", "delta-base", "Previous Package.bin, delta against it is saved to Package.delta", false, "", "path");
+    TCLAP::SwitchArg benchArg("", "benchmark-compression", "Compare package compression methods instead of generating sources", false);
+    TCLAP::SwitchArg lexerBenchArg("", "benchmark-lexer", "Compare lexer backends on project sources instead of generating sources", false);
+    TCLAP::ValueArg<std::string> encodingArg("", "package-encoding", "Package encoding, indexed packages can be loaded partially, preparsed are loaded without parsing", false, "sources", &encodingConstraint);
 
     cmdLine.add(&inPathArg);
     cmdLine.add(&outPathArg);
@@ -36,6 +145,15 @@ int main(int argc, char* argv[])
     cmdLine.add(&verbLevelArg);
     cmdLine.add(&compLevelArg);
     cmdLine.add(&absArg);
+    cmdLine.add(&alwaysWriteArg);
+    cmdLine.add(&jobsArg);
+    cmdLine.add(&pegtlArg);
+    cmdLine.add(&cacheDirArg);
+    cmdLine.add(&encodingArg);
+    cmdLine.add(&compressionArg);
+    cmdLine.add(&benchArg);
+    cmdLine.add(&lexerBenchArg);
+    cmdLine.add(&deltaBaseArg);
     cmdLine.parse(argc, argv);
 
     auto start = std::chrono::steady_clock::now();
@@ -46,6 +164,23 @@ int main(int argc, char* argv[])
     unsigned compLevel = std::min(5u, compLevelArg.getValue());
     cfg->setCompressionLevel(compLevel);
     cfg->setVerboseOutput(verbLevelArg.getValue());
+    cfg->setNumJobs(std::max(1u, jobsArg.getValue()));
+    if (pegtlArg.getValue()) {
+        cfg->setLexerBackend(LexerBackend::Pegtl);
+    }
+    if (cacheDirArg.isSet()) {
+        cfg->setParseCacheDir(cacheDirArg.getValue());
+    }
+    if (encodingArg.getValue() == "indexed") {
+        cfg->setPackageEncoding(PackageEncoding::Indexed);
+    } else if (encodingArg.getValue() == "preparsed") {
+        cfg->setPackageEncoding(PackageEncoding::Preparsed);
+    }
+    if (compressionArg.getValue() == "fast") {
+        cfg->setCompressionCodec(CompressionCodec::Fast);
+    } else if (compressionArg.getValue() == "none") {
+        cfg->setCompressionCodec(CompressionCodec::Stored);
+    }
 
     Rc<Diagnostics> diag = new Diagnostics;
     ProjectResult proj = Project::fromFile(cfg.get(), diag.get(), inPathArg.getValue().c_str());
@@ -55,15 +190,31 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    if (benchArg.getValue() || lexerBenchArg.getValue()) {
+        if (lexerBenchArg.getValue()) {
+            benchmarkLexer(proj.unwrap().get());
+        }
+        if (benchArg.getValue()) {
+            benchmarkCompression(proj.unwrap().get(), cfg.get());
+        }
+        diag->printReports(&std::cout);
+        return 0;
+    }
+
     GeneratorConfig genCfg;
     genCfg.useAbsolutePathsForBundledSources = absArg.getValue();
+    genCfg.writeOnlyChangedFiles = !alwaysWriteArg.getValue();
+    if (deltaBaseArg.isSet()) {
+        genCfg.packageDeltaBase = deltaBaseArg.getValue();
+    }
+    auto genStart = std::chrono::steady_clock::now();
     proj.unwrap()->generate(outPathArg.getValue().c_str(), genCfg);
 
     auto end = std::chrono::steady_clock::now();
-    auto delta = end - start;
     ProgressPrinter printer(cfg->verboseOutput());
-    double microseconds = std::chrono::duration_cast<std::chrono::microseconds>(delta).count();
-    printer.printActionProgress("Finished", "in " + std::to_string(microseconds / 1000000) + "s");
+    // parsed by cmake/BenchmarkRc.cmake to compare builds with and without DECODE_ATOMIC_RC, keep format in sync
+    printer.printActionProgress("Generated", std::string("in ") + toSeconds(end - genStart) + (isRcThreadSafe ? " (atomic rc)" : " (non atomic rc)"));
+    printer.printActionProgress("Finished", "in " + toSeconds(end - start));
 
     diag->printReports(&std::cout);
 }
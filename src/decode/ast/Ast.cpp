@@ -45,6 +45,11 @@ Ast::Types::ConstRange Ast::typesRange() const
     return _types;
 }
 
+Ast::Types::Range Ast::typesRange()
+{
+    return _types;
+}
+
 Ast::NamedTypes::ConstIterator Ast::namedTypesBegin() const
 {
     return _typeNameToType.cbegin();
@@ -110,11 +115,21 @@ Ast::GenericInstantiations::Range Ast::genericInstantiationsRange()
     return _genericInstantiations;
 }
 
+Ast::ImplBlocks::ConstRange Ast::implBlocksRange() const
+{
+    return _typeToImplBlock;
+}
+
 const ModuleInfo* Ast::moduleInfo() const
 {
     return _moduleInfo.get();
 }
 
+const ModuleDecl* Ast::moduleDecl() const
+{
+    return _moduleDecl.get();
+}
+
 bmcl::StringView Ast::moduleName() const
 {
     return _moduleInfo->moduleName();
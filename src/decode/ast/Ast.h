@@ -40,11 +40,11 @@ public:
     using Pointer = Rc<Ast>;
     using ConstPointer = Rc<const Ast>;
     using Types = RcVec<Type>;
-    using NamedTypes = RcSecondUnorderedMap<bmcl::StringView, NamedType>;
+    using NamedTypes = RcSecondOrderedMap<bmcl::StringView, NamedType>;
     using GenericInstantiations = RcVec<GenericInstantiationType>;
-    using Constants = RcSecondUnorderedMap<bmcl::StringView, Constant>;
+    using Constants = RcSecondOrderedMap<bmcl::StringView, Constant>;
     using Imports = RcVec<ImportDecl>;
-    using ImplBlocks = RcSecondUnorderedMap<Rc<Type>, ImplBlock>;
+    using ImplBlocks = RcSecondOrderedMap<Rc<Type>, ImplBlock>;
 
     Ast(AllBuiltinTypes* builtinTypes);
     ~Ast();
@@ -52,6 +52,7 @@ public:
     Types::ConstIterator typesBegin() const;
     Types::ConstIterator typesEnd() const;
     Types::ConstRange typesRange() const;
+    Types::Range typesRange();
     NamedTypes::ConstIterator namedTypesBegin() const;
     NamedTypes::ConstIterator namedTypesEnd() const;
     NamedTypes::ConstRange namedTypesRange() const;
@@ -64,10 +65,12 @@ public:
     Constants::ConstRange constantsRange() const;
     GenericInstantiations::ConstRange genericInstantiationsRange() const;
     GenericInstantiations::Range genericInstantiationsRange();
+    ImplBlocks::ConstRange implBlocksRange() const;
 
     bool hasConstants() const;
     const std::string& fileName() const;
     const ModuleInfo* moduleInfo() const;
+    const ModuleDecl* moduleDecl() const;
     bmcl::StringView moduleName() const;
     bmcl::OptionPtr<const Component> component() const;
     bmcl::OptionPtr<Component> component();
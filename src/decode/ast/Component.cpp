@@ -15,6 +15,7 @@
 #include "decode/ast/Decl.h"
 #include "decode/ast/Type.h"
 #include "decode/ast/Function.h"
+#include "decode/ast/WireLayout.h"
 
 #include <bmcl/OptionPtr.h>
 
@@ -354,6 +355,16 @@ bool TmMsg::isEnabled() const
     return _isEnabled;
 }
 
+const WireLayout* TmMsg::wireLayout() const
+{
+    return _wireLayout.get();
+}
+
+void TmMsg::setWireLayout(const WireLayout* layout)
+{
+    _wireLayout = layout;
+}
+
 
 StatusMsg::StatusMsg(bmcl::StringView name, std::size_t number, std::size_t priority, bool isEnabled)
     : TmMsg(name, number, isEnabled)
@@ -567,6 +578,11 @@ Component::Events::ConstRange Component::eventsRange() const
     return _events;
 }
 
+Component::Events::Range Component::eventsRange()
+{
+    return _events;
+}
+
 Component::Statuses::Iterator Component::statusesBegin()
 {
     return _statuses.begin();
@@ -699,19 +715,19 @@ void Component::addCommand(Command* func)
 
 bool Component::addStatus(StatusMsg* msg)
 {
-    auto it = _statuses.emplace(std::piecewise_construct, std::forward_as_tuple(msg->name()), std::forward_as_tuple(msg));
+    auto it = _statuses.emplace(msg->name(), msg);
     return it.second;
 }
 
 bool Component::addEvent(EventMsg* msg)
 {
-    auto it = _events.emplace(std::piecewise_construct, std::forward_as_tuple(msg->name()), std::forward_as_tuple(msg));
+    auto it = _events.emplace(msg->name(), msg);
     return it.second;
 }
 
 bool Component::addParam(Parameter* param)
 {
-    auto it = _params.emplace(std::piecewise_construct, std::forward_as_tuple(param->name()), std::forward_as_tuple(param));
+    auto it = _params.emplace(param->name(), param);
     return it.second;
 }
 
@@ -10,6 +10,7 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Arena.h"
 #include "decode/core/NamedRc.h"
 #include "decode/ast/DocBlockMixin.h"
 #include "decode/parser/Containers.h"
@@ -31,6 +32,7 @@ class ModuleInfo;
 class FieldAccessor;
 class SubscriptAccessor;
 class StringBuilder;
+class WireLayout;
 struct EncodedSizes;
 
 enum class AccessorKind {
@@ -38,7 +40,7 @@ enum class AccessorKind {
     Subscript,
 };
 
-class Accessor : public RefCountable {
+class Accessor : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<Accessor>;
     using ConstPointer = Rc<const Accessor>;
@@ -110,7 +112,7 @@ private:
     Rc<Type> _type;
 };
 
-class VarRegexp : public RefCountable {
+class VarRegexp : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<VarRegexp>;
     using ConstPointer = Rc<const VarRegexp>;
@@ -142,7 +144,7 @@ private:
 
 class BuiltinType;
 
-class Parameter : public RefCountable {
+class Parameter : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<Parameter>;
     using ConstPointer = Rc<const Parameter>;
@@ -184,7 +186,7 @@ private:
     bool _hasCallback;
 };
 
-class TmMsg : public RefCountable {
+class TmMsg : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<TmMsg>;
     using ConstPointer = Rc<const TmMsg>;
@@ -197,10 +199,14 @@ public:
     bool isEnabled() const;
     virtual EncodedSizes encodedSizes() const = 0;
 
+    const WireLayout* wireLayout() const;
+    void setWireLayout(const WireLayout* layout);
+
 private:
     bmcl::StringView _name;
     std::size_t _number;
     bool _isEnabled;
+    Rc<const WireLayout> _wireLayout;
 };
 
 class StatusMsg : public TmMsg {
@@ -251,9 +257,9 @@ public:
     using ConstPointer = Rc<const Component>;
     using Cmds = RcVec<Command>;
     using Vars = FieldVec;
-    using Statuses = RcSecondUnorderedMap<bmcl::StringView, StatusMsg>;
-    using Events = RcSecondUnorderedMap<bmcl::StringView, EventMsg>;
-    using Params = RcSecondUnorderedMap<bmcl::StringView, Parameter>;
+    using Statuses = RcSecondOrderedMap<bmcl::StringView, StatusMsg>;
+    using Events = RcSecondOrderedMap<bmcl::StringView, EventMsg>;
+    using Params = RcSecondOrderedMap<bmcl::StringView, Parameter>;
     using SavedVars = RcVec<VarRegexp>;
 
     Component(std::size_t compNum, const ModuleInfo* info);
@@ -285,6 +291,7 @@ public:
     Events::ConstIterator eventsBegin() const;
     Events::ConstIterator eventsEnd() const;
     Events::ConstRange eventsRange() const;
+    Events::Range eventsRange();
     Params::ConstIterator paramsBegin() const;
     Params::ConstIterator paramsEnd() const;
     Params::ConstRange paramsRange() const;
@@ -37,6 +37,16 @@ const ModuleInfo* Decl::moduleInfo() const
     return _moduleInfo.get();
 }
 
+Location Decl::startLocation() const
+{
+    return _start;
+}
+
+Location Decl::endLocation() const
+{
+    return _end;
+}
+
 void Decl::cloneDeclTo(Decl* dest)
 {
     dest->_start = _start;
@@ -10,6 +10,7 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Arena.h"
 #include "decode/core/Location.h"
 #include "decode/core/NamedRc.h"
 #include "decode/parser/Containers.h"
@@ -28,7 +29,7 @@ class Type;
 
 //TODO: refact
 
-class Decl : public RefCountable {
+class Decl : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<Decl>;
     using ConstPointer = Rc<const Decl>;
@@ -37,9 +38,12 @@ public:
     ~Decl();
 
     const ModuleInfo* moduleInfo() const;
+    Location startLocation() const;
+    Location endLocation() const;
 
 protected:
     friend class Parser;
+    friend class AstDeserializer;
     void cloneDeclTo(Decl* dest);
 
     Decl();
@@ -63,6 +67,7 @@ public:
 
 private:
     friend class Parser;
+    friend class AstDeserializer;
     bmcl::StringView _name;
 };
 
@@ -98,7 +103,7 @@ public:
 
 class ImportedType;
 
-class ImportDecl : public RefCountable {
+class ImportDecl : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<ImportDecl>;
     using ConstPointer = Rc<const ImportDecl>;
@@ -138,6 +143,7 @@ public:
 
 private:
     friend class Parser;
+    friend class AstDeserializer;
     ImplBlock();
 
     Functions _funcs;
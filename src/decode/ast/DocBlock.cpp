@@ -26,6 +26,12 @@ DocBlock::DocBlock(const DocVec& comments)
     }
 }
 
+DocBlock::DocBlock(bmcl::StringView shortDesc, DocVec&& longDesc)
+    : _shortDesc(shortDesc)
+    , _longDesc(std::move(longDesc))
+{
+}
+
 DocBlock::~DocBlock()
 {
 }
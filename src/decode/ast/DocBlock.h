@@ -2,6 +2,7 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Arena.h"
 #include "decode/core/Iterator.h"
 
 #include <bmcl/Fwd.h>
@@ -11,7 +12,7 @@
 
 namespace decode {
 
-class DocBlock : public RefCountable {
+class DocBlock : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<DocBlock>;
     using ConstPointer = Rc<const DocBlock>;
@@ -19,6 +20,7 @@ public:
     using DocRange = IteratorRange<DocVec::const_iterator>;
 
     DocBlock(const DocVec& comments);
+    DocBlock(bmcl::StringView shortDesc, DocVec&& longDesc);
     ~DocBlock();
 
     bmcl::StringView shortDescription() const;
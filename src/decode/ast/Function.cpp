@@ -10,6 +10,7 @@
 #include "decode/ast/Type.h"
 #include "decode/ast/Field.h"
 #include "decode/ast/Component.h"
+#include "decode/ast/WireLayout.h"
 #include "decode/core/EncodedSizes.h"
 
 namespace decode {
@@ -123,6 +124,16 @@ Command::ArgsConstRange Command::argumentsRange() const
     return _args;
 }
 
+const WireLayout* Command::wireLayout() const
+{
+    return _wireLayout.get();
+}
+
+void Command::setWireLayout(const WireLayout* layout)
+{
+    _wireLayout = layout;
+}
+
 EncodedSizes Command::encodedSizes() const
 {
     EncodedSizes sizes(2);
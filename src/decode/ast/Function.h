@@ -25,6 +25,7 @@ class FunctionType;
 class Field;
 class Type;
 class ModuleInfo;
+class WireLayout;
 struct EncodedSizes;
 
 class Function : public NamedRc, public DocBlockMixin {
@@ -85,8 +86,12 @@ public:
 
     EncodedSizes encodedSizes() const;
 
+    const WireLayout* wireLayout() const;
+    void setWireLayout(const WireLayout* layout);
+
 private:
     ArgVec _args;
     std::uintmax_t _number;
+    Rc<const WireLayout> _wireLayout;
 };
 }
@@ -31,7 +31,7 @@ const FileInfo* ModuleInfo::fileInfo() const
     return _fileInfo.get();
 }
 
-const std::string& ModuleInfo::contents() const
+bmcl::StringView ModuleInfo::contents() const
 {
     return _fileInfo->contents();
 }
@@ -30,7 +30,7 @@ public:
     bmcl::StringView moduleName() const;
     const FileInfo* fileInfo() const;
     const std::string& fileName() const;
-    const std::string& contents() const;
+    bmcl::StringView contents() const;
 
 private:
     bmcl::StringView _moduleName;
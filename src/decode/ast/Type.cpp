@@ -9,6 +9,7 @@
 #include "decode/ast/Type.h"
 #include "decode/ast/ModuleInfo.h"
 #include "decode/ast/Field.h"
+#include "decode/ast/WireLayout.h"
 #include "decode/core/EncodedSizes.h"
 
 #include <bmcl/Logging.h>
@@ -31,6 +32,11 @@ static inline bmcl::StringView viewFromStaticString(const char(&data)[N])
 
 Type::Type(TypeKind kind)
     : _typeKind(kind)
+    , _structuralHash(0)
+    , _factsState(FactsState::None)
+    , _hasEncodedSizes(false)
+    , _finalType(nullptr)
+    , _encodedSizes(0, 0)
 {
 }
 
@@ -312,6 +318,14 @@ GenericParameterType* Type::asGenericParemeter()
 }
 
 const Type* Type::resolveFinalType() const
+{
+    if (_factsState == FactsState::Cached) {
+        return _finalType;
+    }
+    return calcFinalType();
+}
+
+const Type* Type::calcFinalType() const
 {
     if (_typeKind == TypeKind::Alias) {
         return asAlias()->alias()->resolveFinalType();
@@ -323,6 +337,14 @@ const Type* Type::resolveFinalType() const
 }
 
 bmcl::Option<std::size_t> Type::fixedSize() const
+{
+    if (_factsState == FactsState::Cached) {
+        return _fixedSize;
+    }
+    return calcFixedSize();
+}
+
+bmcl::Option<std::size_t> Type::calcFixedSize() const
 {
     const Type* type = resolveFinalType();
     if (type->isArray()) {
@@ -398,6 +420,14 @@ static EncodedSizes variantFieldSize(const VariantField* field)
 }
 
 EncodedSizes Type::encodedSizes() const
+{
+    if (_factsState == FactsState::Cached && _hasEncodedSizes) {
+        return _encodedSizes;
+    }
+    return calcEncodedSizes();
+}
+
+EncodedSizes Type::calcEncodedSizes() const
 {
     switch (typeKind()) {
     case TypeKind::Builtin:
@@ -483,6 +513,88 @@ EncodedSizes Type::encodedSizes() const
     return EncodedSizes(0, 0);
 }
 
+void Type::cacheFacts() const
+{
+    if (_factsState != FactsState::None) {
+        // type in progress is reached only through recursive type references
+        return;
+    }
+    _factsState = FactsState::InProgress;
+
+    // children are cached first, so that calculations below do not recurse
+    bool isSized = true;
+    auto cacheChild = [&isSized](const Type* child) {
+        child->cacheFacts();
+        isSized &= child->_hasEncodedSizes;
+    };
+    switch (_typeKind) {
+    case TypeKind::Builtin:
+        break;
+    case TypeKind::Reference:
+        // pointer size does not depend on pointee
+        asReference()->pointee()->cacheFacts();
+        break;
+    case TypeKind::Array:
+        cacheChild(asArray()->elementType());
+        break;
+    case TypeKind::DynArray:
+        cacheChild(asDynArray()->elementType());
+        break;
+    case TypeKind::Function:
+        if (asFunction()->hasReturnValue()) {
+            asFunction()->returnValue()->cacheFacts();
+        }
+        for (const Field* field : asFunction()->argumentsRange()) {
+            field->type()->cacheFacts();
+        }
+        break;
+    case TypeKind::Enum:
+        break;
+    case TypeKind::Struct:
+        for (const Field* field : asStruct()->fieldsRange()) {
+            cacheChild(field->type());
+        }
+        break;
+    case TypeKind::Variant:
+        for (const VariantField* field : asVariant()->fieldsRange()) {
+            if (field->variantFieldKind() == VariantFieldKind::Tuple) {
+                for (const Type* type : field->asTupleField()->typesRange()) {
+                    cacheChild(type);
+                }
+            } else if (field->variantFieldKind() == VariantFieldKind::Struct) {
+                for (const Field* f : field->asStructField()->fieldsRange()) {
+                    cacheChild(f->type());
+                }
+            }
+        }
+        break;
+    case TypeKind::Imported:
+        cacheChild(asImported()->link());
+        break;
+    case TypeKind::Alias:
+        cacheChild(asAlias()->alias());
+        break;
+    case TypeKind::GenericInstantiation:
+        cacheChild(asGenericInstantiation()->instantiatedType());
+        break;
+    case TypeKind::Generic:
+        asGeneric()->innerType()->cacheFacts();
+        isSized = false;
+        break;
+    case TypeKind::GenericParameter:
+        isSized = false;
+        break;
+    }
+
+    _finalType = calcFinalType();
+    _fixedSize = calcFixedSize();
+    if (isSized) {
+        _encodedSizes = calcEncodedSizes();
+    }
+    _hasEncodedSizes = isSized;
+    _factsState = FactsState::Cached;
+}
+
 template <typename R, typename C>
 bool compareRanges(R r1, R r2, C&& comparator)
 {
@@ -499,6 +611,108 @@ bool compareRanges(R r1, R r2, C&& comparator)
     return true;
 }
 
+static inline std::uint64_t combineHash(std::uint64_t seed, std::uint64_t value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+static inline std::uint64_t stringHash(bmcl::StringView str)
+{
+    // fnv-1a
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : str) {
+        hash = (hash ^ std::uint8_t(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::uint64_t Type::structuralHash() const
+{
+    const Type* type = resolveFinalType();
+    if (type != this) {
+        return type->structuralHash();
+    }
+    std::uint64_t hash = _structuralHash.load(std::memory_order_relaxed);
+    if (hash == 0) {
+        // concurrent calls calculate same value
+        hash = calcStructuralHash();
+        _structuralHash.store(hash, std::memory_order_relaxed);
+    }
+    return hash;
+}
+
+std::uint64_t Type::calcStructuralHash() const
+{
+    std::uint64_t hash = combineHash(0, std::uint64_t(_typeKind));
+    switch (_typeKind) {
+        case TypeKind::Builtin:
+            hash = combineHash(hash, std::uint64_t(asBuiltin()->builtinTypeKind()));
+            break;
+        case TypeKind::Reference: {
+            const ReferenceType* ref = asReference();
+            hash = combineHash(hash, std::uint64_t(ref->referenceKind()));
+            hash = combineHash(hash, ref->isMutable());
+            hash = combineHash(hash, ref->pointee()->structuralHash());
+            break;
+        }
+        case TypeKind::Array:
+            hash = combineHash(hash, asArray()->elementCount());
+            hash = combineHash(hash, asArray()->elementType()->structuralHash());
+            break;
+        case TypeKind::DynArray:
+            hash = combineHash(hash, asDynArray()->elementType()->structuralHash());
+            break;
+        case TypeKind::Function: {
+            const FunctionType* func = asFunction();
+            hash = combineHash(hash, func->selfArgument().isSome() ? 1 + std::uint64_t(func->selfArgument().unwrap()) : 0);
+            hash = combineHash(hash, func->hasReturnValue());
+            if (func->hasReturnValue()) {
+                hash = combineHash(hash, func->returnValue().unwrap()->structuralHash());
+            }
+            for (const Field* field : func->argumentsRange()) {
+                hash = combineHash(hash, stringHash(field->name()));
+                hash = combineHash(hash, field->type()->structuralHash());
+            }
+            break;
+        }
+        // named types can be recursive, their children are compared by equals
+        case TypeKind::Enum:
+            hash = combineHash(hash, stringHash(asEnum()->name()));
+            for (const EnumConstant* c : asEnum()->constantsRange()) {
+                hash = combineHash(hash, c->isUserSet());
+                hash = combineHash(hash, c->value());
+            }
+            break;
+        case TypeKind::Struct:
+            hash = combineHash(hash, stringHash(asStruct()->name()));
+            for (const Field* field : asStruct()->fieldsRange()) {
+                hash = combineHash(hash, stringHash(field->name()));
+            }
+            break;
+        case TypeKind::Variant:
+            hash = combineHash(hash, stringHash(asVariant()->name()));
+            for (const VariantField* field : asVariant()->fieldsRange()) {
+                hash = combineHash(hash, stringHash(field->name()));
+            }
+            break;
+        case TypeKind::Imported:
+        case TypeKind::Alias:
+            assert(false);
+            break;
+        case TypeKind::Generic:
+            hash = combineHash(hash, asGeneric()->innerType()->structuralHash());
+            break;
+        case TypeKind::GenericInstantiation:
+            hash = combineHash(hash, asGenericInstantiation()->instantiatedType()->structuralHash());
+            break;
+        case TypeKind::GenericParameter:
+            hash = combineHash(hash, stringHash(asGenericParemeter()->name()));
+            break;
+    }
+    // zero marks hash that is not calculated yet
+    return hash == 0 ? 1 : hash;
+}
+
 bool Type::equals(const Type* other) const
 {
     const Type* first = resolveFinalType();
@@ -509,6 +723,9 @@ bool Type::equals(const Type* other) const
     if (first->typeKind() != second->typeKind()) {
         return false;
     }
+    if (first->structuralHash() != second->structuralHash()) {
+        return false;
+    }
 
     switch (first->typeKind()) {
         case TypeKind::Builtin:
@@ -535,12 +752,11 @@ bool Type::equals(const Type* other) const
             if (l->selfArgument() != r->selfArgument()) {
                 return false;
             }
+            if (l->hasReturnValue() != r->hasReturnValue()) {
+                return false;
+            }
             if (l->hasReturnValue()) {
-                if (r->hasReturnValue()) {
-                    if (!l->returnValue().unwrap()->equals(r->returnValue().unwrap())) {
-                        return false;
-                    }
-                } else {
+                if (!l->returnValue().unwrap()->equals(r->returnValue().unwrap())) {
                     return false;
                 }
             }
@@ -929,6 +1145,11 @@ NamedType* ImportedType::link()
     return _link.get();
 }
 
+bmcl::StringView ImportedType::importPath() const
+{
+    return _importPath;
+}
+
 void ImportedType::setLink(NamedType* link)
 {
     _link.reset(link);
@@ -1022,6 +1243,16 @@ StructType::~StructType()
 {
 }
 
+const WireLayout* StructType::wireLayout() const
+{
+    return _wireLayout.get();
+}
+
+void StructType::setWireLayout(const WireLayout* layout)
+{
+    _wireLayout = layout;
+}
+
 StructType::Fields::ConstIterator StructType::fieldsBegin() const
 {
     return _fields.cbegin();
@@ -1213,16 +1444,24 @@ bmcl::Result<Rc<NamedType>, std::string> GenericType::instantiate(const bmcl::Ar
         return std::string("invalid number of parameters");
     }
 
-    Rc<Type> cloned = cloneAndSubstitute(_type.get(), types);
+    Rc<Type> cloned = cloneAndSubstitute(_type.get(), types, true);
     if (cloned.isNull()) {
         return std::string("failed to substitute generic parameters");
     }
     return Rc<NamedType>(static_cast<NamedType*>(cloned.get()));
 }
 
+// subtrees without generic parameters are shared with generic type instead of being cloned
+
 Rc<Field> GenericType::cloneAndSubstitute(Field* field, bmcl::ArrayView<Rc<Type>> types)
 {
-    Rc<Type> clonedType = cloneAndSubstitute(field->type(), types);
+    Rc<Type> clonedType = cloneAndSubstitute(field->type(), types, false);
+    if (clonedType.isNull()) {
+        return nullptr;
+    }
+    if (clonedType.get() == field->type()) {
+        return field;
+    }
     Rc<Field> clonedField = new Field(field->name(), clonedType.get());
     if (field->rangeAttribute().isSome()) {
         clonedField->setRangeAttribute(field->rangeAttribute().unwrap());
@@ -1237,19 +1476,43 @@ Rc<VariantField> GenericType::cloneAndSubstitute(VariantField* varField, bmcl::A
         return varField;
     case VariantFieldKind::Tuple: {
         TupleVariantField* f = static_cast<TupleVariantField*>(varField);
-        Rc<TupleVariantField> newField = new TupleVariantField(f->id(), f->name());
+        RcVec<Type> clonedTypes;
+        bool isChanged = false;
         for (Type* type : f->typesRange()) {
-            Rc<Type> cloned = cloneAndSubstitute(type, types);
-            newField->addType(cloned.get());
+            Rc<Type> cloned = cloneAndSubstitute(type, types, false);
+            if (cloned.isNull()) {
+                return nullptr;
+            }
+            isChanged |= cloned.get() != type;
+            clonedTypes.emplace_back(std::move(cloned));
+        }
+        if (!isChanged) {
+            return varField;
+        }
+        Rc<TupleVariantField> newField = new TupleVariantField(f->id(), f->name());
+        for (const Rc<Type>& type : clonedTypes) {
+            newField->addType(type.get());
         }
         return newField;
     }
     case VariantFieldKind::Struct: {
         StructVariantField* f = static_cast<StructVariantField*>(varField);
-        Rc<StructVariantField> newField = new StructVariantField(f->id(), f->name());
+        RcVec<Field> clonedFields;
+        bool isChanged = false;
         for (Field* field : f->fieldsRange()) {
             Rc<Field> cloned = cloneAndSubstitute(field, types);
-            newField->addField(cloned.get());
+            if (cloned.isNull()) {
+                return nullptr;
+            }
+            isChanged |= cloned.get() != field;
+            clonedFields.emplace_back(std::move(cloned));
+        }
+        if (!isChanged) {
+            return varField;
+        }
+        Rc<StructVariantField> newField = new StructVariantField(f->id(), f->name());
+        for (const Rc<Field>& field : clonedFields) {
+            newField->addField(field.get());
         }
         return newField;
     }
@@ -1257,37 +1520,74 @@ Rc<VariantField> GenericType::cloneAndSubstitute(VariantField* varField, bmcl::A
     bmcl::panic("unreachable"); //FIXME: add macro
 }
 
-Rc<Type> GenericType::cloneAndSubstitute(Type* type, bmcl::ArrayView<Rc<Type>> types)
+Rc<Type> GenericType::cloneAndSubstitute(Type* type, bmcl::ArrayView<Rc<Type>> types, bool forceClone)
 {
     switch (type->typeKind()) {
         case TypeKind::Builtin:
             return type;
         case TypeKind::Reference: {
             ReferenceType* ref = type->asReference();
-            Rc<Type> cloned = cloneAndSubstitute(ref->pointee(), types);
+            Rc<Type> cloned = cloneAndSubstitute(ref->pointee(), types, false);
+            if (cloned.isNull()) {
+                return nullptr;
+            }
+            if (cloned.get() == ref->pointee()) {
+                return type;
+            }
             return new ReferenceType(ref->referenceKind(), ref->isMutable(), cloned.get());
         }
         case TypeKind::Array: {
             ArrayType* array = type->asArray();
-            Rc<Type> cloned = cloneAndSubstitute(array->elementType(), types);
+            Rc<Type> cloned = cloneAndSubstitute(array->elementType(), types, false);
+            if (cloned.isNull()) {
+                return nullptr;
+            }
+            if (cloned.get() == array->elementType()) {
+                return type;
+            }
             return new ArrayType(array->elementCount(), cloned.get());
         }
         case TypeKind::DynArray: {
             DynArrayType* dynArray = type->asDynArray();
-            Rc<Type> cloned = cloneAndSubstitute(dynArray->elementType(), types);
+            Rc<Type> cloned = cloneAndSubstitute(dynArray->elementType(), types, false);
+            if (cloned.isNull()) {
+                return nullptr;
+            }
+            if (cloned.get() == dynArray->elementType()) {
+                return type;
+            }
             return new DynArrayType(dynArray->maxSize(), cloned.get());
         }
         case TypeKind::Function: {
             FunctionType* func = type->asFunction();
-            Rc<FunctionType> newFunc = new FunctionType();
+            Rc<Type> clonedReturnValue;
+            bool isChanged = false;
             if (func->hasReturnValue()) {
-                Rc<Type> cloned = cloneAndSubstitute(func->returnValue().unwrap(), types);
-                newFunc->setReturnValue(cloned.get());
+                clonedReturnValue = cloneAndSubstitute(func->returnValue().unwrap(), types, false);
+                if (clonedReturnValue.isNull()) {
+                    return nullptr;
+                }
+                isChanged |= clonedReturnValue.get() != func->returnValue().unwrap();
             }
-            newFunc->setSelfArgument(func->selfArgument());
+            RcVec<Field> clonedArgs;
             for (Field* field : func->argumentsRange()) {
                 Rc<Field> cloned = cloneAndSubstitute(field, types);
-                newFunc->addArgument(cloned.get());
+                if (cloned.isNull()) {
+                    return nullptr;
+                }
+                isChanged |= cloned.get() != field;
+                clonedArgs.emplace_back(std::move(cloned));
+            }
+            if (!isChanged) {
+                return type;
+            }
+            Rc<FunctionType> newFunc = new FunctionType();
+            if (!clonedReturnValue.isNull()) {
+                newFunc->setReturnValue(clonedReturnValue.get());
+            }
+            newFunc->setSelfArgument(func->selfArgument());
+            for (const Rc<Field>& field : clonedArgs) {
+                newFunc->addArgument(field.get());
             }
             return newFunc;
         }
@@ -1296,19 +1596,43 @@ Rc<Type> GenericType::cloneAndSubstitute(Type* type, bmcl::ArrayView<Rc<Type>> t
         }
         case TypeKind::Struct: {
             StructType* structType = type->asStruct();
-            Rc<StructType> newStruct = new StructType(structType->name(), structType->moduleInfo());
+            RcVec<Field> clonedFields;
+            bool isChanged = forceClone;
             for (Field* field : structType->fieldsRange()) {
                 Rc<Field> cloned = cloneAndSubstitute(field, types);
-                newStruct->addField(cloned.get());
+                if (cloned.isNull()) {
+                    return nullptr;
+                }
+                isChanged |= cloned.get() != field;
+                clonedFields.emplace_back(std::move(cloned));
+            }
+            if (!isChanged) {
+                return type;
+            }
+            Rc<StructType> newStruct = new StructType(structType->name(), structType->moduleInfo());
+            for (const Rc<Field>& field : clonedFields) {
+                newStruct->addField(field.get());
             }
             return newStruct;
         }
         case TypeKind::Variant: {
             VariantType* variant = type->asVariant();
-            Rc<VariantType> newVariant = new VariantType(variant->name(), variant->moduleInfo());
+            RcVec<VariantField> clonedFields;
+            bool isChanged = forceClone;
             for (VariantField* field : variant->fieldsRange()) {
                 Rc<VariantField> cloned = cloneAndSubstitute(field, types);
-                newVariant->addField(cloned.get());
+                if (cloned.isNull()) {
+                    return nullptr;
+                }
+                isChanged |= cloned.get() != field;
+                clonedFields.emplace_back(std::move(cloned));
+            }
+            if (!isChanged) {
+                return type;
+            }
+            Rc<VariantType> newVariant = new VariantType(variant->name(), variant->moduleInfo());
+            for (const Rc<VariantField>& field : clonedFields) {
+                newVariant->addField(field.get());
             }
             return newVariant;
 
@@ -1318,7 +1642,13 @@ Rc<Type> GenericType::cloneAndSubstitute(Type* type, bmcl::ArrayView<Rc<Type>> t
         }
         case TypeKind::Alias: {
             AliasType* alias = type->asAlias();
-            Rc<Type> cloned = cloneAndSubstitute(alias->alias(), types);
+            Rc<Type> cloned = cloneAndSubstitute(alias->alias(), types, false);
+            if (cloned.isNull()) {
+                return nullptr;
+            }
+            if (cloned.get() == alias->alias() && !forceClone) {
+                return type;
+            }
             return new AliasType(alias->name(), alias->moduleInfo(), cloned.get());
         }
         case TypeKind::Generic: {
@@ -1327,7 +1657,13 @@ Rc<Type> GenericType::cloneAndSubstitute(Type* type, bmcl::ArrayView<Rc<Type>> t
         }
         case TypeKind::GenericInstantiation: {
             GenericInstantiationType* generic = type->asGenericInstantiation();
-            Rc<Type> cloned = cloneAndSubstitute(generic->instantiatedType(), types);
+            Rc<Type> cloned = cloneAndSubstitute(generic->instantiatedType(), types, false);
+            if (cloned.isNull()) {
+                return nullptr;
+            }
+            if (cloned.get() == generic->instantiatedType() && !forceClone) {
+                return type;
+            }
             return new GenericInstantiationType(generic->genericName(), generic->substitutedTypes(), static_cast<NamedType*>(cloned.get()));
         }
         case TypeKind::GenericParameter: {
@@ -10,8 +10,10 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Arena.h"
 #include "decode/core/Iterator.h"
 #include "decode/core/NamedRc.h"
+#include "decode/core/EncodedSizes.h"
 #include "decode/parser/Containers.h"
 #include "decode/ast/DocBlockMixin.h"
 
@@ -20,6 +22,7 @@
 #include <bmcl/StringView.h>
 #include <bmcl/StringViewHash.h>
 
+#include <atomic>
 #include <cstdint>
 #include <map>
 
@@ -87,9 +90,9 @@ class GenericInstantiationType;
 class GenericParameterType;
 class Field;
 class ModuleInfo;
-struct EncodedSizes;
+class WireLayout;
 
-class Type : public RefCountable, public DocBlockMixin {
+class Type : public RefCountable, public ArenaAllocated, public DocBlockMixin {
 public:
     using Pointer = Rc<Type>;
     using ConstPointer = Rc<const Type>;
@@ -133,6 +136,10 @@ public:
     bmcl::Option<std::size_t> fixedSize() const;
     EncodedSizes encodedSizes() const;
 
+    // caches final type, fixed size and encoded sizes of this type and all its children
+    // called once package is resolved, types must not be modified after that
+    void cacheFacts() const;
+
     bool isArray() const;
     bool isDynArray() const;
     bool isStruct() const;
@@ -149,13 +156,50 @@ public:
 
     bool isBuiltinChar() const;
 
+    // compares structural hashes first, deep comparison is done only on hash match
     bool equals(const Type* other) const;
 
+    // hash of resolved type consistent with equals, children of named types are not hashed
+    // cached on first call, type and its children must not be modified after that
+    std::uint64_t structuralHash() const;
+
 protected:
     Type(TypeKind kind);
 
 private:
+    enum class FactsState : std::uint8_t {
+        None,
+        InProgress,
+        Cached,
+    };
+
+    std::uint64_t calcStructuralHash() const;
+    const Type* calcFinalType() const;
+    bmcl::Option<std::size_t> calcFixedSize() const;
+    EncodedSizes calcEncodedSizes() const;
+
     TypeKind _typeKind;
+    mutable std::atomic<std::uint64_t> _structuralHash;
+    mutable FactsState _factsState;
+    mutable bool _hasEncodedSizes;
+    mutable const Type* _finalType;
+    mutable bmcl::Option<std::size_t> _fixedSize;
+    mutable EncodedSizes _encodedSizes;
+};
+
+// allows using types as HashMap keys compared by structure instead of identity
+struct TypeStructuralHash {
+    std::size_t operator()(const Type* type) const
+    {
+        return type->structuralHash();
+    }
+};
+
+struct TypeStructuralEqual {
+    bool operator()(const Type* left, const Type* right) const
+    {
+        return left->equals(right);
+    }
 };
 
 class TopLevelType : public Type {
@@ -216,7 +260,7 @@ public:
     bmcl::Result<Rc<NamedType>, std::string> instantiate(bmcl::ArrayView<Rc<Type>> types);
 
 private:
-    Rc<Type> cloneAndSubstitute(Type* type, bmcl::ArrayView<Rc<Type>> types);
+    Rc<Type> cloneAndSubstitute(Type* type, bmcl::ArrayView<Rc<Type>> types, bool forceClone);
     Rc<VariantField> cloneAndSubstitute(VariantField* field, bmcl::ArrayView<Rc<Type>> types);
     Rc<Field> cloneAndSubstitute(Field* field, bmcl::ArrayView<Rc<Type>> types);
 
@@ -352,6 +396,7 @@ public:
 
     const NamedType* link() const;
     NamedType* link();
+    bmcl::StringView importPath() const;
 
     void setLink(NamedType* link);
 
@@ -414,9 +459,14 @@ public:
     bmcl::OptionPtr<Field> fieldWithName(bmcl::StringView name);
     bmcl::Option<std::size_t> indexOfField(const Field* field) const;
 
+    // set by package once it is resolved, null otherwise
+    const WireLayout* wireLayout() const;
+    void setWireLayout(const WireLayout* layout);
+
 private:
     Fields _fields;
     RcSecondUnorderedMap<bmcl::StringView, Field> _nameToFieldMap;
+    Rc<const WireLayout> _wireLayout;
 };
 
 class EnumConstant : public NamedRc, public DocBlockMixin {
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/ast/TypeTable.h"
+#include "decode/ast/Type.h"
+
+#include <functional>
+
+namespace decode {
+
+bool TypeTable::Key::operator==(const Key& other) const
+{
+    return kind == other.kind && param == other.param && child == other.child;
+}
+
+std::size_t TypeTable::KeyHash::operator()(const Key& key) const
+{
+    std::size_t hash = std::hash<const Type*>()(key.child);
+    hash ^= std::hash<std::uintmax_t>()(key.param) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::size_t(key.kind) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+TypeTable::TypeTable()
+{
+}
+
+TypeTable::~TypeTable()
+{
+}
+
+template <typename T, typename F>
+Rc<T> TypeTable::findOrCreate(const Key& key, F&& create)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _types.find(key);
+    if (it != _types.end()) {
+        return static_cast<T*>(it->second.get());
+    }
+    Rc<T> type = create();
+    _types.emplace(key, type.get());
+    return type;
+}
+
+Rc<ReferenceType> TypeTable::referenceType(ReferenceKind kind, bool isMutable, Type* pointee)
+{
+    Key key{TypeKind::Reference, (std::uintmax_t(kind) << 1) | std::uintmax_t(isMutable), pointee};
+    return findOrCreate<ReferenceType>(key, [=]() {
+        return new ReferenceType(kind, isMutable, pointee);
+    });
+}
+
+Rc<ArrayType> TypeTable::arrayType(std::uintmax_t elementCount, Type* elementType)
+{
+    Key key{TypeKind::Array, elementCount, elementType};
+    return findOrCreate<ArrayType>(key, [=]() {
+        return new ArrayType(elementCount, elementType);
+    });
+}
+
+Rc<DynArrayType> TypeTable::dynArrayType(std::uintmax_t maxSize, Type* elementType)
+{
+    Key key{TypeKind::DynArray, maxSize, elementType};
+    return findOrCreate<DynArrayType>(key, [=]() {
+        return new DynArrayType(maxSize, elementType);
+    });
+}
+
+std::size_t TypeTable::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _types.size();
+}
+}
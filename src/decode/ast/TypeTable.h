@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace decode {
+
+class Type;
+class ReferenceType;
+class ArrayType;
+class DynArrayType;
+enum class TypeKind;
+enum class ReferenceKind;
+
+// package wide table of canonical anonymous types, safe to use from multiple threads
+// reference, array and dyn array types with same parameters and identical element types share one node
+class TypeTable : public RefCountable {
+public:
+    using Pointer = Rc<TypeTable>;
+    using ConstPointer = Rc<const TypeTable>;
+
+    TypeTable();
+    ~TypeTable();
+
+    Rc<ReferenceType> referenceType(ReferenceKind kind, bool isMutable, Type* pointee);
+    Rc<ArrayType> arrayType(std::uintmax_t elementCount, Type* elementType);
+    Rc<DynArrayType> dynArrayType(std::uintmax_t maxSize, Type* elementType);
+
+    std::size_t size() const;
+
+private:
+    struct Key {
+        TypeKind kind;
+        std::uintmax_t param;
+        const Type* child;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    template <typename T, typename F>
+    Rc<T> findOrCreate(const Key& key, F&& create);
+
+    mutable std::mutex _mutex;
+    HashMap<Key, Rc<Type>, KeyHash> _types;
+};
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/ast/WireLayout.h"
+#include "decode/ast/Type.h"
+
+namespace decode {
+
+WireLayout::WireLayout(bmcl::ArrayView<const Type*> types)
+{
+    _fields.reserve(types.size());
+    bmcl::Option<std::size_t> offset = std::size_t(0);
+    for (std::size_t i = 0; i < types.size(); i++) {
+        WireFieldLayout field;
+        field.size = types[i]->fixedSize();
+        field.offset = offset;
+        field.offsetInSegment = 0;
+        if (field.size.isNone()) {
+            offset.clear();
+            _fields.push_back(field);
+            continue;
+        }
+
+        bool continuesSegment = i != 0 && _fields.back().segment.isSome();
+        if (!continuesSegment) {
+            WireSegment segment;
+            segment.firstField = i;
+            segment.fieldsNum = 0;
+            segment.size = 0;
+            segment.offset = offset;
+            _segments.push_back(segment);
+        }
+        WireSegment& segment = _segments.back();
+        field.segment.emplace(_segments.size() - 1);
+        field.offsetInSegment = segment.size;
+        segment.fieldsNum++;
+        segment.size += field.size.unwrap();
+        if (offset.isSome()) {
+            offset.emplace(offset.unwrap() + field.size.unwrap());
+        }
+        _fields.push_back(field);
+    }
+}
+
+WireLayout::~WireLayout()
+{
+}
+
+std::size_t WireLayout::fieldsNum() const
+{
+    return _fields.size();
+}
+
+const WireFieldLayout& WireLayout::fieldAt(std::size_t index) const
+{
+    return _fields[index];
+}
+
+bmcl::ArrayView<WireSegment> WireLayout::segments() const
+{
+    return _segments;
+}
+
+bmcl::Option<std::size_t> WireLayout::fixedSize() const
+{
+    if (_fields.empty()) {
+        return std::size_t(0);
+    }
+    if (_segments.size() != 1 || _segments[0].fieldsNum != _fields.size()) {
+        return bmcl::None;
+    }
+    return _segments[0].size;
+}
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+
+#include <bmcl/ArrayView.h>
+#include <bmcl/Option.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace decode {
+
+class Type;
+
+// contiguous run of fields with fixed encoded size
+struct WireSegment {
+    std::size_t firstField;
+    std::size_t fieldsNum;
+    std::size_t size;
+    // relative to the first field of the sequence, none if segment follows a field of variable size
+    bmcl::Option<std::size_t> offset;
+};
+
+struct WireFieldLayout {
+    // none if field size is variable
+    bmcl::Option<std::size_t> size;
+    // relative to the first field of the sequence, none if field follows a field of variable size
+    bmcl::Option<std::size_t> offset;
+    // none if field size is variable
+    bmcl::Option<std::size_t> segment;
+    std::size_t offsetInSegment;
+};
+
+// encoded layout of a field sequence (struct fields, command arguments or message parts)
+// offsets do not include message headers
+class WireLayout : public RefCountable {
+public:
+    using Pointer = Rc<WireLayout>;
+    using ConstPointer = Rc<const WireLayout>;
+
+    explicit WireLayout(bmcl::ArrayView<const Type*> types);
+    ~WireLayout();
+
+    // R is a range of fields, command arguments or var regexps
+    template <typename R>
+    static Rc<WireLayout> fromRange(R&& range)
+    {
+        std::vector<const Type*> types;
+        for (auto it = range.begin(); it != range.end(); ++it) {
+            types.push_back(it->type());
+        }
+        return new WireLayout(types);
+    }
+
+    std::size_t fieldsNum() const;
+    const WireFieldLayout& fieldAt(std::size_t index) const;
+    bmcl::ArrayView<WireSegment> segments() const;
+
+    // some if all fields have fixed size
+    bmcl::Option<std::size_t> fixedSize() const;
+
+private:
+    std::vector<WireFieldLayout> _fields;
+    std::vector<WireSegment> _segments;
+};
+}
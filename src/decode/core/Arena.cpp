@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Arena.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace decode {
+
+// every allocation is prefixed with a header that points to owning chunk, null for heap allocations
+static constexpr std::size_t allocAlignment = alignof(std::max_align_t);
+static constexpr std::size_t allocHeaderSize = (sizeof(void*) + allocAlignment - 1) & ~(allocAlignment - 1);
+static constexpr std::size_t chunkSize = 64 * 1024;
+static constexpr std::size_t maxChunkAllocSize = chunkSize / 8;
+// chunk reference count is biased while chunk is in use by the arena, so that allocations
+// are not counted atomically
+static constexpr std::size_t chunkRefBias = std::numeric_limits<std::size_t>::max() / 2;
+
+static thread_local Arena* currentArena = nullptr;
+
+struct Arena::Chunk {
+    Chunk()
+        : refs(chunkRefBias)
+        , allocated(0)
+    {
+    }
+
+    void release(std::size_t n)
+    {
+        if (refs.fetch_sub(n) == n) {
+            this->~Chunk();
+            ::operator delete(this);
+        }
+    }
+
+    std::atomic<std::size_t> refs;
+    std::size_t allocated;
+};
+
+Arena::Arena()
+    : _current(nullptr)
+    , _next(nullptr)
+    , _end(nullptr)
+    , _chunksNum(0)
+{
+}
+
+Arena::~Arena()
+{
+    retireCurrentChunk();
+}
+
+void Arena::retireCurrentChunk()
+{
+    if (!_current) {
+        return;
+    }
+    // replace bias with actual number of allocated objects
+    Chunk* chunk = _current;
+    _current = nullptr;
+    chunk->refs.fetch_add(chunk->allocated);
+    chunk->release(chunkRefBias);
+}
+
+void* Arena::allocateFromChunk(std::size_t size)
+{
+    constexpr std::size_t chunkHeaderSize = (sizeof(Chunk) + allocAlignment - 1) & ~(allocAlignment - 1);
+    size = (size + allocAlignment - 1) & ~(allocAlignment - 1);
+    if (std::size_t(_end - _next) < size) {
+        retireCurrentChunk();
+        char* data = (char*)::operator new(chunkSize);
+        _current = new (data) Chunk;
+        _next = data + chunkHeaderSize;
+        _end = data + chunkSize;
+        _chunksNum++;
+    }
+    char* rv = _next;
+    _next += size;
+    _current->allocated++;
+    *(Chunk**)rv = _current;
+    return rv + allocHeaderSize;
+}
+
+void* Arena::allocate(Arena* arena, std::size_t size)
+{
+    std::size_t fullSize = size + allocHeaderSize;
+    if (arena && fullSize <= maxChunkAllocSize) {
+        return arena->allocateFromChunk(fullSize);
+    }
+    char* data = (char*)::operator new(fullSize);
+    *(Chunk**)data = nullptr;
+    return data + allocHeaderSize;
+}
+
+void Arena::deallocate(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    char* data = (char*)ptr - allocHeaderSize;
+    Chunk* chunk = *(Chunk**)data;
+    if (!chunk) {
+        ::operator delete(data);
+        return;
+    }
+    chunk->release(1);
+}
+
+std::size_t Arena::chunksNum() const
+{
+    return _chunksNum;
+}
+
+ArenaScope::ArenaScope(Arena* arena)
+    : _prev(currentArena)
+{
+    currentArena = arena;
+}
+
+ArenaScope::~ArenaScope()
+{
+    currentArena = _prev;
+}
+
+void* ArenaAllocated::operator new(std::size_t size)
+{
+    return Arena::allocate(currentArena, size);
+}
+
+void ArenaAllocated::operator delete(void* ptr)
+{
+    Arena::deallocate(ptr);
+}
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+
+#include <cstddef>
+
+namespace decode {
+
+// bump allocator for ast nodes, not thread safe, use one arena per thread
+// memory is allocated in chunks, a chunk is freed in one step when it is no longer used by the arena
+// and all objects allocated from it are deleted, so objects may outlive the arena
+class Arena : public RefCountable {
+public:
+    using Pointer = Rc<Arena>;
+    using ConstPointer = Rc<const Arena>;
+
+    Arena();
+    ~Arena();
+
+    // allocates from heap if arena is null, memory must be freed with Arena::deallocate
+    static void* allocate(Arena* arena, std::size_t size);
+    static void deallocate(void* ptr);
+
+    std::size_t chunksNum() const;
+
+private:
+    struct Chunk;
+
+    void* allocateFromChunk(std::size_t size);
+    void retireCurrentChunk();
+
+    Chunk* _current;
+    char* _next;
+    char* _end;
+    std::size_t _chunksNum;
+};
+
+// makes arena current for calling thread, previous arena is restored on destruction
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena* arena);
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena* _prev;
+};
+
+// objects of derived classes are allocated from current thread arena if there is one, otherwise from heap
+class ArenaAllocated {
+public:
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr);
+};
+}
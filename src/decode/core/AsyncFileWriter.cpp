@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/AsyncFileWriter.h"
+#include "decode/core/Diagnostics.h"
+#include "decode/core/PathUtils.h"
+#include "decode/core/Utils.h"
+
+#include <bmcl/StringView.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace decode {
+
+// generated sources are small, limit only guards against unbounded memory growth if io is slow
+constexpr std::size_t maxQueuedSize = 64 * 1024 * 1024;
+
+AsyncFileWriter::AsyncFileWriter(std::size_t numThreads, bool writeOnlyChanged)
+    : _nextIndex(0)
+    , _queuedSize(0)
+    , _numPending(0)
+    , _numWritten(0)
+    , _numUnchanged(0)
+    , _writeOnlyChanged(writeOnlyChanged)
+    , _isStopping(false)
+{
+    numThreads = std::max<std::size_t>(1, numThreads);
+    for (std::size_t i = 0; i < numThreads; i++) {
+        _workers.emplace_back(new Worker);
+    }
+    for (const std::unique_ptr<Worker>& worker : _workers) {
+        worker->thread = std::thread(&AsyncFileWriter::run, this, worker.get());
+    }
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+    for (const std::unique_ptr<Worker>& worker : _workers) {
+        worker->hasTasks.notify_one();
+    }
+    for (const std::unique_ptr<Worker>& worker : _workers) {
+        worker->thread.join();
+    }
+}
+
+void AsyncFileWriter::makeDirectory(std::string&& path)
+{
+    enqueue(Task{0, std::move(path), std::string(), true});
+}
+
+void AsyncFileWriter::write(std::string&& path, std::string&& contents)
+{
+    enqueue(Task{0, std::move(path), std::move(contents), false});
+}
+
+void AsyncFileWriter::enqueue(Task&& task)
+{
+    std::size_t size = task.contents.size();
+    // same path always goes to same worker, so writes to it are not reordered
+    Worker* worker = _workers[std::hash<std::string>()(task.path) % _workers.size()].get();
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _stateChanged.wait(lock, [this, size]() {
+            return _queuedSize == 0 || _queuedSize + size <= maxQueuedSize;
+        });
+        task.index = _nextIndex++;
+        _queuedSize += size;
+        _numPending++;
+        worker->tasks.push_back(std::move(task));
+    }
+    worker->hasTasks.notify_one();
+}
+
+void AsyncFileWriter::run(Worker* worker)
+{
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            worker->hasTasks.wait(lock, [this, worker]() {
+                return !worker->tasks.empty() || _isStopping;
+            });
+            if (worker->tasks.empty()) {
+                return;
+            }
+            task = std::move(worker->tasks.front());
+            worker->tasks.pop_front();
+        }
+        execute(task);
+    }
+}
+
+void AsyncFileWriter::execute(const Task& task)
+{
+    Rc<Diagnostics> diag = new Diagnostics;
+    bool isOk;
+    bool isWritten = false;
+    if (task.isDirectory) {
+        isOk = makeDirectoryOnce(task.path, diag.get());
+    } else {
+        std::string dir = task.path;
+        removeFilePart(&dir);
+        isOk = dir.empty() || makeDirectoryOnce(dir, diag.get());
+        if (isOk && _writeOnlyChanged) {
+            isOk = saveOutputIfChanged(task.path, bmcl::StringView(task.contents).asBytes(), &isWritten, diag.get());
+        } else if (isOk) {
+            isOk = saveOutput(task.path, bmcl::StringView(task.contents).asBytes(), diag.get());
+            isWritten = true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!isOk) {
+            // moved so that reference count is not touched by this thread after unlocking
+            _errors.emplace_back(task.index, std::move(diag));
+        } else if (!task.isDirectory) {
+            if (isWritten) {
+                _numWritten++;
+            } else {
+                _numUnchanged++;
+            }
+        }
+        _queuedSize -= task.contents.size();
+        _numPending--;
+    }
+    _stateChanged.notify_all();
+}
+
+bool AsyncFileWriter::makeDirectoryOnce(std::string path, Diagnostics* diag)
+{
+    while (path.size() > 1 && path.back() == pathSeparator()) {
+        path.pop_back();
+    }
+    {
+        std::lock_guard<std::mutex> lock(_dirMutex);
+        if (_createdDirs.find(path) != _createdDirs.end()) {
+            return true;
+        }
+    }
+    // other worker can create same directory at the same time, existing directories are not an error
+    if (!makeDirectoryRecursive(path, diag)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(_dirMutex);
+    _createdDirs.insert(std::move(path));
+    return true;
+}
+
+bool AsyncFileWriter::finish(Diagnostics* diag)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stateChanged.wait(lock, [this]() {
+        return _numPending == 0;
+    });
+    std::sort(_errors.begin(), _errors.end(), [](const std::pair<std::size_t, Rc<Diagnostics>>& left, const std::pair<std::size_t, Rc<Diagnostics>>& right) {
+        return left.first < right.first;
+    });
+    bool isOk = _errors.empty();
+    for (const std::pair<std::size_t, Rc<Diagnostics>>& error : _errors) {
+        diag->takeReportsFrom(error.second.get());
+    }
+    _errors.clear();
+    return isOk;
+}
+
+std::size_t AsyncFileWriter::numWrittenFiles() const
+{
+    return _numWritten;
+}
+
+std::size_t AsyncFileWriter::numUnchangedFiles() const
+{
+    return _numUnchanged;
+}
+}
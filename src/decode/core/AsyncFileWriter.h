@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashSet.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace decode {
+
+class Diagnostics;
+
+// writes files on background io threads so that caller does not wait for file system
+// writes to same path are done in queue order, parent directories are created on demand and remembered
+class AsyncFileWriter : public RefCountable {
+public:
+    using Pointer = Rc<AsyncFileWriter>;
+    using ConstPointer = Rc<const AsyncFileWriter>;
+
+    // files with unchanged contents are left untouched if writeOnlyChanged is set
+    AsyncFileWriter(std::size_t numThreads, bool writeOnlyChanged);
+    // waits for queued operations, errors that were not taken with finish() are dropped
+    ~AsyncFileWriter();
+
+    void makeDirectory(std::string&& path);
+    // blocks while queued contents exceed size limit
+    void write(std::string&& path, std::string&& contents);
+
+    // waits for queued operations and moves their errors to diag in queue order
+    bool finish(Diagnostics* diag);
+
+    std::size_t numWrittenFiles() const;
+    std::size_t numUnchangedFiles() const;
+
+private:
+    struct Task {
+        std::size_t index;
+        std::string path;
+        std::string contents;
+        bool isDirectory;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::deque<Task> tasks;
+        std::condition_variable hasTasks;
+    };
+
+    void enqueue(Task&& task);
+    void run(Worker* worker);
+    void execute(const Task& task);
+    bool makeDirectoryOnce(std::string path, Diagnostics* diag);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::pair<std::size_t, Rc<Diagnostics>>> _errors;
+    HashSet<std::string> _createdDirs;
+    std::mutex _mutex;
+    std::mutex _dirMutex;
+    std::condition_variable _stateChanged;
+    std::size_t _nextIndex;
+    std::size_t _queuedSize;
+    std::size_t _numPending;
+    std::size_t _numWritten;
+    std::size_t _numUnchanged;
+    bool _writeOnlyChanged;
+    bool _isStopping;
+};
+}
@@ -2,6 +2,7 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Arena.h"
 #include "decode/core/Iterator.h"
 #include "decode/core/CmdArgPassKind.h"
 
@@ -10,7 +11,7 @@
 
 namespace decode {
 
-class CmdCallAttr : public RefCountable {
+class CmdCallAttr : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<CmdCallAttr>;
     using ConstPointer = Rc<const CmdCallAttr>;
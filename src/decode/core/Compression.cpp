@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Compression.h"
+#include "decode/core/Lz.h"
+#include "decode/core/Zpaq.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace decode {
+
+// zpaq archives start with block header or locator tag, so headerless archives are never mistaken for headers
+const std::array<std::uint8_t, 4> compressionMagic = {{0x64, 0x63, 0x6d, 0x70}};
+
+const char* compressionCodecName(CompressionCodec codec)
+{
+    switch (codec) {
+    case CompressionCodec::Stored:
+        return "none";
+    case CompressionCodec::Fast:
+        return "fast";
+    case CompressionCodec::Zpaq:
+        return "zpaq";
+    }
+    return "unknown";
+}
+
+CompressionResult compressData(CompressionCodec codec, const void* src, std::size_t size, unsigned zpaqLevel, std::size_t numJobs)
+{
+    bmcl::Buffer dest;
+    dest.write(compressionMagic.data(), compressionMagic.size());
+    dest.writeUint8((std::uint8_t)codec);
+    dest.writeVarUint(size);
+
+    switch (codec) {
+    case CompressionCodec::Stored:
+        dest.write(src, size);
+        return std::move(dest);
+    case CompressionCodec::Fast: {
+        bmcl::Buffer compressed = lzCompress(src, size);
+        dest.write(compressed.data(), compressed.size());
+        return std::move(dest);
+    }
+    case CompressionCodec::Zpaq: {
+        ZpaqResult compressed = zpaqCompress(src, size, zpaqLevel, numJobs);
+        if (compressed.isErr()) {
+            return compressed.unwrapErr();
+        }
+        dest.write(compressed.unwrap().data(), compressed.unwrap().size());
+        return std::move(dest);
+    }
+    }
+    return std::string("Unknown compression codec");
+}
+
+CompressionResult decompressData(const void* src, std::size_t size, std::size_t numJobs, CompressionCodec* codec)
+{
+    if (size < compressionMagic.size() || std::memcmp(src, compressionMagic.data(), compressionMagic.size()) != 0) {
+        if (codec) {
+            *codec = CompressionCodec::Zpaq;
+        }
+        return zpaqDecompress(src, size, numJobs);
+    }
+
+    bmcl::MemReader reader(src, size);
+    reader.skip(compressionMagic.size());
+    if (reader.isEmpty()) {
+        return std::string("Unexpected EOF reading compression codec");
+    }
+    std::uint8_t codecValue = reader.readUint8();
+    std::uint64_t decompressedSize;
+    if (!reader.readVarUint(&decompressedSize)) {
+        return std::string("Error reading decompressed size");
+    }
+
+    if (codecValue > (std::uint8_t)CompressionCodec::Zpaq) {
+        return "Unknown compression codec " + std::to_string(codecValue);
+    }
+    if (codec) {
+        *codec = (CompressionCodec)codecValue;
+    }
+
+    switch ((CompressionCodec)codecValue) {
+    case CompressionCodec::Stored: {
+        if (reader.readableSize() != decompressedSize) {
+            return std::string("Stored data size does not match header");
+        }
+        bmcl::Buffer dest;
+        dest.write(reader.current(), reader.readableSize());
+        return std::move(dest);
+    }
+    case CompressionCodec::Fast:
+        return lzDecompress(reader.current(), reader.readableSize(), decompressedSize);
+    case CompressionCodec::Zpaq: {
+        ZpaqResult decompressed = zpaqDecompress(reader.current(), reader.readableSize(), numJobs);
+        if (decompressed.isOk() && decompressed.unwrap().size() != decompressedSize) {
+            return std::string("Decompressed data size does not match header");
+        }
+        return decompressed;
+    }
+    }
+    return std::string("Unknown compression codec");
+}
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/CompressionCodec.h"
+
+#include <bmcl/Fwd.h>
+
+#include <cstddef>
+#include <string>
+
+namespace decode {
+
+using CompressionResult = bmcl::Result<bmcl::Buffer, std::string>;
+
+const char* compressionCodecName(CompressionCodec codec);
+
+// output starts with header that records codec and decompressed size
+// zpaqLevel is ignored by other codecs, zpaq blocks are processed using up to numJobs threads
+CompressionResult compressData(CompressionCodec codec, const void* src, std::size_t size, unsigned zpaqLevel, std::size_t numJobs = 1);
+// data without header is decompressed as zpaq archive, codec is set to used codec if not null
+CompressionResult decompressData(const void* src, std::size_t size, std::size_t numJobs = 1, CompressionCodec* codec = nullptr);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace decode {
+
+// values are stored in compressed data header
+enum class CompressionCodec {
+    // data is stored as is
+    Stored = 0,
+    // in-tree lz codec, fast compression and decompression
+    Fast = 1,
+    // zpaq with configured compression level, best ratio
+    Zpaq = 2,
+};
+}
@@ -13,6 +13,10 @@ namespace decode {
 Configuration::Configuration()
     : _codeDebugLevel(0)
     , _compressionLevel(5)
+    , _compressionCodec(CompressionCodec::Zpaq)
+    , _lexerBackend(LexerBackend::Scanner)
+    , _packageEncoding(PackageEncoding::Sources)
+    , _numJobs(1)
     , _verboseOutput(false)
 {
     setCfgOption("target_pointer_width", "32");
@@ -85,6 +89,59 @@ unsigned Configuration::compressionLevel() const
     return _compressionLevel;
 }
 
+void Configuration::setCompressionCodec(CompressionCodec codec)
+{
+    _compressionCodec = codec;
+}
+
+CompressionCodec Configuration::compressionCodec() const
+{
+    return _compressionCodec;
+}
+
+void Configuration::setLexerBackend(LexerBackend backend)
+{
+    _lexerBackend = backend;
+}
+
+LexerBackend Configuration::lexerBackend() const
+{
+    return _lexerBackend;
+}
+
+void Configuration::setPackageEncoding(PackageEncoding encoding)
+{
+    _packageEncoding = encoding;
+}
+
+PackageEncoding Configuration::packageEncoding() const
+{
+    return _packageEncoding;
+}
+
+void Configuration::setNumJobs(std::size_t num)
+{
+    _numJobs = num;
+}
+
+std::size_t Configuration::numJobs() const
+{
+    return _numJobs;
+}
+
+void Configuration::setParseCacheDir(bmcl::StringView path)
+{
+    _parseCacheDir.emplace(path.toStdString());
+}
+
+bmcl::Option<const std::string&> Configuration::parseCacheDir() const
+{
+    if (_parseCacheDir.isSome()) {
+        return _parseCacheDir.unwrap();
+    }
+    return bmcl::None;
+}
+
 Configuration::OptionsConstIterator Configuration::optionsBegin() const
 {
     return _values.cbegin();
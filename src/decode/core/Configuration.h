@@ -12,6 +12,9 @@
 #include "decode/core/Rc.h"
 #include "decode/core/Iterator.h"
 #include "decode/core/HashMap.h"
+#include "decode/core/LexerBackend.h"
+#include "decode/core/PackageEncoding.h"
+#include "decode/core/CompressionCodec.h"
 
 #include <bmcl/StringView.h>
 #include <bmcl/Option.h>
@@ -52,12 +55,32 @@ public:
     void setCompressionLevel(unsigned level);
     unsigned compressionLevel() const;
 
+    void setCompressionCodec(CompressionCodec codec);
+    CompressionCodec compressionCodec() const;
+
+    void setLexerBackend(LexerBackend backend);
+    LexerBackend lexerBackend() const;
+
+    void setPackageEncoding(PackageEncoding encoding);
+    PackageEncoding packageEncoding() const;
+
+    void setNumJobs(std::size_t num);
+    std::size_t numJobs() const;
+
+    void setParseCacheDir(bmcl::StringView path);
+    bmcl::Option<const std::string&> parseCacheDir() const;
+
     std::size_t numOptions() const;
 
 private:
     Options _values;
     unsigned _codeDebugLevel;
     unsigned _compressionLevel;
+    CompressionCodec _compressionCodec;
+    LexerBackend _lexerBackend;
+    PackageEncoding _packageEncoding;
+    std::size_t _numJobs;
+    bmcl::Option<std::string> _parseCacheDir;
     bool _verboseOutput;
 };
 }
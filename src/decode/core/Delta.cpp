@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Delta.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/Bytes.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace decode {
+
+// delta starts with varuint target size, operations follow
+// every operation starts with varuint (size << 1) | isCopy
+// copy is followed by varint base offset relative to end of previous copy, insert is followed by inserted bytes
+constexpr std::size_t minCopySize = 16;
+constexpr std::size_t hashBits = 20;
+
+static inline std::size_t hashBlock(const std::uint8_t* src)
+{
+    std::uint64_t first;
+    std::uint64_t second;
+    std::memcpy(&first, src, sizeof(first));
+    std::memcpy(&second, src + sizeof(first), sizeof(second));
+    std::uint64_t value = (first ^ (second * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;
+    return value >> (64 - hashBits);
+}
+
+static void writeInsert(const std::uint8_t* data, std::size_t size, bmcl::Buffer* dest)
+{
+    if (size == 0) {
+        return;
+    }
+    dest->writeVarUint(size << 1);
+    dest->write(data, size);
+}
+
+bmcl::Buffer deltaEncode(bmcl::Bytes base, bmcl::Bytes target)
+{
+    bmcl::Buffer dest;
+    dest.writeVarUint(target.size());
+    std::vector<std::size_t> table;
+    if (base.size() >= minCopySize) {
+        table.resize(std::size_t(1) << hashBits, SIZE_MAX);
+        for (std::size_t i = 0; i <= base.size() - minCopySize; i++) {
+            table[hashBlock(base.data() + i)] = i;
+        }
+    }
+
+    std::size_t pos = 0;
+    std::size_t insertStart = 0;
+    std::size_t lastCopyEnd = 0;
+    while (!table.empty() && target.size() >= minCopySize && pos <= target.size() - minCopySize) {
+        std::size_t candidate = table[hashBlock(target.data() + pos)];
+        if (candidate == SIZE_MAX || std::memcmp(base.data() + candidate, target.data() + pos, minCopySize) != 0) {
+            pos++;
+            continue;
+        }
+
+        std::size_t start = pos;
+        std::size_t baseStart = candidate;
+        while (start > insertStart && baseStart > 0 && target[start - 1] == base[baseStart - 1]) {
+            start--;
+            baseStart--;
+        }
+        std::size_t size = pos + minCopySize - start;
+        while (start + size < target.size() && baseStart + size < base.size() && target[start + size] == base[baseStart + size]) {
+            size++;
+        }
+
+        writeInsert(target.data() + insertStart, start - insertStart, &dest);
+        dest.writeVarUint((size << 1) | 1);
+        dest.writeVarInt(std::int64_t(baseStart) - std::int64_t(lastCopyEnd));
+        lastCopyEnd = baseStart + size;
+        pos = start + size;
+        insertStart = pos;
+    }
+
+    writeInsert(target.data() + insertStart, target.size() - insertStart, &dest);
+    return dest;
+}
+
+DeltaResult deltaApply(bmcl::Bytes base, bmcl::Bytes delta)
+{
+    bmcl::MemReader reader(delta.data(), delta.size());
+    std::uint64_t targetSize;
+    if (!reader.readVarUint(&targetSize)) {
+        return std::string("Error reading target size");
+    }
+    bmcl::Buffer dest;
+    std::int64_t lastCopyEnd = 0;
+    while (!reader.isEmpty()) {
+        std::uint64_t op;
+        if (!reader.readVarUint(&op)) {
+            return std::string("Error reading delta operation");
+        }
+        std::uint64_t size = op >> 1;
+        if (size > targetSize - dest.size()) {
+            return std::string("Delta exceeds target size");
+        }
+        if ((op & 1) == 0) {
+            if (size > reader.readableSize()) {
+                return std::string("Unexpected EOF reading inserted data");
+            }
+            dest.write(reader.current(), size);
+            reader.skip(size);
+            continue;
+        }
+
+        std::int64_t offset;
+        if (!reader.readVarInt(&offset)) {
+            return std::string("Error reading copy offset");
+        }
+        // lastCopyEnd is always within base, offset is checked before adding so that it can't overflow
+        if (offset < -lastCopyEnd || offset > std::int64_t(base.size()) - lastCopyEnd) {
+            return std::string("Copied data is out of base bounds");
+        }
+        std::uint64_t start = lastCopyEnd + offset;
+        if (size > base.size() - start) {
+            return std::string("Copied data is out of base bounds");
+        }
+        dest.write(base.data() + start, size);
+        lastCopyEnd = start + size;
+    }
+    if (dest.size() != targetSize) {
+        return std::string("Unexpected EOF reading delta operations");
+    }
+    return std::move(dest);
+}
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <bmcl/Fwd.h>
+
+#include <string>
+
+namespace decode {
+
+using DeltaResult = bmcl::Result<bmcl::Buffer, std::string>;
+
+// target size and list of copy and insert operations that turns base into target
+// only byte runs of at least 16 bytes are copied from base, everything else is inserted
+// deltaApply rejects deltas that are truncated, read out of base bounds or produce data of wrong size
+bmcl::Buffer deltaEncode(bmcl::Bytes base, bmcl::Bytes target);
+DeltaResult deltaApply(bmcl::Bytes base, bmcl::Bytes delta);
+}
@@ -58,10 +58,14 @@ void Report::printReport(std::ostream* out, bmcl::ColorStream* colorStream) cons
         *colorStream << bmcl::ColorAttr::Reset;
         *colorStream << bmcl::ColorAttr::Bright;
     }
+    bmcl::Option<LineColumn> pos;
+    if (!_fileInfo.isNull() && _location.isSome()) {
+        pos.emplace(_fileInfo->lineColumnOf(_location.unwrap()));
+    }
     if (!_fileInfo.isNull()) {
         *out << _fileInfo->fileName();
-        if (_location.isSome()) {
-            *out << ':' << _location->line << ':' << _location->column << ": ";
+        if (pos.isSome()) {
+            *out << ':' << pos->line << ':' << pos->column << ": ";
         } else {
             *out << ": ";
         }
@@ -99,20 +103,20 @@ void Report::printReport(std::ostream* out, bmcl::ColorStream* colorStream) cons
         }
         *out << _message.unwrap();
     }
-    if (_location.isSome()) {
+    if (pos.isSome()) {
         if (_message.isSome()) {
             *out << std::endl;
         }
         if (colorStream) {
             *colorStream << bmcl::ColorAttr::Reset;
         }
-        bmcl::StringView line = _fileInfo->lines()[_location->line - 1];
+        bmcl::StringView line = _fileInfo->lineAt(pos->line);
         *out << line.toStdString() << std::endl;
         if (colorStream) {
             *colorStream << bmcl::ColorAttr::FgGreen << bmcl::ColorAttr::Bright;
         }
-        BMCL_ASSERT(_location->column >= 1);
-        std::string prefix(_location->column - 1, ' ');
+        BMCL_ASSERT(pos->column >= 1);
+        std::string prefix(pos->column - 1, ' ');
         std::string arrows(_locSize, '^');
         *out << prefix << arrows << std::endl;
     }
@@ -148,6 +152,12 @@ void Diagnostics::printReports(std::ostream* out) const
     }
 }
 
+void Diagnostics::takeReportsFrom(Diagnostics* other)
+{
+    _reports.insert(_reports.end(), other->_reports.begin(), other->_reports.end());
+    other->_reports.clear();
+}
+
 Rc<Report> Diagnostics::buildSystemErrorReport(bmcl::StringView msg, bmcl::StringView reason)
 {
     Rc<Report> report = addReport();
@@ -85,6 +85,9 @@ public:
 
     void printReports(std::ostream* out) const;
 
+    // moves all reports from other to the end of this report list
+    void takeReportsFrom(Diagnostics* other);
+
 private:
     std::vector<Rc<Report>> _reports;
 };
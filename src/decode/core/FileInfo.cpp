@@ -8,21 +8,137 @@
 
 #include "decode/core/FileInfo.h"
 
+#include <bmcl/Assert.h>
+#include <bmcl/FileUtils.h>
+#include <bmcl/Result.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#elif defined(_MSC_VER) || defined(__MINGW32__)
+# include <windows.h>
+#else
+# error "Unsupported OS"
+#endif
+
 namespace decode {
 
 FileInfo::FileInfo(std::string&& name, std::string&& contents)
     : _fileName(std::move(name))
     , _contents(std::move(contents))
+    , _view(_contents)
+    , _mapping(nullptr)
+    , _mappingSize(0)
+{
+}
+
+FileInfo::FileInfo(std::string&& name, const bmcl::SharedBytes& storage, bmcl::StringView contents)
+    : _fileName(std::move(name))
+    , _storage(storage)
+    , _view(contents)
+    , _mapping(nullptr)
+    , _mappingSize(0)
+{
+    BMCL_ASSERT(contents.isEmpty() || ((const std::uint8_t*)contents.begin() >= _storage.data() && (const std::uint8_t*)contents.end() <= _storage.data() + _storage.size()));
+}
+
+FileInfo::FileInfo(std::string&& name)
+    : _fileName(std::move(name))
+    , _mapping(nullptr)
+    , _mappingSize(0)
 {
 }
 
 FileInfo::~FileInfo()
 {
+    unmapFile();
+}
+
+FileInfoResult FileInfo::fromFile(const char* path)
+{
+    Rc<FileInfo> finfo = new FileInfo(std::string(path));
+    if (finfo->mapFile()) {
+        return finfo;
+    }
+
+    bmcl::Result<std::string, int> rv = bmcl::readFileIntoString(path);
+    if (rv.isErr()) {
+        return rv.unwrapErr();
+    }
+    finfo->_contents = rv.take();
+    finfo->_view = finfo->_contents;
+    return finfo;
+}
+
+// empty and non regular files are not mapped, caller falls back to reading
+bool FileInfo::mapFile()
+{
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+    int fd = open(_fileName.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    std::size_t size = st.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+#elif defined(_MSC_VER) || defined(__MINGW32__)
+    HANDLE file = CreateFileA(_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+        CloseHandle(file);
+        return false;
+    }
+    std::size_t size = fileSize.QuadPart;
+    HANDLE mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mappingHandle == NULL) {
+        return false;
+    }
+    void* mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mappingHandle);
+    if (mapping == NULL) {
+        return false;
+    }
+#endif
+    _mapping = mapping;
+    _mappingSize = size;
+    _view = bmcl::StringView((const char*)mapping, size);
+    return true;
 }
 
-const std::string& FileInfo::contents() const
+void FileInfo::unmapFile()
 {
-    return _contents;
+    if (!_mapping) {
+        return;
+    }
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+    munmap(_mapping, _mappingSize);
+#elif defined(_MSC_VER) || defined(__MINGW32__)
+    UnmapViewOfFile(_mapping);
+#endif
+    _mapping = nullptr;
+    _mappingSize = 0;
+}
+
+bmcl::StringView FileInfo::contents() const
+{
+    return _view;
 }
 
 const std::string& FileInfo::fileName() const
@@ -30,8 +146,62 @@ const std::string& FileInfo::fileName() const
     return _fileName;
 }
 
-const std::vector<bmcl::StringView>& FileInfo::lines() const
+bool FileInfo::isMapped() const
+{
+    return _mapping != nullptr;
+}
+
+void FileInfo::buildLineIndex() const
+{
+    const char* begin = _view.begin();
+    const char* end = _view.end();
+    _lineStarts.push_back(0);
+    const char* current = begin;
+    while (true) {
+        const void* eol = std::memchr(current, '\n', end - current);
+        if (!eol) {
+            break;
+        }
+        current = (const char*)eol + 1;
+        _lineStarts.push_back(current - begin);
+    }
+}
+
+const std::vector<std::uint32_t>& FileInfo::lineStarts() const
+{
+    std::call_once(_lineIndexFlag, &FileInfo::buildLineIndex, this);
+    return _lineStarts;
+}
+
+std::size_t FileInfo::linesNum() const
+{
+    return lineStarts().size();
+}
+
+bmcl::StringView FileInfo::lineAt(std::size_t line) const
+{
+    const std::vector<std::uint32_t>& starts = lineStarts();
+    BMCL_ASSERT(line >= 1 && line <= starts.size());
+    const char* begin = _view.begin() + starts[line - 1];
+    const char* end = line < starts.size() ? _view.begin() + starts[line] - 1 : _view.end();
+    if (begin != end && *(end - 1) == '\r') {
+        end--;
+    }
+    return bmcl::StringView(begin, end);
+}
+
+Location FileInfo::locationOf(const char* pos) const
+{
+    BMCL_ASSERT(pos >= _view.begin() && pos <= _view.end());
+    return Location(pos - _view.begin());
+}
+
+LineColumn FileInfo::lineColumnOf(Location loc) const
 {
-    return _lines;
+    const std::vector<std::uint32_t>& starts = lineStarts();
+    BMCL_ASSERT(loc.offset <= _view.size());
+    auto it = std::upper_bound(starts.begin(), starts.end(), loc.offset);
+    std::size_t line = it - starts.begin();
+    return LineColumn(line, loc.offset - starts[line - 1] + 1);
 }
 }
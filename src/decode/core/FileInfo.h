@@ -10,36 +10,63 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Location.h"
 
+#include <bmcl/Fwd.h>
 #include <bmcl/StringView.h>
+#include <bmcl/SharedBytes.h>
 
+#include <cstdint>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace decode {
 
+class FileInfo;
+
+using FileInfoResult = bmcl::Result<Rc<FileInfo>, int>;
+
 class FileInfo : public RefCountable {
 public:
     using Pointer = Rc<FileInfo>;
     using ConstPointer = Rc<const FileInfo>;
 
     FileInfo(std::string&& name, std::string&& contents);
+    // contents are not copied, storage is kept alive while file info exists
+    FileInfo(std::string&& name, const bmcl::SharedBytes& storage, bmcl::StringView contents);
     ~FileInfo();
 
+    // maps file into memory if possible, otherwise reads it into heap string
+    // returns system error code on failure
+    static FileInfoResult fromFile(const char* path);
+
     const std::string& fileName() const;
-    const std::string& contents() const;
-    const std::vector<bmcl::StringView>& lines() const;
+    bmcl::StringView contents() const;
+    bool isMapped() const;
 
-    template <typename... A>
-    void addLine(A&&... args)
-    {
-        _lines.emplace_back(std::forward<A>(args)...);
-    }
+    // line index is built on first call, lines are numbered from 1
+    std::size_t linesNum() const;
+    bmcl::StringView lineAt(std::size_t line) const;
+    Location locationOf(const char* pos) const;
+    LineColumn lineColumnOf(Location loc) const;
 
 private:
+    explicit FileInfo(std::string&& name);
+
+    bool mapFile();
+    void unmapFile();
+    void buildLineIndex() const;
+    const std::vector<std::uint32_t>& lineStarts() const;
+
     std::string _fileName;
     std::string _contents;
-    std::vector<bmcl::StringView> _lines;
+    bmcl::SharedBytes _storage;
+    bmcl::StringView _view;
+    void* _mapping;
+    std::size_t _mappingSize;
+    mutable std::once_flag _lineIndexFlag;
+    mutable std::vector<std::uint32_t> _lineStarts;
 };
 
 }
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace decode {
+
+enum class LexerBackend {
+    Scanner,
+    Pegtl,
+};
+}
@@ -14,16 +14,30 @@
 
 namespace decode {
 
+// byte offset in file contents, converted to line and column by FileInfo only when report is printed
 struct Location {
 public:
     Location() = default;
-    Location(std::size_t line, std::size_t column);
+    explicit Location(std::size_t offset);
+
+    std::size_t offset;
+};
+
+struct LineColumn {
+public:
+    LineColumn() = default;
+    LineColumn(std::size_t line, std::size_t column);
 
     std::size_t line;
     std::size_t column;
 };
 
-inline Location::Location(std::size_t line, std::size_t column)
+inline Location::Location(std::size_t offset)
+    : offset(offset)
+{
+}
+
+inline LineColumn::LineColumn(std::size_t line, std::size_t column)
     : line(line)
     , column(column)
 {
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Lz.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/Result.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace decode {
+
+// every sequence is a token followed by literals, match offset and match length
+// token holds literal length in high nibble and match length minus minMatch in low nibble,
+// nibble value 15 means that length continues in following bytes, each 255 byte adds 255
+// last sequence has no match, it ends with input
+constexpr std::size_t minMatch = 4;
+constexpr std::size_t maxOffset = 65535;
+constexpr std::size_t hashBits = 14;
+
+static inline std::uint32_t read32(const std::uint8_t* src)
+{
+    std::uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+static inline std::size_t hash32(std::uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - hashBits);
+}
+
+static void writeLength(std::size_t length, bmcl::Buffer* dest)
+{
+    while (length >= 255) {
+        dest->writeUint8(255);
+        length -= 255;
+    }
+    dest->writeUint8(length);
+}
+
+static void writeSequence(const std::uint8_t* literals, std::size_t literalsSize, std::size_t offset, std::size_t matchSize, bmcl::Buffer* dest)
+{
+    std::size_t matchLength = matchSize == 0 ? 0 : matchSize - minMatch;
+    std::uint8_t token = (std::min<std::size_t>(literalsSize, 15) << 4) | std::min<std::size_t>(matchLength, 15);
+    dest->writeUint8(token);
+    if (literalsSize >= 15) {
+        writeLength(literalsSize - 15, dest);
+    }
+    dest->write(literals, literalsSize);
+    if (matchSize == 0) {
+        return;
+    }
+    dest->writeUint8(offset & 0xff);
+    dest->writeUint8(offset >> 8);
+    if (matchLength >= 15) {
+        writeLength(matchLength - 15, dest);
+    }
+}
+
+bmcl::Buffer lzCompress(const void* src, std::size_t size)
+{
+    const std::uint8_t* data = (const std::uint8_t*)src;
+    bmcl::Buffer dest;
+    std::vector<std::size_t> table(std::size_t(1) << hashBits, SIZE_MAX);
+
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    while (size >= minMatch && pos <= size - minMatch) {
+        std::uint32_t value = read32(data + pos);
+        std::size_t& entry = table[hash32(value)];
+        std::size_t candidate = entry;
+        entry = pos;
+        if (candidate == SIZE_MAX || pos - candidate > maxOffset || read32(data + candidate) != value) {
+            pos++;
+            continue;
+        }
+
+        std::size_t matchSize = minMatch;
+        while (pos + matchSize < size && data[candidate + matchSize] == data[pos + matchSize]) {
+            matchSize++;
+        }
+        writeSequence(data + anchor, pos - anchor, pos - candidate, matchSize, &dest);
+        pos += matchSize;
+        anchor = pos;
+    }
+
+    if (anchor < size) {
+        writeSequence(data + anchor, size - anchor, 0, 0, &dest);
+    }
+    return dest;
+}
+
+static bool readLength(const std::uint8_t** current, const std::uint8_t* end, std::size_t* length)
+{
+    while (true) {
+        if (*current == end) {
+            return false;
+        }
+        std::uint8_t value = **current;
+        (*current)++;
+        *length += value;
+        if (value != 255) {
+            return true;
+        }
+    }
+}
+
+LzResult lzDecompress(const void* src, std::size_t size, std::size_t decompressedSize)
+{
+    const std::uint8_t* current = (const std::uint8_t*)src;
+    const std::uint8_t* end = current + size;
+    std::vector<std::uint8_t> dest;
+    // decompressed size comes from untrusted header, every compressed byte expands to at most 255 bytes
+    dest.reserve(std::min(decompressedSize, size * 255));
+
+    while (current != end) {
+        std::uint8_t token = *current++;
+        std::size_t literalsSize = token >> 4;
+        if (literalsSize == 15 && !readLength(&current, end, &literalsSize)) {
+            return std::string("Unexpected EOF reading literal length");
+        }
+        if (literalsSize > std::size_t(end - current)) {
+            return std::string("Unexpected EOF reading literals");
+        }
+        if (literalsSize > decompressedSize - dest.size()) {
+            return std::string("Decompressed data is larger than expected");
+        }
+        dest.insert(dest.end(), current, current + literalsSize);
+        current += literalsSize;
+        if (current == end) {
+            break;
+        }
+
+        if (end - current < 2) {
+            return std::string("Unexpected EOF reading match offset");
+        }
+        std::size_t offset = current[0] | (current[1] << 8);
+        current += 2;
+        if (offset == 0 || offset > dest.size()) {
+            return std::string("Invalid match offset");
+        }
+        std::size_t matchSize = token & 0xf;
+        if (matchSize == 15 && !readLength(&current, end, &matchSize)) {
+            return std::string("Unexpected EOF reading match length");
+        }
+        matchSize += minMatch;
+        if (matchSize > decompressedSize - dest.size()) {
+            return std::string("Decompressed data is larger than expected");
+        }
+        // match can overlap with data it produces
+        std::size_t from = dest.size() - offset;
+        for (std::size_t i = 0; i < matchSize; i++) {
+            dest.push_back(dest[from + i]);
+        }
+    }
+
+    if (dest.size() != decompressedSize) {
+        return std::string("Decompressed data is smaller than expected");
+    }
+    bmcl::Buffer result;
+    result.write(dest.data(), dest.size());
+    return std::move(result);
+}
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <bmcl/Fwd.h>
+
+#include <cstddef>
+#include <string>
+
+namespace decode {
+
+using LzResult = bmcl::Result<bmcl::Buffer, std::string>;
+
+// byte oriented lz77 with 64k window, trades ratio for speed
+bmcl::Buffer lzCompress(const void* src, std::size_t size);
+// decompressedSize is size of original data, it is not stored by lzCompress
+LzResult lzDecompress(const void* src, std::size_t size, std::size_t decompressedSize);
+}
@@ -10,12 +10,13 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Arena.h"
 
 #include <bmcl/StringView.h>
 
 namespace decode {
 
-class NamedRc : public RefCountable {
+class NamedRc : public RefCountable, public ArenaAllocated {
 public:
     using Pointer = Rc<NamedRc>;
     using ConstPointer = Rc<const NamedRc>;
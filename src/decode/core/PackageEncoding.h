@@ -0,0 +1,13 @@
+#pragma once
+
+namespace decode {
+
+enum class PackageEncoding {
+    // module sources, parsed on load
+    Sources,
+    // module sources with table of module imports, allows loading only required modules
+    Indexed,
+    // indexed module sources with serialized parser output, parser is skipped on load
+    Preparsed,
+};
+}
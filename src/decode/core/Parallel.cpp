@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace decode {
+
+void parallelFor(std::size_t numJobs, std::size_t count, const std::function<void(std::size_t, std::size_t)>& func)
+{
+    numJobs = std::min(numJobs, count);
+    if (numJobs <= 1) {
+        for (std::size_t i = 0; i < count; i++) {
+            func(i, 0);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> nextIndex(0);
+    auto worker = [&](std::size_t workerIndex) {
+        while (true) {
+            std::size_t i = nextIndex.fetch_add(1);
+            if (i >= count) {
+                return;
+            }
+            func(i, workerIndex);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numJobs - 1);
+    for (std::size_t i = 1; i < numJobs; i++) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+}
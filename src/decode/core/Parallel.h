@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace decode {
+
+// calls func(index, worker) for every index in [0, count) using up to numJobs threads
+// worker is in [0, numJobs) and is unique for every running thread
+// indexes are handed out in increasing order, func is called on current thread if numJobs <= 1
+void parallelFor(std::size_t numJobs, std::size_t count, const std::function<void(std::size_t, std::size_t)>& func);
+}
@@ -2,6 +2,7 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/Arena.h"
 #include "decode/core/Utils.h"
 
 #include <bmcl/Variant.h>
@@ -24,7 +25,7 @@ using NumberVariant =
         bmcl::VariantElementDesc<NumberVariantKind, double, NumberVariantKind::Double>
     >;
 
-class RangeAttr : public RefCountable {
+class RangeAttr : public RefCountable, public ArenaAllocated {
 public:
     RangeAttr();
     ~RangeAttr();
@@ -11,7 +11,11 @@
 #include "decode/Config.h"
 
 #include <bmcl/Rc.h>
-#include <bmcl/ThreadSafeRefCountable.h>
+#ifdef DECODE_NON_ATOMIC_RC
+# include <bmcl/RefCountable.h>
+#else
+# include <bmcl/ThreadSafeRefCountable.h>
+#endif
 
 #include <utility>
 
@@ -20,7 +24,15 @@ namespace decode {
 template <typename T>
 using Rc = bmcl::Rc<T>;
 
+// selected by DECODE_ATOMIC_RC build option
+// with non atomic reference counting objects must not be shared between threads
+#ifdef DECODE_NON_ATOMIC_RC
+using RefCountable = bmcl::RefCountable<std::size_t>;
+constexpr bool isRcThreadSafe = false;
+#else
 using RefCountable = bmcl::ThreadSafeRefCountable<std::size_t>;
+constexpr bool isRcThreadSafe = true;
+#endif
 
 template <typename T, typename... A>
 Rc<T> makeRc(A&&... args)
@@ -202,6 +202,13 @@ std::string StringBuilder::toStdString() const
     return _output;
 }
 
+std::string StringBuilder::takeStdString()
+{
+    std::string result = std::move(_output);
+    _output.clear();
+    return result;
+}
+
 constexpr const char* chars = "0123456789abcdef";
 
 void StringBuilder::appendHexValue(uint8_t value)
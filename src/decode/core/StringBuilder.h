@@ -96,6 +96,8 @@ public:
     void removeFromBack(std::size_t size);
 
     std::string toStdString() const;
+    // moves built string out, builder is left empty
+    std::string takeStdString();
 
 private:
     template <typename T>
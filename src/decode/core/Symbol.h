@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace decode {
+
+// id of interned string, equal strings interned in the same SymbolTable have equal ids
+class Symbol {
+public:
+    Symbol()
+        : _id(0)
+    {
+    }
+
+    explicit Symbol(std::uint32_t id)
+        : _id(id)
+    {
+    }
+
+    std::uint32_t id() const
+    {
+        return _id;
+    }
+
+    bool isValid() const
+    {
+        return _id != 0;
+    }
+
+    bool operator==(Symbol other) const
+    {
+        return _id == other._id;
+    }
+
+    bool operator!=(Symbol other) const
+    {
+        return _id != other._id;
+    }
+
+private:
+    std::uint32_t _id;
+};
+}
+
+namespace std {
+
+template <>
+struct hash<decode::Symbol> {
+    std::size_t operator()(decode::Symbol symbol) const
+    {
+        return std::hash<std::uint32_t>()(symbol.id());
+    }
+};
+}
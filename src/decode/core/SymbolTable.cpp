@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/SymbolTable.h"
+
+#include <bmcl/Assert.h>
+#include <bmcl/Option.h>
+
+#include <cstring>
+
+namespace decode {
+
+static constexpr std::size_t symbolChunkSize = 4096;
+
+SymbolTable::SymbolTable()
+    : _chunkCurrent(nullptr)
+    , _chunkFreeSize(0)
+{
+    // id 0 is reserved for invalid symbol
+    _strings.emplace_back();
+}
+
+SymbolTable::~SymbolTable()
+{
+}
+
+bmcl::StringView SymbolTable::copyString(bmcl::StringView str)
+{
+    if (str.size() > symbolChunkSize / 4) {
+        _chunks.emplace_back(new char[str.size()]);
+        std::memcpy(_chunks.back().get(), str.data(), str.size());
+        return bmcl::StringView(_chunks.back().get(), str.size());
+    }
+    if (str.size() > _chunkFreeSize) {
+        _chunks.emplace_back(new char[symbolChunkSize]);
+        _chunkCurrent = _chunks.back().get();
+        _chunkFreeSize = symbolChunkSize;
+    }
+    char* dest = _chunkCurrent;
+    std::memcpy(dest, str.data(), str.size());
+    _chunkCurrent += str.size();
+    _chunkFreeSize -= str.size();
+    return bmcl::StringView(dest, str.size());
+}
+
+Symbol SymbolTable::intern(bmcl::StringView str)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _symbols.find(str);
+    if (it != _symbols.end()) {
+        return it->second;
+    }
+    Symbol symbol(_strings.size());
+    bmcl::StringView copy = copyString(str);
+    _strings.push_back(copy);
+    _symbols.emplace(copy, symbol);
+    return symbol;
+}
+
+bmcl::Option<Symbol> SymbolTable::find(bmcl::StringView str) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _symbols.find(str);
+    if (it == _symbols.end()) {
+        return bmcl::None;
+    }
+    return it->second;
+}
+
+bmcl::StringView SymbolTable::str(Symbol symbol) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    BMCL_ASSERT(symbol.id() < _strings.size());
+    return _strings[symbol.id()];
+}
+
+std::size_t SymbolTable::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _strings.size() - 1;
+}
+}
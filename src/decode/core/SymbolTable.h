@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/Symbol.h"
+#include "decode/core/HashMap.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/StringView.h>
+#include <bmcl/StringViewHash.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace decode {
+
+// package wide string interner, safe to use from multiple threads
+// interned strings are copied and live as long as the table
+class SymbolTable : public RefCountable {
+public:
+    using Pointer = Rc<SymbolTable>;
+    using ConstPointer = Rc<const SymbolTable>;
+
+    SymbolTable();
+    ~SymbolTable();
+
+    Symbol intern(bmcl::StringView str);
+    bmcl::Option<Symbol> find(bmcl::StringView str) const;
+    bmcl::StringView str(Symbol symbol) const;
+    std::size_t size() const;
+
+private:
+    bmcl::StringView copyString(bmcl::StringView str);
+
+    mutable std::mutex _mutex;
+    HashMap<bmcl::StringView, Symbol> _symbols;
+    std::vector<bmcl::StringView> _strings;
+    std::vector<std::unique_ptr<char[]>> _chunks;
+    char* _chunkCurrent;
+    std::size_t _chunkFreeSize;
+};
+}
@@ -14,6 +14,10 @@
 #include <bmcl/Result.h>
 #include <bmcl/StringView.h>
 
+#include <cstdio>
+#include <cstring>
+#include <random>
+
 #if defined(__linux__)
 # include <sys/stat.h>
 # include <fcntl.h>
@@ -218,6 +222,106 @@ bool saveOutput(const char* path, bmcl::Bytes output, Diagnostics* diag)
     return true;
 }
 
+static bool hasSameContents(const char* path, bmcl::Bytes output)
+{
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    bool isSame = std::fseek(file, 0, SEEK_END) == 0 && std::ftell(file) == long(output.size()) && std::fseek(file, 0, SEEK_SET) == 0;
+    std::size_t offset = 0;
+    while (isSame && offset < output.size()) {
+        char temp[4096];
+        std::size_t size = std::fread(temp, 1, sizeof(temp), file);
+        if (size == 0 || size > output.size() - offset || std::memcmp(temp, output.data() + offset, size) != 0) {
+            isSame = false;
+        }
+        offset += size;
+    }
+    std::fclose(file);
+    return isSame;
+}
+
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+// replaced file keeps its permissions, temporary file is created with default mode
+static bool copyFileMode(const char* from, const char* to, Diagnostics* diag)
+{
+    int fdFrom = open(from, O_RDONLY);
+    if (fdFrom == -1) {
+        int rn = errno;
+        if (rn == ENOENT) {
+            return true;
+        }
+        diag->buildSystemFileErrorReport("failed to open file", rn, from);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fdFrom, &st) == -1) {
+        int rn = errno;
+        close(fdFrom);
+        diag->buildSystemFileErrorReport("failed to get file mode", rn, from);
+        return false;
+    }
+    close(fdFrom);
+
+    int fdTo = open(to, O_WRONLY);
+    if (fdTo == -1) {
+        int rn = errno;
+        diag->buildSystemFileErrorReport("failed to open file", rn, to);
+        return false;
+    }
+    if (fchmod(fdTo, st.st_mode & 07777) == -1) {
+        int rn = errno;
+        close(fdTo);
+        diag->buildSystemFileErrorReport("failed to set file mode", rn, to);
+        return false;
+    }
+    close(fdTo);
+    return true;
+}
+#endif
+
+bool saveOutputIfChanged(const std::string& path, bmcl::Bytes output, bool* isWritten, Diagnostics* diag)
+{
+    return saveOutputIfChanged(path.c_str(), output, isWritten, diag);
+}
+
+bool saveOutputIfChanged(const char* path, bmcl::Bytes output, bool* isWritten, Diagnostics* diag)
+{
+    if (hasSameContents(path, output)) {
+        *isWritten = false;
+        return true;
+    }
+
+    std::string tmpPath = std::string(path) + "." + std::to_string(std::random_device()()) + ".tmp";
+    if (!saveOutput(tmpPath, output, diag)) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+    if (!copyFileMode(path, tmpPath.c_str(), diag)) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    if (std::rename(tmpPath.c_str(), path) != 0) {
+        int rn = errno;
+        std::remove(tmpPath.c_str());
+        diag->buildSystemFileErrorReport("failed to replace file", rn, path);
+        return false;
+    }
+#elif defined(_MSC_VER) || defined(__MINGW32__)
+    if (!MoveFileExA(tmpPath.c_str(), path, MOVEFILE_REPLACE_EXISTING)) {
+        DWORD rn = GetLastError();
+        std::remove(tmpPath.c_str());
+        diag->buildSystemFileErrorReport("failed to replace file", rn, path);
+        return false;
+    }
+#endif
+    *isWritten = true;
+    return true;
+}
+
 bool copyFile(const char* from, const char* to, Diagnostics* diag)
 {
 #if defined(__linux__) || defined (BMCL_PLATFORM_APPLE)
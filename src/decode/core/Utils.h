@@ -31,6 +31,10 @@ bool saveOutput(const std::string& path, bmcl::StringView output, Diagnostics* d
 bool saveOutput(const char* path, bmcl::StringView output, Diagnostics* diag);
 bool saveOutput(const std::string& path, bmcl::Bytes output, Diagnostics* diag);
 bool saveOutput(const char* path, bmcl::Bytes output, Diagnostics* diag);
+// keeps existing file untouched if it has same contents, otherwise writes temporary file and renames it over old one
+// isWritten is set to false if file was left untouched
+bool saveOutputIfChanged(const std::string& path, bmcl::Bytes output, bool* isWritten, Diagnostics* diag);
+bool saveOutputIfChanged(const char* path, bmcl::Bytes output, bool* isWritten, Diagnostics* diag);
 bool copyFile(const char* from, const char* to, Diagnostics* diag);
 
 }
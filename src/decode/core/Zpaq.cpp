@@ -7,13 +7,20 @@
  */
 
 #include "decode/core/Zpaq.h"
+#include "decode/core/Parallel.h"
 
 #include <bmcl/Buffer.h>
-#include <bmcl/MemReader.h>
 #include <bmcl/Result.h>
 
 #include <libzpaq.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
 void libzpaq::error(const char* msg)
 {
     throw std::runtime_error(msg);
@@ -23,81 +30,190 @@ namespace decode {
 
 class ZpaqReader : public libzpaq::Reader {
 public:
-    explicit ZpaqReader(const bmcl::Buffer& buf)
-        : _reader(buf.data(), buf.size())
-    {
-    }
-
     ZpaqReader(const void* src, std::size_t size)
-        : _reader(src, size)
+        : _current((const std::uint8_t*)src)
+        , _end(_current + size)
     {
     }
 
     int get() override
     {
-        if (_reader.isEmpty()) {
+        if (_current == _end) {
             return -1;
         }
-        return _reader.readUint8();
+        return *_current++;
     }
 
     int read(char* buf, int n) override
     {
-        std::size_t size = std::min<std::size_t>(n, _reader.readableSize());
-        _reader.read(buf, size);
+        std::size_t size = std::min<std::size_t>(n, _end - _current);
+        std::memcpy(buf, _current, size);
+        _current += size;
         return size;
     }
 
 private:
-    bmcl::MemReader _reader;
+    const std::uint8_t* _current;
+    const std::uint8_t* _end;
 };
 
+// libzpaq writes most of its output byte by byte, collect it in a local chunk
 class ZpaqWriter : public libzpaq::Writer {
 public:
     explicit ZpaqWriter(bmcl::Buffer* buf)
         : _buf(buf)
+        , _chunkSize(0)
     {
     }
 
+    ~ZpaqWriter()
+    {
+        flush();
+    }
+
     void put(int c) override
     {
-        _buf->writeUint8(c);
+        if (_chunkSize == _chunk.size()) {
+            flush();
+        }
+        _chunk[_chunkSize++] = c;
     }
 
     void write(const char* buf, int n) override
     {
+        flush();
         _buf->write(buf, n);
     }
 
+    void flush()
+    {
+        _buf->write(_chunk.data(), _chunkSize);
+        _chunkSize = 0;
+    }
+
 private:
     bmcl::Buffer* _buf;
+    std::array<std::uint8_t, 4096> _chunk;
+    std::size_t _chunkSize;
 };
 
-ZpaqResult zpaqDecompress(const void* src, std::size_t size)
+// locator tag followed by block header, libzpaq finds blocks the same way
+const std::array<std::uint8_t, 16> blockMarker = {{0x37, 0x6b, 0x53, 0x74, 0xa0, 0x31, 0x83, 0xd3, 0x8c, 0xb2, 0x28, 0xb0, 0xd3, 0x7a, 0x50, 0x51}};
+constexpr std::size_t tagSize = 13;
+
+static std::string decompressRange(const void* src, std::size_t size, bmcl::Buffer* dest)
 {
-    bmcl::Buffer buf;
     ZpaqReader in(src, size);
-    ZpaqWriter out(&buf);
+    ZpaqWriter out(dest);
 
+    // same as libzpaq::decompress, except that data without blocks is not accepted as empty archive
     try {
-        libzpaq::decompress(&in, &out);
+        libzpaq::Decompresser decompresser;
+        decompresser.setInput(&in);
+        decompresser.setOutput(&out);
+        if (!decompresser.findBlock()) {
+            return std::string("No zpaq blocks found");
+        }
+        do {
+            while (decompresser.findFilename()) {
+                decompresser.readComment();
+                decompresser.decompress();
+                decompresser.readSegmentEnd();
+            }
+        } while (decompresser.findBlock());
     } catch (const std::exception& err) {
-        return std::string(err.what());
+        return err.what();
     }
-    return buf;
+    return std::string();
 }
 
-ZpaqResult zpaqCompress(const void* src, std::size_t size, unsigned compressionLevel)
+ZpaqResult zpaqDecompress(const void* src, std::size_t size, std::size_t numJobs)
 {
+    // first block may be untagged, every other block starts with marker
+    const std::uint8_t* begin = (const std::uint8_t*)src;
+    const std::uint8_t* end = begin + size;
+    std::vector<const std::uint8_t*> starts;
+    starts.push_back(begin);
+    const std::uint8_t* it = begin + 1;
+    while (true) {
+        it = std::search(it, end, blockMarker.begin(), blockMarker.end());
+        if (it == end) {
+            break;
+        }
+        starts.push_back(it);
+        it++;
+    }
+    starts.push_back(end);
+
+    std::size_t numBlocks = starts.size() - 1;
+    std::vector<bmcl::Buffer> blocks(numBlocks);
+    std::vector<std::string> errors(numBlocks);
+    parallelFor(numJobs, numBlocks, [&](std::size_t i, std::size_t) {
+        errors[i] = decompressRange(starts[i], starts[i + 1] - starts[i], &blocks[i]);
+    });
+
+    bool hasErrors = std::any_of(errors.begin(), errors.end(), [](const std::string& err) {
+        return !err.empty();
+    });
+    if (hasErrors) {
+        // marker can in theory occur inside compressed or stored data, fall back to decompressing whole archive
+        bmcl::Buffer buf;
+        std::string err = decompressRange(src, size, &buf);
+        if (!err.empty()) {
+            return err;
+        }
+        return std::move(buf);
+    }
+
+    if (numBlocks == 1) {
+        return std::move(blocks[0]);
+    }
     bmcl::Buffer result;
-    ZpaqReader in(src, size);
-    ZpaqWriter out(&result);
+    for (const bmcl::Buffer& block : blocks) {
+        result.write(block.data(), block.size());
+    }
+    return std::move(result);
+}
 
-    try {
-        libzpaq::compress(&in, &out, std::to_string(compressionLevel).c_str());
-    } catch (const std::exception& err) {
-        return std::string(err.what());
+ZpaqResult zpaqCompress(const void* src, std::size_t size, unsigned compressionLevel, std::size_t numJobs)
+{
+    std::size_t numBlocks = std::max<std::size_t>(1, (size + zpaqBlockSize - 1) / zpaqBlockSize);
+    std::vector<bmcl::Buffer> blocks(numBlocks);
+    std::vector<std::string> errors(numBlocks);
+    std::string method = std::to_string(compressionLevel);
+
+    parallelFor(numJobs, numBlocks, [&](std::size_t i, std::size_t) {
+        std::size_t offset = i * zpaqBlockSize;
+        std::size_t blockSize = std::min(zpaqBlockSize, size - offset);
+        ZpaqReader in((const std::uint8_t*)src + offset, blockSize);
+        ZpaqWriter out(&blocks[i]);
+
+        try {
+            libzpaq::compress(&in, &out, method.c_str());
+        } catch (const std::exception& err) {
+            errors[i] = err.what();
+        }
+    });
+
+    for (const std::string& err : errors) {
+        if (!err.empty()) {
+            return err;
+        }
+    }
+
+    if (numBlocks == 1) {
+        return std::move(blocks[0]);
+    }
+    // concatenated blocks form a valid archive, tags allow decompressor to find blocks without decoding them
+    bmcl::Buffer result;
+    for (std::size_t i = 0; i < numBlocks; i++) {
+        const bmcl::Buffer& block = blocks[i];
+        bool isTagged = block.size() >= tagSize && std::equal(blockMarker.begin(), blockMarker.begin() + tagSize, block.data());
+        if (i != 0 && !isTagged) {
+            result.write(blockMarker.data(), tagSize);
+        }
+        result.write(block.data(), block.size());
     }
-    return result;
+    return std::move(result);
 }
 }
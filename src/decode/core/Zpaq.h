@@ -4,12 +4,19 @@
 
 #include <bmcl/Fwd.h>
 
+#include <cstddef>
 #include <string>
 
 namespace decode {
 
 using ZpaqResult = bmcl::Result<bmcl::Buffer, std::string>;
 
-ZpaqResult zpaqDecompress(const void* src, std::size_t size);
-ZpaqResult zpaqCompress(const void* src, std::size_t size, unsigned compressionLevel = 4);
+// input is split into blocks of this size that are compressed independently
+// small inputs end up in a single block, so output is the same as with plain libzpaq::compress
+constexpr std::size_t zpaqBlockSize = 1024 * 1024;
+
+// blocks are decompressed using up to numJobs threads, any valid zpaq archive is accepted
+ZpaqResult zpaqDecompress(const void* src, std::size_t size, std::size_t numJobs = 1);
+// blocks are compressed using up to numJobs threads, output does not depend on numJobs
+ZpaqResult zpaqCompress(const void* src, std::size_t size, unsigned compressionLevel = 4, std::size_t numJobs = 1);
 }
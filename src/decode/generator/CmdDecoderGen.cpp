@@ -245,11 +245,12 @@ void CmdDecoderGen::generateDecoder(const Component* comp, const Command* cmd)
     _output->append("\");\n\n");
 
     TypeReprGen reprGen(_output);
+    Rc<ReferenceType> ptr = new ReferenceType(ReferenceKind::Pointer, true, nullptr);
     foreachParam(cmd, [&](const CmdArgument& arg, bmcl::StringView name) {
         _output->append("    ");
         if (arg.argPassKind() == CmdArgPassKind::AllocPtr) {
-            Rc<const Type> type = new ReferenceType(ReferenceKind::Pointer, true, const_cast<Type*>(arg.field()->type())); //TODO: avoid allocation
-            reprGen.genOnboardTypeRepr(type.get(), name);
+            ptr->setPointee(const_cast<Type*>(arg.field()->type()));
+            reprGen.genOnboardTypeRepr(ptr.get(), name);
             _output->append(" = ");
             prototypeGen.appendCmdArgAllocFunctionName(comp, cmd, arg);
             _output->append("();\n");
@@ -271,7 +272,7 @@ void CmdDecoderGen::generateDecoder(const Component* comp, const Command* cmd)
     _output->append("    (void)dest;\n\n");
 
     _paramInspector.reset();
-    _paramInspector.inspect<true, false>(cmd->argumentsRange(), &_inlineInspector);
+    _paramInspector.inspect<true, false>(cmd->argumentsRange(), cmd->wireLayout(), &_inlineInspector);
     _output->appendEol();
 
     //TODO: gen command call
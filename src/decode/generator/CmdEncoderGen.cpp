@@ -54,7 +54,7 @@ void CmdEncoderGen::generateSource(ComponentMap::ConstRange comps)
             _output->appendNumericValue(cmd->number());
             _output->append(");\n");
 
-            inspector.inspect<true, true>(cmd->type()->argumentsRange(), &_inlineSer);
+            inspector.inspect<true, true>(cmd->type()->argumentsRange(), cmd->wireLayout(), &_inlineSer);
 
             _output->append("    return PhotonError_Ok;\n}\n\n");
         }
@@ -46,9 +46,10 @@ void FuncPrototypeGen::appendCmdDecoderFunctionName(const Component* comp, const
 template <typename T>
 void FuncPrototypeGen::appendWrappedFuncArgs(T range, TypeReprGen* reprGen)
 {
+    Rc<ReferenceType> ptr = new ReferenceType(ReferenceKind::Pointer, false, nullptr);
     foreachList(range, [&](const Field* arg) {
-        Rc<const Type> type = wrapPassedTypeIntoPointerIfRequired(const_cast<Type*>(arg->type())); //HACK
-        reprGen->genOnboardTypeRepr(type.get(), arg->name());
+        const Type* type = wrapPassedTypeIntoPointerIfRequired(arg->type(), ptr.get());
+        reprGen->genOnboardTypeRepr(type, arg->name());
     }, [this](const Field*) {
         _output->append(", ");
     });
@@ -57,21 +58,24 @@ void FuncPrototypeGen::appendWrappedFuncArgs(T range, TypeReprGen* reprGen)
 template <typename T>
 void FuncPrototypeGen::appendWrappedCmdArgs(T range, TypeReprGen* reprGen)
 {
+    Rc<ReferenceType> ptr = new ReferenceType(ReferenceKind::Pointer, false, nullptr);
     foreachList(range, [&](const CmdArgument& arg) {
-        Rc<const Type> type;
+        const Type* type = nullptr;
         switch (arg.argPassKind()) {
         case CmdArgPassKind::Default:
-            type = wrapPassedTypeIntoPointerIfRequired(const_cast<Type*>(arg.field()->type())); //HACK
+            type = wrapPassedTypeIntoPointerIfRequired(arg.field()->type(), ptr.get());
             break;
         case CmdArgPassKind::StackValue:
             type = arg.field()->type();
             break;
         case CmdArgPassKind::StackPtr:
         case CmdArgPassKind::AllocPtr:
-            type = new ReferenceType(ReferenceKind::Pointer, false, const_cast<Type*>(arg.field()->type()));
+            ptr->setMutable(false);
+            ptr->setPointee(const_cast<Type*>(arg.field()->type()));
+            type = ptr.get();
             break;
         };
-        reprGen->genOnboardTypeRepr(type.get(), arg.field()->name());
+        reprGen->genOnboardTypeRepr(type, arg.field()->name());
     }, [this](const CmdArgument&) {
         _output->append(", ");
     });
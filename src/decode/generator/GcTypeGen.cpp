@@ -21,8 +21,9 @@
 
 namespace decode {
 
-GcTypeGen::GcTypeGen(SrcBuilder* output)
-    : _output(output)
+GcTypeGen::GcTypeGen(const FlatPackage* package, SrcBuilder* output)
+    : FlatPackageVisitor<GcTypeGen>(package)
+    , _output(output)
     , _typeInspector(output)
 {
 }
@@ -38,17 +39,17 @@ void GcTypeGen::appendFullTypeName(const NamedType* type)
     _output->append(type->name());
 }
 
-void GcTypeGen::appendEnumConstantName(const EnumType* type, const EnumConstant* constant)
+void GcTypeGen::appendEnumConstantName(const EnumType* type, const FlatConstant& constant)
 {
     _output->append("photongen::");
     _output->append(type->moduleName());
     _output->append("::");
     _output->append(type->name());
     _output->append("::");
-    _output->append(constant->name());
+    _output->append(constant.name);
 }
 
-void GcTypeGen::generateHeader(const GenericInstantiationType* type)
+void GcTypeGen::generateInstantiation(const GenericInstantiationType* type)
 {
     _output->appendPragmaOnce();
     _output->appendEol();
@@ -113,49 +114,47 @@ void GcTypeGen::generateHeader(const GenericInstantiationType* type)
     _output->append("return true;}\n\n");
 }
 
-void GcTypeGen::generateHeader(const NamedType* type)
+static bmcl::OptionPtr<const GenericType> genericParent(const FlatType& type)
 {
-    switch (type->typeKind()) {
-    case TypeKind::Builtin:
-    case TypeKind::Reference:
-    case TypeKind::Array:
-    case TypeKind::DynArray:
-    case TypeKind::Function:
-    case TypeKind::Imported:
-    case TypeKind::Alias: {
-        generateAlias(type->asAlias());
-        break;
-    }
-    case TypeKind::GenericInstantiation:
-    case TypeKind::GenericParameter:
-        return;
-    case TypeKind::Enum:
-        generateEnum(type->asEnum(), bmcl::None);
-        break;
-    case TypeKind::Struct:
-        generateStruct(type->asStruct(), bmcl::None);
-        break;
-    case TypeKind::Variant:
-        generateVariant(type->asVariant(), bmcl::None);
-        break;
-    case TypeKind::Generic: {
-        const GenericType* g = type->asGeneric();
-        switch (g->innerType()->resolveFinalType()->typeKind()) {
-            case TypeKind::Enum:
-                generateEnum(g->innerType()->asEnum(), g);
-                break;
-            case TypeKind::Struct:
-                generateStruct(g->innerType()->asStruct(), g);
-                break;
-            case TypeKind::Variant:
-                generateVariant(g->innerType()->asVariant(), g);
-                break;
-            default:
-                break;
-        }
-        break;
-    }
+    if (type.kind == TypeKind::Generic) {
+        return type.type->asGeneric();
     }
+    return bmcl::None;
+}
+
+void GcTypeGen::generateHeader(const FlatType& type)
+{
+    traverseType(type);
+}
+
+bool GcTypeGen::visitEnumType(const FlatType& type, bmcl::ArrayView<FlatConstant> constants)
+{
+    generateEnum(type.body->asEnum(), constants, genericParent(type));
+    return false;
+}
+
+bool GcTypeGen::visitStructType(const FlatType& type, bmcl::ArrayView<FlatField> fields)
+{
+    generateStruct(type.body->asStruct(), fields, type.wireLayout, genericParent(type));
+    return false;
+}
+
+bool GcTypeGen::visitVariantType(const FlatType& type, bmcl::ArrayView<FlatAlternative> alternatives)
+{
+    generateVariant(type.body->asVariant(), alternatives, genericParent(type));
+    return false;
+}
+
+bool GcTypeGen::visitAliasType(const FlatType& type)
+{
+    generateAlias(type.type->asAlias());
+    return false;
+}
+
+bool GcTypeGen::visitGenericInstantiationType(const FlatType& type)
+{
+    generateInstantiation(type.type->asGenericInstantiation());
+    return false;
 }
 
 void GcTypeGen::beginNamespace(bmcl::StringView modName)
@@ -206,7 +205,7 @@ void GcTypeGen::appendDeserPrototype(const Type* type, bmcl::OptionPtr<const Gen
     _output->append("* self, bmcl::MemReader* src, photon::CoderState* state)");
 }
 
-void GcTypeGen::generateEnum(const EnumType* type, bmcl::OptionPtr<const GenericType> parent)
+void GcTypeGen::generateEnum(const EnumType* type, bmcl::ArrayView<FlatConstant> constants, bmcl::OptionPtr<const GenericType> parent)
 {
     _output->appendPragmaOnce();
     _output->appendEol();
@@ -224,11 +223,11 @@ void GcTypeGen::generateEnum(const EnumType* type, bmcl::OptionPtr<const Generic
     _output->appendWithFirstUpper(type->name());
     _output->append(" {\n");
 
-    for (const EnumConstant* c : type->constantsRange()) {
+    for (const FlatConstant& c : constants) {
         _output->append("    ");
-        _output->append(c->name());
+        _output->append(c.name);
         _output->append(" = ");
-        _output->appendNumericValue(c->value());
+        _output->appendNumericValue(c.value);
         _output->append(",\n");
     }
 
@@ -239,7 +238,7 @@ void GcTypeGen::generateEnum(const EnumType* type, bmcl::OptionPtr<const Generic
     appendSerPrefix(type, parent);
 
     _output->append("    switch(self) {\n");
-    for (const EnumConstant* c : type->constantsRange()) {
+    for (const FlatConstant& c : constants) {
         _output->append("    case ");
         appendEnumConstantName(type, c);
         _output->append(":\n");
@@ -262,9 +261,9 @@ void GcTypeGen::generateEnum(const EnumType* type, bmcl::OptionPtr<const Generic
     _output->append("`\");\n        return false;\n    }\n");
 
     _output->append("    switch(value) {\n");
-    for (const EnumConstant* c : type->constantsRange()) {
+    for (const FlatConstant& c : constants) {
         _output->append("    case ");
-        _output->appendNumericValue(c->value());
+        _output->appendNumericValue(c.value);
         _output->append(":\n        *self = ");
         appendEnumConstantName(type, c);
         _output->append(";\n        return true;\n");
@@ -276,7 +275,7 @@ void GcTypeGen::generateEnum(const EnumType* type, bmcl::OptionPtr<const Generic
 
 }
 
-void GcTypeGen::generateStruct(const StructType* type, bmcl::OptionPtr<const GenericType> parent)
+void GcTypeGen::generateStruct(const StructType* type, bmcl::ArrayView<FlatField> fields, const WireLayout* layout, bmcl::OptionPtr<const GenericType> parent)
 {
     const NamedType* serType = type;
     if (parent.isSome()) {
@@ -310,16 +309,16 @@ void GcTypeGen::generateStruct(const StructType* type, bmcl::OptionPtr<const Gen
     _output->appendWithFirstUpper(type->name());
     _output->append("()\n");
 
-    auto constructVars = [this](const StructType* type, bool isNull) {
+    auto constructVars = [this, fields](bool isNull) {
         char c = ':';
-        for (const Field* field : type->fieldsRange()) {
-            const Type* t = field->type()->resolveFinalType();
+        for (const FlatField& field : fields) {
+            const Type* t = field.type->resolveFinalType();
 
-            auto appendPrefix = [this](const Field* field, bmcl::StringView init, char c) {
+            auto appendPrefix = [this](const FlatField& field, bmcl::StringView init, char c) {
                 _output->append("        ");
                 _output->append(c);
                 _output->append(" _");
-                _output->append(field->name());
+                _output->append(field.name);
                 _output->append('(');
                 _output->append(init);
                 _output->append(")\n");
@@ -334,12 +333,12 @@ void GcTypeGen::generateStruct(const StructType* type, bmcl::OptionPtr<const Gen
                     continue;
                 }
             } else {
-                appendPrefix(field, field->name(), c);
+                appendPrefix(field, field.name, c);
             }
             c = ',';
         }
     };
-    constructVars(type, true);
+    constructVars(true);
     _output->append("    {\n    }\n\n");
 
     Rc<ReferenceType> ref = new ReferenceType(ReferenceKind::Reference, false, nullptr);
@@ -371,64 +370,64 @@ void GcTypeGen::generateStruct(const StructType* type, bmcl::OptionPtr<const Gen
     _output->appendIndent();
     _output->appendWithFirstUpper(type->name());
     _output->append('(');
-    foreachList(type->fieldsRange(), [&](const Field* arg) {
-        const Type* t = wrapType(arg->type()->resolveFinalType(), false);
-        gen.genGcTypeRepr(t, arg->name());
-    }, [this](const Field*) {
+    foreachList(fields, [&](const FlatField& arg) {
+        const Type* t = wrapType(arg.type->resolveFinalType(), false);
+        gen.genGcTypeRepr(t, arg.name);
+    }, [this](const FlatField&) {
          _output->append(", ");
     });
 
     _output->append(")\n");
-    constructVars(type, false);
+    constructVars(false);
     _output->append("    {\n    }\n\n");
 
-    for (const Field* field : type->fieldsRange()) {
+    for (const FlatField& field : fields) {
         _output->append("    void set");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append('(');
 
-        Rc<const Type> t = wrapType(field->type(), false);
-        gen.genGcTypeRepr(t.get(), field->name());
+        const Type* t = wrapType(field.type, false);
+        gen.genGcTypeRepr(t, field.name);
         _output->append(")\n    {\n        _");
-        _output->append(field->name());
+        _output->append(field.name);
         _output->append(" = ");
-        _output->append(field->name());
+        _output->append(field.name);
         _output->append(";\n    }\n\n");
     }
 
-    auto appendGetter = [&](const Field* field, bool isMutable) {
+    auto appendGetter = [&](const FlatField& field, bool isMutable) {
         _output->append("    ");
-        Rc<const Type> t = field->type()->resolveFinalType();
+        const Type* t = field.type->resolveFinalType();
         if (isMutable) {
-            ref->setPointee(const_cast<Type*>(t.get()));
+            ref->setPointee(const_cast<Type*>(t));
             ref->setMutable(isMutable);
-            t = ref;
+            t = ref.get();
         } else {
-            t = wrapType(field->type(), false);
+            t = wrapType(field.type, false);
         }
         SrcBuilder fieldName;
-        fieldName.append(field->name());
+        fieldName.append(field.name);
         fieldName.append("()");
-        gen.genGcTypeRepr(t.get(), fieldName.view());
+        gen.genGcTypeRepr(t, fieldName.view());
         if (!isMutable) {
             _output->append(" const");
         }
         _output->append("\n    {\n        return _");
-        _output->append(field->name());
+        _output->append(field.name);
         _output->append(";\n    }\n\n");
     };
 
-    for (const Field* field : type->fieldsRange()) {
+    for (const FlatField& field : fields) {
         appendGetter(field, false);
         //appendGetter(field, true);
     }
 
     _output->append("\n");
     SrcBuilder builder("_");
-    for (const Field* field : type->fieldsRange()) {
+    for (const FlatField& field : fields) {
         _output->appendIndent();
-        builder.append(field->name());
-        gen.genGcTypeRepr(field->type(), builder.view());
+        builder.append(field.name);
+        gen.genGcTypeRepr(field.type, builder.view());
         builder.resize(1);
         _output->append(";\n");
     }
@@ -442,10 +441,10 @@ void GcTypeGen::generateStruct(const StructType* type, bmcl::OptionPtr<const Gen
     if (parent.isNone()) {
         appendSerPrefix(serType, parent);
         builder.assign("self.");
-        for (const Field* field : type->fieldsRange()) {
-            builder.append(field->name());
+        for (const FlatField& field : fields) {
+            builder.append(field.name);
             builder.append("()");
-            _typeInspector.inspect<false, true>(field->type(), ctx, builder.view());
+            _typeInspector.inspect<false, true>(field.type, ctx, builder.view());
             builder.resize(5);
         }
         _output->append("    return true;\n}\n\n");
@@ -453,7 +452,7 @@ void GcTypeGen::generateStruct(const StructType* type, bmcl::OptionPtr<const Gen
 
     InlineStructInspector structInspector(_output, "self->_");
     appendDeserPrefix(serType, parent);
-    structInspector.inspect<false, false>(type->fieldsRange(), &_typeInspector);
+    structInspector.inspect<false, false>(fields, layout, &_typeInspector);
     _output->append("    return true;\n}\n");
 }
 
@@ -472,7 +471,7 @@ void GcTypeGen::appendTemplatePrefix(bmcl::OptionPtr<const GenericType> parent)
     _output->append(">\n");
 }
 
-void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const GenericType> parent)
+void GcTypeGen::generateVariant(const VariantType* type, bmcl::ArrayView<FlatAlternative> alternatives, bmcl::OptionPtr<const GenericType> parent)
 {
     //TODO: replace with ptr comparison
     if (type->moduleName() == "core" && type->name() == "Option") {
@@ -516,29 +515,28 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
 
     _output->append("    enum class Kind {\n");
 
-    for (const VariantField* field : type->fieldsRange()) {
+    for (const FlatAlternative& field : alternatives) {
         _output->append("        ");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(",\n");
     }
     _output->append("    };\n\n");
 
     TypeReprGen gen(_output);
     SrcBuilder fieldName("_");
-    for (const VariantField* field : type->fieldsRange()) {
-        switch (field->variantFieldKind()) {
+    for (const FlatAlternative& field : alternatives) {
+        switch (field.kind) {
         case VariantFieldKind::Constant:
             break;
         case VariantFieldKind::Tuple: {
-            const TupleVariantField* f = field->asTupleField();
             _output->append("    struct ");
-            _output->appendWithFirstUpper(field->name());
+            _output->appendWithFirstUpper(field.name);
             _output->append(" {\n");
             std::size_t i = 1;
-            for (const Type* t : f->typesRange()) {
+            for (const FlatField& t : _package->fields(field.fields)) {
                 fieldName.appendNumericValue(i);
                 _output->append("        ");
-                gen.genGcTypeRepr(t, fieldName.view());
+                gen.genGcTypeRepr(t.type, fieldName.view());
                 _output->append(";\n");
                 fieldName.resize(1);
                 i++;
@@ -547,13 +545,12 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
             break;
         }
         case VariantFieldKind::Struct:
-            const StructVariantField* f = field->asStructField();
             _output->append("    struct ");
-            _output->appendWithFirstUpper(field->name());
+            _output->appendWithFirstUpper(field.name);
             _output->append(" {\n");
-            for (const Field* t : f->fieldsRange()) {
+            for (const FlatField& t : _package->fields(field.fields)) {
                 _output->append("        ");
-                gen.genGcTypeRepr(t->type(), t->name());
+                gen.genGcTypeRepr(t.type, t.name);
                 _output->append(";\n");
             }
             _output->append("    };\n\n");
@@ -564,14 +561,14 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
     _output->append("    ");
     _output->appendWithFirstUpper(type->name());
     _output->append("()\n    {\n");
-    if (type->fieldsRange().size() != 0) {
-        const VariantField* field = *type->fieldsBegin();
+    if (alternatives.size() != 0) {
+        const FlatAlternative& field = alternatives[0];
         _output->append("        _kind = Kind::");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(";\n");
-        if (field->variantFieldKind() != VariantFieldKind::Constant) {
+        if (field.kind != VariantFieldKind::Constant) {
             _output->append("        _data.emplace<");
-            _output->appendWithFirstUpper(field->name());
+            _output->appendWithFirstUpper(field.name);
             _output->append(">();\n");
         }
     }
@@ -584,64 +581,64 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
     _output->append("    Kind kind() const\n    {\n        return _kind;\n    }\n\n");
 
     bool hasNonConstantFields = false;
-    for (const VariantField* field : type->fieldsRange()) {
-        if (field->variantFieldKind() != VariantFieldKind::Constant) {
+    for (const FlatAlternative& field : alternatives) {
+        if (field.kind != VariantFieldKind::Constant) {
             hasNonConstantFields = true;
             break;
         }
     }
 
-    for (const VariantField* field : type->fieldsRange()) {
+    for (const FlatAlternative& field : alternatives) {
         _output->append("    bool is");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append("() const\n    {\n        return _kind == Kind::");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(";\n    }\n\n");
     }
 
-    auto genAsMethod = [this](const VariantField* field, bool isConst) {
-        if (field->variantFieldKind() == VariantFieldKind::Constant) {
+    auto genAsMethod = [this](const FlatAlternative& field, bool isConst) {
+        if (field.kind == VariantFieldKind::Constant) {
             return;
         }
         _output->append("    ");
         if (isConst) {
             _output->append("const ");
         }
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append("& as");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append("()");
         if (isConst) {
             _output->append(" const");
         }
         _output->append("\n    {\n        assert(_kind == Kind::");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(");\n        return _data.as<");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(">();\n    }\n\n");
     };
 
-    for (const VariantField* field : type->fieldsRange()) {
+    for (const FlatAlternative& field : alternatives) {
         genAsMethod(field, true);
         genAsMethod(field, false);
     }
 
-    for (const VariantField* field : type->fieldsRange()) {
-        if (field->variantFieldKind() != VariantFieldKind::Constant) {
+    for (const FlatAlternative& field : alternatives) {
+        if (field.kind != VariantFieldKind::Constant) {
             _output->append("    template <typename... A>\n");
         }
         _output->append("    void emplace");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append("(");
-        if (field->variantFieldKind() != VariantFieldKind::Constant) {
+        if (field.kind != VariantFieldKind::Constant) {
             _output->append("A&&... args");
         }
         _output->append(")\n    {\n        destruct();\n        _kind = Kind::");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(";\n");
-        if (field->variantFieldKind() != VariantFieldKind::Constant) {
+        if (field.kind != VariantFieldKind::Constant) {
             _output->append("        _data.emplace<");
-            _output->appendWithFirstUpper(field->name());
+            _output->appendWithFirstUpper(field.name);
             _output->append(">(std::forward<A>(args)...);\n");
         }
         _output->append("    }\n\n");
@@ -650,12 +647,12 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
     _output->append("private:\n");
 
     _output->append("    void destruct()\n    {\n        switch (_kind) {\n");
-    for (const VariantField* field : type->fieldsRange()) {
+    for (const FlatAlternative& field : alternatives) {
         _output->append("        case Kind::");
-        _output->appendWithFirstUpper(field->name());
-        if (field->variantFieldKind() != VariantFieldKind::Constant) {
+        _output->appendWithFirstUpper(field.name);
+        if (field.kind != VariantFieldKind::Constant) {
             _output->append(":\n            _data.destruct<");
-            _output->appendWithFirstUpper(field->name());
+            _output->appendWithFirstUpper(field.name);
             _output->append(">();\n            break;\n");
         } else {
             _output->append( ":\n            break;\n");
@@ -667,12 +664,12 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
     if (hasNonConstantFields) {
         _output->append("    bmcl::AlignedUnion<");
         bool needComma = false;
-        for (const VariantField* field : type->fieldsRange()) {
-            if (field->variantFieldKind() != VariantFieldKind::Constant) {
+        for (const FlatAlternative& field : alternatives) {
+            if (field.kind != VariantFieldKind::Constant) {
                 if (needComma) {
                     _output->append(", ");
                 }
-                _output->appendWithFirstUpper(field->name());
+                _output->appendWithFirstUpper(field.name);
                 needComma = true;
             }
         }
@@ -689,10 +686,10 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
         appendSerPrefix(serType, parent);
         _output->append("    dest->writeVarInt((std::int64_t)self.kind());\n");
         _output->append("    switch (self.kind()) {\n");
-        for (const VariantField* field : type->fieldsRange()) {
+        for (const FlatAlternative& field : alternatives) {
             fieldName.clear();
             fieldName.append("self.as");
-            fieldName.appendWithFirstUpper(field->name());
+            fieldName.appendWithFirstUpper(field.name);
             fieldName.append("().");
             std::size_t nameSize = fieldName.size();
 
@@ -701,26 +698,26 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
             _output->append("::");
             _output->appendWithFirstUpper(type->name());
             _output->append("::Kind::");
-            _output->appendWithFirstUpper(field->name());
+            _output->appendWithFirstUpper(field.name);
             _output->append(":\n");
-            switch (field->variantFieldKind()) {
+            switch (field.kind) {
             case VariantFieldKind::Constant:
                 break;
             case VariantFieldKind::Tuple: {
                 std::size_t i = 1;
-                for (const Type* t : field->asTupleField()->typesRange()) {
+                for (const FlatField& t : _package->fields(field.fields)) {
                     fieldName.append("_");
                     fieldName.appendNumericValue(i);
-                    _typeInspector.inspect<false, true>(t, ctx, fieldName.view());
+                    _typeInspector.inspect<false, true>(t.type, ctx, fieldName.view());
                     i++;
                     fieldName.resize(nameSize);
                 }
                 break;
             }
             case VariantFieldKind::Struct:
-                for (const Field* f : field->asStructField()->fieldsRange()) {
-                    fieldName.append(f->name());
-                    _typeInspector.inspect<false, true>(f->type(), ctx, fieldName.view());
+                for (const FlatField& f : _package->fields(field.fields)) {
+                    fieldName.append(f.name);
+                    _typeInspector.inspect<false, true>(f.type, ctx, fieldName.view());
                     fieldName.resize(nameSize);
                 }
                 break;
@@ -745,10 +742,10 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
 
         _output->append("    switch (value) {\n");
         std::size_t enumIndex = 0;
-        for (const VariantField* field : type->fieldsRange()) {
+        for (const FlatAlternative& field : alternatives) {
             fieldName.clear();
             fieldName.append("self->as");
-            fieldName.appendWithFirstUpper(field->name());
+            fieldName.appendWithFirstUpper(field.name);
             fieldName.append("().");
             std::size_t nameSize = fieldName.size();
 
@@ -756,26 +753,26 @@ void GcTypeGen::generateVariant(const VariantType* type, bmcl::OptionPtr<const G
             _output->appendNumericValue(enumIndex);
             _output->append(":\n");
             _output->append("        self->emplace");
-            _output->appendWithFirstUpper(field->name());
+            _output->appendWithFirstUpper(field.name);
             _output->append("();\n");
-            switch (field->variantFieldKind()) {
+            switch (field.kind) {
             case VariantFieldKind::Constant:
                 break;
             case VariantFieldKind::Tuple: {
                 std::size_t i = 1;
-                for (const Type* t : field->asTupleField()->typesRange()) {
+                for (const FlatField& t : _package->fields(field.fields)) {
                     fieldName.append("_");
                     fieldName.appendNumericValue(i);
-                    _typeInspector.inspect<false, false>(t, ctx, fieldName.view());
+                    _typeInspector.inspect<false, false>(t.type, ctx, fieldName.view());
                     i++;
                     fieldName.resize(nameSize);
                 }
                 break;
             }
             case VariantFieldKind::Struct:
-                for (const Field* f : field->asStructField()->fieldsRange()) {
-                    fieldName.append(f->name());
-                    _typeInspector.inspect<false, false>(f->type(), ctx, fieldName.view());
+                for (const FlatField& f : _package->fields(field.fields)) {
+                    fieldName.append(f.name);
+                    _typeInspector.inspect<false, false>(f.type, ctx, fieldName.view());
                     fieldName.resize(nameSize);
                 }
                 break;
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "decode/Config.h"
+#include "decode/parser/FlatPackageVisitor.h"
 #include "decode/generator/InlineTypeInspector.h"
 
 #include <bmcl/Fwd.h>
@@ -23,27 +24,33 @@ class StructType;
 class VariantType;
 class NamedType;
 class SrcBuilder;
-class EnumConstant;
 class GenericType;
 class GenericInstantiationType;
 
-class GcTypeGen {
+class GcTypeGen : public FlatPackageVisitor<GcTypeGen> {
 public:
-    GcTypeGen(SrcBuilder* output);
+    GcTypeGen(const FlatPackage* package, SrcBuilder* output);
     ~GcTypeGen();
 
-    void generateHeader(const NamedType* type);
-    void generateHeader(const GenericInstantiationType* type);
+    // type is a named type or generic instantiation from package tables
+    void generateHeader(const FlatType& type);
+
+    bool visitEnumType(const FlatType& type, bmcl::ArrayView<FlatConstant> constants);
+    bool visitStructType(const FlatType& type, bmcl::ArrayView<FlatField> fields);
+    bool visitVariantType(const FlatType& type, bmcl::ArrayView<FlatAlternative> alternatives);
+    bool visitAliasType(const FlatType& type);
+    bool visitGenericInstantiationType(const FlatType& type);
 
 private:
-    void generateEnum(const EnumType* type, bmcl::OptionPtr<const GenericType> parent);
-    void generateStruct(const StructType* type, bmcl::OptionPtr<const GenericType> parent);
-    void generateVariant(const VariantType* type, bmcl::OptionPtr<const GenericType> parent);
+    void generateInstantiation(const GenericInstantiationType* type);
+    void generateEnum(const EnumType* type, bmcl::ArrayView<FlatConstant> constants, bmcl::OptionPtr<const GenericType> parent);
+    void generateStruct(const StructType* type, bmcl::ArrayView<FlatField> fields, const WireLayout* layout, bmcl::OptionPtr<const GenericType> parent);
+    void generateVariant(const VariantType* type, bmcl::ArrayView<FlatAlternative> alternatives, bmcl::OptionPtr<const GenericType> parent);
     void generateAlias(const AliasType* type);
 
     void appendTemplatePrefix(bmcl::OptionPtr<const GenericType> parent);
     void appendFullTypeName(const NamedType* type);
-    void appendEnumConstantName(const EnumType* type, const EnumConstant* constant);
+    void appendEnumConstantName(const EnumType* type, const FlatConstant& constant);
 
     void appendSerPrefix(const Type* type, bmcl::OptionPtr<const GenericType> parent, const char* prefix = "inline");
     void appendDeserPrefix(const Type* type, bmcl::OptionPtr<const GenericType> parent, const char* prefix = "inline");
@@ -24,9 +24,11 @@
 #include "decode/ast/ModuleInfo.h"
 #include "decode/parser/Package.h"
 #include "decode/parser/Project.h"
+#include "decode/parser/FlatPackage.h"
 #include "decode/ast/Decl.h"
 #include "decode/ast/Component.h"
 #include "decode/ast/Constant.h"
+#include "decode/core/AsyncFileWriter.h"
 #include "decode/core/Diagnostics.h"
 #include "decode/core/Try.h"
 #include "decode/core/PathUtils.h"
@@ -38,7 +40,12 @@
 #include <bmcl/Buffer.h>
 #include <bmcl/Sha3.h>
 #include <bmcl/FixedArrayView.h>
+#include <bmcl/FileUtils.h>
+#include <bmcl/Result.h>
 
+#include <array>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <deque>
 #include <memory>
@@ -50,6 +57,8 @@ namespace decode {
 
 Generator::Generator(Diagnostics* diag)
     : _diag(diag)
+    , _numWrittenFiles(0)
+    , _numUnchangedFiles(0)
 {
 }
 
@@ -57,6 +66,28 @@ Generator::~Generator()
 {
 }
 
+std::size_t Generator::numWrittenFiles() const
+{
+    return _numWrittenFiles;
+}
+
+std::size_t Generator::numUnchangedFiles() const
+{
+    return _numUnchangedFiles;
+}
+
+void Generator::saveFile(std::string path, SrcBuilder* output)
+{
+    // builder is reused for next file, copy keeps its reserved buffer
+    _writer->write(std::move(path), output->toStdString());
+    output->clear();
+}
+
+void Generator::saveFile(std::string path, bmcl::Bytes output)
+{
+    _writer->write(std::move(path), std::string((const char*)output.data(), output.size()));
+}
+
 void Generator::setOutPath(bmcl::StringView path)
 {
     _savePath.assign(path.begin(), path.end());
@@ -92,17 +123,50 @@ bool Generator::generateTmPrivate(const Package* package)
     _output.append("#define _PHOTON_TM_MSG_COUNT sizeof(_messageDesc) / sizeof(_messageDesc[0])\n\n");
 
     std::string tmDetailPath = joinPath(_onboardPath.toStdString(), "StatusTable.inc.c");
-    TRY(saveOutput(tmDetailPath, _output.view(), _diag.get()));
-    _output.clear();
+    saveFile(tmDetailPath, &_output);
 
     return true;
 }
 
-void Generator::generateSerializedPackage(const Project* project, bmcl::Buffer* serialized, SrcBuilder* sourceCode)
+// package key file holds compression key of last generated package
+const std::array<std::uint8_t, 4> packageKeyMagic = {{0x64, 0x70, 0x6b, 0x6b}};
+
+static bool fileExists(const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::fclose(file);
+    return true;
+}
+
+bool Generator::generateSerializedPackage(const Project* project, const std::string& onboardPath, bmcl::Buffer* serialized, SrcBuilder* sourceCode, bmcl::Buffer* key, bool* isCached)
 {
     sourceCode->clear();
+    *isCached = false;
+
+    bmcl::Buffer encoded;
+    TRY(project->encode(&encoded));
+    auto compressionKey = project->compressionKey(encoded);
+    key->write(packageKeyMagic.data(), packageKeyMagic.size());
+    key->write(compressionKey.data(), compressionKey.size());
+
+    std::string keyPath = joinPath(onboardPath, "Package.key");
+    auto storedKey = bmcl::readFileIntoString(keyPath.c_str());
+    if (storedKey.isOk()
+        && storedKey.unwrap().size() == key->size()
+        && std::memcmp(storedKey.unwrap().data(), key->data(), key->size()) == 0
+        && fileExists(joinPath(onboardPath, "Package.inc.c"))
+        && fileExists(joinPath(onboardPath, "Package.bin"))) {
+        key->clear();
+        *isCached = true;
+        return true;
+    }
+    // outputs are rewritten after this, stale key must not match them if generation is interrupted
+    std::remove(keyPath.c_str());
 
-    *serialized = project->encode();
+    *serialized = project->compress(encoded);
 
     sourceCode->appendNumericValueDefine(serialized->size(), "_PHOTON_PACKAGE_SIZE");
     sourceCode->appendEol();
@@ -129,7 +193,7 @@ void Generator::generateSerializedPackage(const Project* project, bmcl::Buffer*
         sourceCode->appendEndif();
         sourceCode->appendEol();
     }
-
+    return true;
 }
 
 void Generator::appendBuiltinHeaders()
@@ -155,10 +219,41 @@ void Generator::appendBuiltins(bmcl::ArrayView<bmcl::StringView> names, bmcl::St
     }
 }
 
+bool Generator::generatePackageDelta(const Project* project, const std::string& onboardPath, bmcl::Bytes package)
+{
+    const std::string& basePath = _config.packageDeltaBase.unwrap();
+    auto base = bmcl::readFileIntoString(basePath.c_str());
+    if (base.isErr()) {
+        _diag->buildSystemFileErrorReport("failed to read base package", base.unwrapErr(), basePath);
+        return false;
+    }
+
+    // package is not regenerated if it is up to date
+    std::string packagePath = joinPath(onboardPath, "Package.bin");
+    std::string cachedPackage;
+    if (package.isEmpty()) {
+        auto rv = bmcl::readFileIntoString(packagePath.c_str());
+        if (rv.isErr()) {
+            _diag->buildSystemFileErrorReport("failed to read package", rv.unwrapErr(), packagePath);
+            return false;
+        }
+        cachedPackage = rv.take();
+        package = bmcl::StringView(cachedPackage).asBytes();
+    }
+
+    auto delta = project->encodeDelta(bmcl::StringView(base.unwrap()).asBytes(), package);
+    if (delta.isErr()) {
+        return false;
+    }
+    std::string deltaPath = joinPath(onboardPath, "Package.delta");
+    saveFile(deltaPath, delta.unwrap());
+    return true;
+}
+
 //TODO: refact
 bool Generator::generateDeviceFiles(const Project* project)
 {
-    HashMap<Rc<const Ast>, std::vector<std::string>> srcsPaths;
+    HashMap<const Ast*, std::vector<std::string>> srcsPaths;
     for (const Ast* mod : project->package()->modules()) {
         auto src = project->sourcesForModule(mod);
         if (src.isNone()) {
@@ -216,8 +311,8 @@ bool Generator::generateDeviceFiles(const Project* project)
         for (const Ast* module : dev->modules()) {
             coll.collect(module, &types);
         }
-        HashSet<Rc<const Ast>> targetMods;
-        HashSet<Rc<const Ast>> sourceMods;
+        HashSet<const Ast*> targetMods;
+        HashSet<const Ast*> sourceMods;
 
         auto appendTargetMods = [&](const Device* dep) {
             for (const Ast* module : dep->modules()) {
@@ -285,12 +380,12 @@ bool Generator::generateDeviceFiles(const Project* project)
             _output.appendUpper(module->moduleInfo()->moduleName());
             _output.appendEol();
         }
-        for (const Rc<const Ast>& module : targetMods) {
+        for (const Ast* module : targetMods) {
             _output.append("#define PHOTON_HAS_CMD_TARGET_");
             _output.appendUpper(module->moduleInfo()->moduleName());
             _output.appendEol();
         }
-        for (const Rc<const Ast>& module : sourceMods) {
+        for (const Ast* module : sourceMods) {
             _output.append("#define PHOTON_HAS_TM_SOURCE_");
             _output.appendUpper(module->moduleInfo()->moduleName());
             _output.appendEol();
@@ -318,8 +413,7 @@ bool Generator::generateDeviceFiles(const Project* project)
         SrcBuilder path(joinPath(_savePath, "Photon"));
         path.appendWithFirstUpper(dev->name());
         path.append(".h");
-        TRY(saveOutput(path.c_str(), _output.view(), _diag.get()));
-        _output.clear();
+        saveFile(path.toStdString(), &_output);
 
         //src
         _output.append("#include \"Photon");
@@ -341,8 +435,7 @@ bool Generator::generateDeviceFiles(const Project* project)
         appendBundledSources(dev, ".c");
 
         path.back() = 'c';
-        TRY(saveOutput(path.c_str(), _output.view(), _diag.get()));
-        _output.clear();
+        saveFile(path.toStdString(), &_output);
     }
     return true;
 }
@@ -362,11 +455,39 @@ bool Generator::generateConfig(const Project* project)
 bool Generator::generateProject(const Project* project, const GeneratorConfig& cfg)
 {
     _config = cfg;
+    // io threads mostly wait for file system, their number does not depend on number of cores
+    _writer = new AsyncFileWriter(4, cfg.writeOnlyChangedFiles);
+
+    bmcl::Buffer packageKey;
+    bool isGenerated = generateProjectFiles(project, &packageKey);
+
+    // files queued before generation error are still written, their errors are reported too
+    bool isOk = _writer->finish(_diag.get()) && isGenerated;
+    _numWrittenFiles = _writer->numWrittenFiles();
+    _numUnchangedFiles = _writer->numUnchangedFiles();
+    _writer = nullptr;
+
+    // key is saved only after package files, so that it never matches partially written ones
+    if (isOk && !packageKey.isEmpty()) {
+        std::string packageKeyPath = joinPath(_onboardPath.view().toStdString(), "Package.key");
+        isOk = saveOutput(packageKeyPath, packageKey, _diag.get());
+    }
 
+    _photongenPath.clear();
+    _output.clear();
+    _onboardHgen.reset();
+    _onboardSgen.reset();
+    _onboardPath.clear();
+    _gcPath.clear();
+    return isOk;
+}
+
+bool Generator::generateProjectFiles(const Project* project, bmcl::Buffer* packageKey)
+{
     TRY(makeDirectory(_savePath, _diag.get()));
 
     std::string dummyPath = joinPath(_savePath, "Photon.dummy.h"); //FIXME: joinPath
-    TRY(saveOutput(dummyPath, bmcl::StringView::empty(), _diag.get()));
+    saveFile(dummyPath, bmcl::StringView::empty().asBytes());
 
     bmcl::StringView exts[2] = {".c", ".h"};
     for (bmcl::StringView ext : exts) {
@@ -383,8 +504,7 @@ bool Generator::generateProject(const Project* project, const GeneratorConfig& c
 
         std::string photoncPath = joinPath(_savePath, "Photon");;
         photoncPath.append(ext.begin(), ext.end());
-        TRY(saveOutput(photoncPath, _output.view(), _diag.get()));
-        _output.clear();
+        saveFile(photoncPath, &_output);
     }
 
     _photongenPath = joinPath(_savePath, "photongen");
@@ -402,62 +522,60 @@ bool Generator::generateProject(const Project* project, const GeneratorConfig& c
     bmcl::Buffer serializedProject;
     packageSourceCode.reserve(1024 * 1024);
     _output.reserve(1024 * 1024);
-    auto future = std::async(std::launch::async, &Generator::generateSerializedPackage, project, &serializedProject, &packageSourceCode);
+    std::string onboardPath = _onboardPath.view().toStdString();
+    bool isPackageCached = false;
+    auto future = std::async(std::launch::async, &Generator::generateSerializedPackage, project, onboardPath, &serializedProject, &packageSourceCode, packageKey, &isPackageCached);
 
     const Package* package = project->package();
+    Rc<const FlatPackage> flatPackage = new FlatPackage(package);
 
     _onboardHgen.reset(new OnboardTypeHeaderGen(&_output));
-    _onboardSgen.reset(new OnboardTypeSourceGen(&_output));
-    for (const Ast* it : package->modules()) {
-        if (!generateTypesAndComponents(it)) {
+    _onboardSgen.reset(new OnboardTypeSourceGen(flatPackage.get(), &_output));
+    for (const FlatModule& module : flatPackage->modules()) {
+        if (!generateTypesAndComponents(flatPackage.get(), module)) {
             return false;
         }
     }
 
-    TRY(generateGenerics(package));
+    TRY(generateGenerics(flatPackage.get()));
     TRY(generateConfig(project));
     TRY(generateDynArrays(package));
     TRY(generateTmPrivate(package));
-    TRY(generateStatusMessages(project));
+    TRY(generateStatusMessages(flatPackage.get()));
     TRY(generateCommands(package));
     TRY(generateDeviceFiles(project));
 
     GcInterfaceGen igen(&_output);
     igen.generateHeader(package);
     std::string interfacePath = joinPath(_savePath, "Photon.hpp");
-    TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
-    _output.clear();
+    saveFile(interfacePath, &_output);
 
     igen.generateSource(package);
     interfacePath = joinPath(_savePath, "Photon.cpp");
-    TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
-    _output.clear();
+    saveFile(interfacePath, &_output);
 
     igen.generateValidatorHeader(package);
     interfacePath = joinPath(_gcPath.view(), "Validator.hpp");
-    TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
-    _output.clear();
+    saveFile(interfacePath, &_output);
 
     ReportGen rgen(&_output);
     rgen.generateReport(project);
     std::string reportPath = joinPath(_photongenPath, "Report.txt");
-    TRY(saveOutput(reportPath, _output.view(), _diag.get()));
-    _output.clear();
+    saveFile(reportPath, &_output);
 
 
-    future.wait();
-    std::string packageDetailPath = joinPath(std::string(_onboardPath.data(), _onboardPath.size()), "Package.inc.c");
-    TRY(saveOutput(packageDetailPath, packageSourceCode.view(), _diag.get()));
+    TRY(future.get());
+    if (!isPackageCached) {
+        std::string packageDetailPath = joinPath(onboardPath, "Package.inc.c");
+        saveFile(packageDetailPath, &packageSourceCode);
 
-    std::string packageBlobPath = joinPath(std::string(_onboardPath.c_str()), "Package.bin");
-    TRY(saveOutput(packageBlobPath, serializedProject, _diag.get()));
+        std::string packageBlobPath = joinPath(onboardPath, "Package.bin");
+        saveFile(packageBlobPath, serializedProject);
+    }
 
-    _photongenPath.clear();
-    _output.clear();
-    _onboardHgen.reset();
-    _onboardSgen.reset();
-    _onboardPath.clear();
-    _gcPath.clear();
+    if (_config.packageDeltaBase.isSome()) {
+        TRY(generatePackageDelta(project, onboardPath, serializedProject));
+    }
     return true;
 }
 
@@ -475,7 +593,7 @@ bool Generator::generateDynArrays(const Package* package)
 
     std::size_t size = _onboardPath.size();
     _onboardPath.append("_dynarray_");
-    TRY(makeDirectory(_onboardPath.c_str(), _diag.get()));
+    _writer->makeDirectory(_onboardPath.toStdString());
     _onboardPath.append(pathSeparator());
 
     for (const auto& it : dynArrays) {
@@ -490,38 +608,38 @@ bool Generator::generateDynArrays(const Package* package)
     return true;
 }
 
-bool Generator::generateStatusMessages(const Project* project)
+bool Generator::generateStatusMessages(const FlatPackage* package)
 {
-    StatusEncoderGen gen(&_output);
-    gen.generateStatusEncoderSource(project);
+    StatusEncoderGen gen(package, &_output);
+    gen.generateStatusEncoderSource();
     TRY(dump("StatusEncoder", ".c", &_onboardPath));
 
-    gen.generateStatusDecoderHeader(project);
+    gen.generateStatusDecoderHeader();
     TRY(dump("StatusDecoder", ".h", &_onboardPath));
 
-    gen.generateStatusDecoderSource(project);
+    gen.generateStatusDecoderSource();
     TRY(dump("StatusDecoder", ".c", &_onboardPath));
 
-    gen.generateEventEncoderSource(project);
+    gen.generateEventEncoderSource();
     TRY(dump("EventEncoder", ".c", &_onboardPath));
 
-    gen.generateAutosaveSource(project);
+    gen.generateAutosaveSource();
     TRY(dump("Autosave.inc", ".c", &_onboardPath));
 
     std::size_t pathSize = _gcPath.size();
     _gcPath.append("_statuses_");
-    TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
+    _writer->makeDirectory(_gcPath.toStdString());
     _gcPath.append(pathSeparator());
 
     //refact
     GcMsgGen msgGen(&_output);
     SrcBuilder msgName;
-    for (const Component* comp : project->package()->components()) {
-        for (const StatusMsg* msg : comp->statusesRange()) {
-            msgName.appendWithFirstUpper(comp->name());
+    for (const FlatComponent& comp : package->components()) {
+        for (const FlatMsg& msg : package->msgs(comp.statuses)) {
+            msgName.appendWithFirstUpper(comp.name);
             msgName.append("_");
-            msgName.appendWithFirstUpper(msg->name());
-            msgGen.generateStatusHeader(comp, msg);
+            msgName.appendWithFirstUpper(msg.name);
+            msgGen.generateStatusHeader(comp.comp, static_cast<const StatusMsg*>(msg.msg));
             TRY(dumpIfNotEmpty(msgName.view(), ".hpp", &_gcPath));
             msgName.clear();
         }
@@ -529,15 +647,15 @@ bool Generator::generateStatusMessages(const Project* project)
     _gcPath.resize(pathSize);
 
     _gcPath.append("_events_");
-    TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
+    _writer->makeDirectory(_gcPath.toStdString());
     _gcPath.append(pathSeparator());
 
-    for (const Component* comp : project->package()->components()) {
-        for (const EventMsg* msg : comp->eventsRange()) {
-            msgName.appendWithFirstUpper(comp->name());
+    for (const FlatComponent& comp : package->components()) {
+        for (const FlatMsg& msg : package->msgs(comp.events)) {
+            msgName.appendWithFirstUpper(comp.name);
             msgName.append("_");
-            msgName.appendWithFirstUpper(msg->name());
-            msgGen.generateEventHeader(comp, msg);
+            msgName.appendWithFirstUpper(msg.name);
+            msgGen.generateEventHeader(comp.comp, static_cast<const EventMsg*>(msg.msg));
             TRY(dumpIfNotEmpty(msgName.view(), ".hpp", &_gcPath));
             msgName.clear();
         }
@@ -575,36 +693,42 @@ bool Generator::dump(bmcl::StringView name, bmcl::StringView ext, StringBuilder*
 {
     currentPath->appendWithFirstUpper(name);
     currentPath->append(ext);
-    TRY(saveOutput(currentPath->c_str(), _output.view(), _diag.get()));
+    saveFile(currentPath->toStdString(), &_output);
     currentPath->removeFromBack(name.size() + ext.size());
-    _output.clear();
     return true;
 }
 
-bool Generator::generateGenerics(const Package* package)
+bool Generator::generateGenerics(const FlatPackage* package)
 {
     _onboardPath.append("_generic_");
-    TRY(makeDirectory(_onboardPath.c_str(), _diag.get()));
+    _writer->makeDirectory(_onboardPath.toStdString());
     _onboardPath.append(pathSeparator());
 
     _gcPath.append("_generic_");
-    TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
+    _writer->makeDirectory(_gcPath.toStdString());
     _gcPath.append(pathSeparator());
 
     SrcBuilder typeNameBuilder;
     TypeNameGen typeNameGen(&typeNameBuilder);
-    GcTypeGen gcTypeGen(&_output);
-    for (const Ast* ast : package->modules()) {
-        for (const GenericInstantiationType* type : ast->genericInstantiationsRange()) {
+    GcTypeGen gcTypeGen(package, &_output);
+    // same instantiation is usually used from many modules, it is generated only once
+    HashSet<std::string> generatedNames;
+    for (const FlatModule& module : package->modules()) {
+        for (const FlatType& flatType : package->types(module.instantiations)) {
+            const GenericInstantiationType* type = flatType.type->asGenericInstantiation();
             typeNameGen.genTypeName(type);
+            if (!generatedNames.insert(typeNameBuilder.view().toStdString()).second) {
+                typeNameBuilder.clear();
+                continue;
+            }
 
-            _onboardHgen->genTypeHeader(ast, type, typeNameBuilder.view());
+            _onboardHgen->genTypeHeader(module.ast, type, typeNameBuilder.view());
             TRY(dump(typeNameBuilder.view(), ".h", &_onboardPath));
 
-            _onboardSgen->genTypeSource(type, typeNameBuilder.view());
+            _onboardSgen->genTypeSource(flatType, typeNameBuilder.view());
             TRY(dump(typeNameBuilder.view(), GEN_PREFIX ".c", &_onboardPath));
 
-            gcTypeGen.generateHeader(type);
+            gcTypeGen.generateHeader(flatType);
             TRY(dump(typeNameBuilder.view(), ".hpp", &_gcPath));
 
             typeNameBuilder.clear();
@@ -615,36 +739,35 @@ bool Generator::generateGenerics(const Package* package)
     return true;
 }
 
-bool Generator::generateTypesAndComponents(const Ast* ast)
+bool Generator::generateTypesAndComponents(const FlatPackage* package, const FlatModule& module)
 {
+    const Ast* ast = module.ast;
     _onboardPath.append(ast->moduleName());
-    TRY(makeDirectory(_onboardPath.c_str(), _diag.get()));
+    _writer->makeDirectory(_onboardPath.toStdString());
     _onboardPath.append(pathSeparator());
 
     _gcPath.append(ast->moduleName());
-    TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
+    _writer->makeDirectory(_gcPath.toStdString());
     _gcPath.append(pathSeparator());
 
     SrcBuilder typeNameBuilder;
     TypeNameGen typeNameGen(&typeNameBuilder);
-    GcTypeGen gcTypeGen(&_output);
-    for (const NamedType* type : ast->namedTypesRange()) {
-        if (type->typeKind() == TypeKind::Imported) {
-            continue;
-        }
-        if (type->typeKind() != TypeKind::Generic) {
+    GcTypeGen gcTypeGen(package, &_output);
+    for (const FlatType& flatType : package->types(module.types)) {
+        const NamedType* type = static_cast<const NamedType*>(flatType.type);
+        if (flatType.kind != TypeKind::Generic) {
             typeNameGen.genTypeName(type);
 
             _onboardHgen->genTypeHeader(ast, type, typeNameBuilder.view());
-            TRY(dump(type->name(), ".h", &_onboardPath));
+            TRY(dump(flatType.name, ".h", &_onboardPath));
 
-            _onboardSgen->genTypeSource(type, typeNameBuilder.view());
-            TRY(dump(type->name(), GEN_PREFIX ".c", &_onboardPath));
+            _onboardSgen->genTypeSource(flatType, typeNameBuilder.view());
+            TRY(dump(flatType.name, GEN_PREFIX ".c", &_onboardPath));
 
             typeNameBuilder.clear();
         }
-        gcTypeGen.generateHeader(type);
-        TRY(dump(type->name(), ".hpp", &_gcPath));
+        gcTypeGen.generateHeader(flatType);
+        TRY(dump(flatType.name, ".hpp", &_gcPath));
 
     }
 
@@ -14,30 +14,40 @@
 #include "decode/parser/Containers.h"
 
 #include <bmcl/StringView.h>
+#include <bmcl/Option.h>
 
 #include <memory>
+#include <string>
 
 namespace decode {
 
 class Ast;
 class Diagnostics;
 class Package;
+class FlatPackage;
 class Project;
+struct FlatModule;
 class OnboardTypeHeaderGen;
 class OnboardTypeSourceGen;
 class NamedType;
 class DynArrayType;
 class TypeReprGen;
+class AsyncFileWriter;
 
 struct GeneratorConfig {
     GeneratorConfig()
         : useAbsolutePathsForBundledSources(false)
+        , writeOnlyChangedFiles(true)
       //  , generateOnboard(true)
       //  , generateGroundcontrol(true)
     {
     }
 
     bool useAbsolutePathsForBundledSources;
+    // files with unchanged contents are not rewritten, so that build systems do not rebuild them
+    bool writeOnlyChangedFiles;
+    // previous Package.bin, delta against it is saved next to new one
+    bmcl::Option<std::string> packageDeltaBase;
     //bool generateOnboard;
     //bool generateGroundcontrol;
 };
@@ -54,20 +64,31 @@ public:
 
     bool generateProject(const Project* project, const GeneratorConfig& cfg = GeneratorConfig());
 
+    std::size_t numWrittenFiles() const;
+    std::size_t numUnchangedFiles() const;
+
 private:
-    bool generateTypesAndComponents(const Ast* ast);
+    // queues all generated files, packageKey is left empty if package files are up to date
+    bool generateProjectFiles(const Project* project, bmcl::Buffer* packageKey);
+    bool generateTypesAndComponents(const FlatPackage* package, const FlatModule& module);
     bool generateDynArrays(const Package* package);
-    bool generateStatusMessages(const Project* package);
+    bool generateStatusMessages(const FlatPackage* package);
     bool generateCommands(const Package* package);
     bool generateTmPrivate(const Package* package);
-    bool generateGenerics(const Package* package);
-    static void generateSerializedPackage(const Project* project, bmcl::Buffer* serialized, SrcBuilder* sourceCode);
+    bool generateGenerics(const FlatPackage* package);
+    // isCached is set if package files in onboardPath are up to date, serialized, sourceCode and key are left empty then
+    static bool generateSerializedPackage(const Project* project, const std::string& onboardPath, bmcl::Buffer* serialized, SrcBuilder* sourceCode, bmcl::Buffer* key, bool* isCached);
     bool generateDeviceFiles(const Project* project);
     bool generateConfig(const Project* project);
+    bool generatePackageDelta(const Project* project, const std::string& onboardPath, bmcl::Bytes package);
 
     void appendModIfdef(bmcl::StringView name);
     void appendEndif();
 
+    // queued for background writing, errors are reported when generation finishes
+    void saveFile(std::string path, SrcBuilder* output);
+    void saveFile(std::string path, bmcl::Bytes output);
+
     bool dumpIfNotEmpty(bmcl::StringView name, bmcl::StringView ext, StringBuilder* currentPath);
     bool dump(bmcl::StringView name, bmcl::StringView ext, StringBuilder* currentPath);
 
@@ -83,6 +104,9 @@ private:
     SrcBuilder _output;
     std::unique_ptr<OnboardTypeHeaderGen> _onboardHgen;
     std::unique_ptr<OnboardTypeSourceGen> _onboardSgen;
+    Rc<AsyncFileWriter> _writer;
     GeneratorConfig _config;
+    std::size_t _numWrittenFiles;
+    std::size_t _numUnchangedFiles;
 };
 }
@@ -4,6 +4,9 @@
 #include "decode/generator/TypeDependsCollector.h"
 #include "decode/ast/Type.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace decode {
 
 IncludeGen::IncludeGen(SrcBuilder* output)
@@ -59,9 +62,14 @@ void IncludeGen::genOnboardGenericInstantiation(const GenericInstantiationType*
 }
 
 template <bool isOnboard>
-void IncludeGen::genIncludePaths(const HashSet<Rc<const Type>>* types)
+void IncludeGen::genIncludePaths(const HashSet<const Type*>* types)
 {
-    for (const Rc<const Type>& type : *types) {
+    // hash set iterates in order of pointer hashes, which changes between runs,
+    // so includes are generated separately and sorted to keep output stable
+    SrcBuilder* output = _output;
+    SrcBuilder includes;
+    _output = &includes;
+    for (const Type* type : *types) {
     switch (type->typeKind()) {
         case TypeKind::Builtin:
             break;
@@ -108,16 +116,31 @@ void IncludeGen::genIncludePaths(const HashSet<Rc<const Type>>* types)
             break;
         }
     }
+    _output = output;
+
+    std::vector<bmcl::StringView> lines;
+    bmcl::StringView rest = includes.view();
+    while (!rest.isEmpty()) {
+        const char* eol = std::find(rest.begin(), rest.end() - 1, '\n');
+        lines.emplace_back(rest.begin(), eol + 1);
+        rest = bmcl::StringView(eol + 1, rest.end());
+    }
+    std::sort(lines.begin(), lines.end(), [](bmcl::StringView left, bmcl::StringView right) {
+        return std::lexicographical_compare(left.begin(), left.end(), right.begin(), right.end());
+    });
+    for (bmcl::StringView line : lines) {
+        _output->append(line);
+    }
 }
 
-void IncludeGen::genOnboardIncludePaths(const HashSet<Rc<const Type>>* types, bmcl::StringView ext)
+void IncludeGen::genOnboardIncludePaths(const HashSet<const Type*>* types, bmcl::StringView ext)
 {
     _ext = ext;
     _prefix = "photongen/onboard/";
     genIncludePaths<true>(types);
 }
 
-void IncludeGen::genGcIncludePaths(const HashSet<Rc<const Type>>* types, bmcl::StringView ext)
+void IncludeGen::genGcIncludePaths(const HashSet<const Type*>* types, bmcl::StringView ext)
 {
     _ext = ext;
     _prefix = "photongen/groundcontrol/";
@@ -19,14 +19,14 @@ public:
     IncludeGen(SrcBuilder* dest);
 
     //FIXME: pass types by reference
-    void genOnboardIncludePaths(const HashSet<Rc<const Type>>* types, bmcl::StringView ext = ".h");
-    void genGcIncludePaths(const HashSet<Rc<const Type>>* types, bmcl::StringView ext = ".hpp");
+    void genOnboardIncludePaths(const HashSet<const Type*>* types, bmcl::StringView ext = ".h");
+    void genGcIncludePaths(const HashSet<const Type*>* types, bmcl::StringView ext = ".hpp");
 
     void genGcIncludePaths(const Type* type, bmcl::StringView ext = ".hpp");
 
 private:
     template <bool isOnboard>
-    void genIncludePaths(const HashSet<Rc<const Type>>* types);
+    void genIncludePaths(const HashSet<const Type*>* types);
     void genNamedInclude(const NamedType* type);
     void genNamedInclude(const NamedType* type, const NamedType* origin);
 
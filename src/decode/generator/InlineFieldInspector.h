@@ -3,11 +3,31 @@
 #include "decode/Config.h"
 #include "decode/ast/Type.h"
 #include "decode/ast/Field.h"
+#include "decode/ast/WireLayout.h"
+#include "decode/ast/Function.h"
+#include "decode/parser/FlatPackage.h"
 #include "decode/generator/SrcBuilder.h"
 #include "decode/generator/Utils.h"
 
+#include <vector>
+
 namespace decode {
 
+inline const Type* inspectedFieldType(const Field* field)
+{
+    return field->type();
+}
+
+inline const Type* inspectedFieldType(const CmdArgument& arg)
+{
+    return arg.type();
+}
+
+inline const Type* inspectedFieldType(const FlatField& field)
+{
+    return field.type;
+}
+
 template <typename B>
 class InlineFieldInspector {
 public:
@@ -24,36 +44,39 @@ public:
     template <bool isOnboard, bool isSerializer, typename F, typename I>
     void inspect(F&& fields, I* typeInspector)
     {
+        std::vector<const Type*> types;
+        for (auto it = fields.begin(); it != fields.end(); it++) {
+            types.push_back(inspectedFieldType(*it));
+        }
+        Rc<WireLayout> layout = new WireLayout(types);
+        inspect<isOnboard, isSerializer>(fields, layout.get(), typeInspector);
+    }
+
+    // layout must be built from the same fields, it is built on the fly if null
+    template <bool isOnboard, bool isSerializer, typename F, typename I>
+    void inspect(F&& fields, const WireLayout* layout, I* typeInspector)
+    {
+        if (!layout) {
+            inspect<isOnboard, isSerializer>(std::forward<F>(fields), typeInspector);
+            return;
+        }
+
+        // size of fixed size segments is checked once per segment
         InlineSerContext ctx;
-        auto begin = fields.begin();
-        auto it = begin;
-        auto end = fields.end();
-
-        while (it != end) {
-            bmcl::Option<std::size_t> totalSize;
-            while (it != end) {
-                bmcl::Option<std::size_t> size = it->type()->fixedSize();
-                if (size.isNone()) {
-                    break;
-                }
-                totalSize.emplace(totalSize.unwrapOr(0) + size.unwrap());
-                it++;
+        std::size_t i = 0;
+        for (auto it = fields.begin(); it != fields.end(); it++, i++) {
+            const WireFieldLayout& field = layout->fieldAt(i);
+            if (field.segment.isSome() && field.offsetInSegment == 0) {
+                const WireSegment& segment = layout->segments()[field.segment.unwrap()];
+                typeInspector->template appendSizeCheck<isOnboard, isSerializer>(ctx, std::to_string(segment.size), _dest);
             }
-            if (totalSize.isSome()) {
-                typeInspector->template appendSizeCheck<isOnboard, isSerializer>(ctx, std::to_string(totalSize.unwrap()), _dest);
-                for (auto jt = begin; jt < it; jt++) {
-                    base().beginField(*jt);
-                    typeInspector->template inspect<isOnboard, isSerializer>(jt->type(), ctx, base().currentFieldName(), false);
-                    base().endField(*jt);
-                }
-                totalSize.clear();
+            base().beginField(*it);
+            if (field.segment.isSome()) {
+                typeInspector->template inspect<isOnboard, isSerializer>(inspectedFieldType(*it), ctx, base().currentFieldName(), false);
             } else {
-                base().beginField(*it);
-                typeInspector->template inspect<isOnboard, isSerializer>(it->type(), ctx, base().currentFieldName());
-                base().endField(*it);
-                it++;
-                begin = it;
+                typeInspector->template inspect<isOnboard, isSerializer>(inspectedFieldType(*it), ctx, base().currentFieldName());
             }
+            base().endField(*it);
         }
     }
 
@@ -75,11 +98,21 @@ public:
         _argName.append(field->name().begin(), field->name().end());
     }
 
+    void beginField(const FlatField& field)
+    {
+        _argName.append(field.name.begin(), field.name.end());
+    }
+
     void endField(const Field*)
     {
         _argName.resize(_argSize);
     }
 
+    void endField(const FlatField&)
+    {
+        _argName.resize(_argSize);
+    }
+
     void setArgName(bmcl::StringView name)
     {
         _argName.clear();
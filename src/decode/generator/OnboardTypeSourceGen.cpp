@@ -17,8 +17,9 @@ namespace decode {
 
 //TODO: refact
 
-OnboardTypeSourceGen::OnboardTypeSourceGen(SrcBuilder* output)
-    : _output(output)
+OnboardTypeSourceGen::OnboardTypeSourceGen(const FlatPackage* package, SrcBuilder* output)
+    : FlatPackageVisitor<OnboardTypeSourceGen>(package)
+    , _output(output)
     , _inlineInspector(output)
     , _prototypeGen(output)
 {
@@ -42,14 +43,14 @@ void OnboardTypeSourceGen::appendIncludes(bmcl::StringView modName)
     _output->append(".gen.c\"\n");
 }
 
-void OnboardTypeSourceGen::appendEnumSerializer(const EnumType* type)
+void OnboardTypeSourceGen::appendEnumSerializer(const FlatType* type)
 {
     _output->append("    switch(self) {\n");
-    for (const EnumConstant* c : type->constantsRange()) {
+    for (const FlatConstant& c : _package->constants(type->members)) {
         _output->append("    case Photon");
         _output->append(_name);
         _output->append("_");
-        _output->append(c->name());
+        _output->append(c.name);
         _output->append(":\n");
     }
     _output->append("        break;\n"
@@ -62,7 +63,7 @@ void OnboardTypeSourceGen::appendEnumSerializer(const EnumType* type)
     }, "Failed to write enum");
 }
 
-void OnboardTypeSourceGen::appendEnumDeserializer(const EnumType* type)
+void OnboardTypeSourceGen::appendEnumDeserializer(const FlatType* type)
 {
     _output->appendIndent();
     _output->appendVarDecl("int64_t", "value");
@@ -75,13 +76,13 @@ void OnboardTypeSourceGen::appendEnumDeserializer(const EnumType* type)
     }, "Failed to read enum");
 
     _output->append("    switch(value) {\n");
-    for (const EnumConstant* c : type->constantsRange()) {
+    for (const FlatConstant& c : _package->constants(type->members)) {
         _output->append("    case ");
-        _output->appendNumericValue(c->value());
+        _output->appendNumericValue(c.value);
         _output->append(":\n        result = Photon");
         _output->append(_name);
         _output->append("_");
-        _output->append(c->name());
+        _output->append(c.name);
         _output->append(";\n        break;\n");
     }
     _output->append("    default:\n"
@@ -96,19 +97,44 @@ static bmcl::Option<std::size_t> typeFixedSize(const Type* type)
     return type->fixedSize();
 }
 
-void OnboardTypeSourceGen::appendStructSerializer(const StructType* type)
+void OnboardTypeSourceGen::appendStructSerializer(const FlatType* type)
 {
     InlineStructInspector inspector(_output, "self->");
-    inspector.inspect<true, true>(type->fieldsRange(), &_inlineInspector);
+    inspector.inspect<true, true>(_package->fields(type->members), type->wireLayout, &_inlineInspector);
 }
 
-void OnboardTypeSourceGen::appendStructDeserializer(const StructType* type)
+void OnboardTypeSourceGen::appendStructDeserializer(const FlatType* type)
 {
     InlineStructInspector inspector(_output, "self->");
-    inspector.inspect<true, false>(type->fieldsRange(), &_inlineInspector);
+    inspector.inspect<true, false>(_package->fields(type->members), type->wireLayout, &_inlineInspector);
 }
 
-void OnboardTypeSourceGen::appendVariantSerializer(const VariantType* type)
+void OnboardTypeSourceGen::appendVariantFieldInspector(const FlatAlternative& field, bool isSerializer)
+{
+    InlineSerContext ctx(2);
+    StringBuilder argName("self->data.");
+    std::size_t j = 1;
+    for (const FlatField& f : _package->fields(field.fields)) {
+        argName.appendWithFirstLower(field.name);
+        argName.append(_name);
+        if (field.kind == VariantFieldKind::Tuple) {
+            argName.append("._");
+            argName.appendNumericValue(j);
+        } else {
+            argName.append(".");
+            argName.append(f.name);
+        }
+        if (isSerializer) {
+            _inlineInspector.inspect<true, true>(f.type, ctx, argName.view());
+        } else {
+            _inlineInspector.inspect<true, false>(f.type, ctx, argName.view());
+        }
+        argName.resize(11);
+        j++;
+    }
+}
+
+void OnboardTypeSourceGen::appendVariantSerializer(const FlatType* type)
 {
     _output->appendIndent(1);
     _output->appendWithTryMacro([](SrcBuilder* output) {
@@ -116,45 +142,14 @@ void OnboardTypeSourceGen::appendVariantSerializer(const VariantType* type)
     }, "Failed to write variant type");
 
     _output->append("    switch(self->type) {\n");
-    StringBuilder argName("self->data.");
-    for (const VariantField* field : type->fieldsRange()) {
+    for (const FlatAlternative& field : _package->alternatives(type->members)) {
         _output->append("    case Photon");
         _output->append(_name);
         _output->append("Type_");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(": {\n");
 
-        InlineSerContext ctx(2);
-        switch (field->variantFieldKind()) {
-        case VariantFieldKind::Constant:
-            break;
-        case VariantFieldKind::Tuple: {
-            const TupleVariantField* tupField = static_cast<const TupleVariantField*>(field);
-            std::size_t j = 1;
-            for (const Type* t : tupField->typesRange()) {
-                argName.appendWithFirstLower(field->name());
-                argName.append(_name);
-                argName.append("._");
-                argName.appendNumericValue(j);
-                _inlineInspector.inspect<true, true>(t, ctx, argName.view());
-                argName.resize(11);
-                j++;
-            }
-            break;
-        }
-        case VariantFieldKind::Struct: {
-            const StructVariantField* varField = static_cast<const StructVariantField*>(field);
-            for (const Field* f : varField->fieldsRange()) {
-                argName.appendWithFirstLower(field->name());
-                argName.append(_name);
-                argName.append(".");
-                argName.append(f->name());
-                _inlineInspector.inspect<true, true>(f->type(), ctx, argName.view());
-                argName.resize(11);
-            }
-            break;
-        }
-        }
+        appendVariantFieldInspector(field, true);
 
         _output->append("        break;\n"
                         "    }\n");
@@ -165,7 +160,7 @@ void OnboardTypeSourceGen::appendVariantSerializer(const VariantType* type)
                     "    }\n");
 }
 
-void OnboardTypeSourceGen::appendVariantDeserializer(const VariantType* type)
+void OnboardTypeSourceGen::appendVariantDeserializer(const FlatType* type)
 {
     _output->appendIndent();
     _output->appendVarDecl("int64_t", "value");
@@ -176,48 +171,17 @@ void OnboardTypeSourceGen::appendVariantDeserializer(const VariantType* type)
 
     _output->append("    switch(value) {\n");
     std::size_t i = 0;
-    StringBuilder argName("self->data.");
-    for (const VariantField* field : type->fieldsRange()) {
+    for (const FlatAlternative& field : _package->alternatives(type->members)) {
         _output->append("    case ");
         _output->appendNumericValue(i);
         i++;
         _output->append(": {\n        self->type = Photon");
         _output->append(_name);
         _output->append("Type_");
-        _output->appendWithFirstUpper(field->name());
+        _output->appendWithFirstUpper(field.name);
         _output->append(";\n");
 
-        InlineSerContext ctx(2);
-        switch (field->variantFieldKind()) {
-        case VariantFieldKind::Constant:
-            break;
-        case VariantFieldKind::Tuple: {
-            const TupleVariantField* tupField = static_cast<const TupleVariantField*>(field);
-            std::size_t j = 1;
-            for (const Type* t : tupField->typesRange()) {
-                    argName.appendWithFirstLower(field->name());
-                    argName.append(_name);
-                    argName.append("._");
-                    argName.appendNumericValue(j);
-                    _inlineInspector.inspect<true, false>(t, ctx, argName.view());
-                    argName.resize(11);
-                    j++;
-            }
-            break;
-        }
-        case VariantFieldKind::Struct: {
-            const StructVariantField* varField = static_cast<const StructVariantField*>(field);
-            for (const Field* f : varField->fieldsRange()) {
-                argName.appendWithFirstLower(field->name());
-                argName.append(_name);
-                argName.append(".");
-                argName.append(f->name());
-                _inlineInspector.inspect<true, false>(f->type(), ctx, argName.view());
-                argName.resize(11);
-            }
-            break;
-        }
-        }
+        appendVariantFieldInspector(field, false);
 
         _output->append("        break;\n    }\n");
         _output->append("");
@@ -322,58 +286,45 @@ bool OnboardTypeSourceGen::visitDynArrayType(const DynArrayType* type)
     return false;
 }
 
-bool OnboardTypeSourceGen::visitEnumType(const EnumType* type)
+bool OnboardTypeSourceGen::visitEnumType(const FlatType& type, bmcl::ArrayView<FlatConstant>)
 {
-    genSource(type, &OnboardTypeSourceGen::appendEnumSerializer, &OnboardTypeSourceGen::appendEnumDeserializer);
+    genSource(&type, &OnboardTypeSourceGen::appendEnumSerializer, &OnboardTypeSourceGen::appendEnumDeserializer);
     return false;
 }
 
-bool OnboardTypeSourceGen::visitStructType(const StructType* type)
+bool OnboardTypeSourceGen::visitStructType(const FlatType& type, bmcl::ArrayView<FlatField>)
 {
-    genSource(type, &OnboardTypeSourceGen::appendStructSerializer, &OnboardTypeSourceGen::appendStructDeserializer);
+    genSource(&type, &OnboardTypeSourceGen::appendStructSerializer, &OnboardTypeSourceGen::appendStructDeserializer);
     return false;
 }
 
-bool OnboardTypeSourceGen::visitVariantType(const VariantType* type)
+bool OnboardTypeSourceGen::visitVariantType(const FlatType& type, bmcl::ArrayView<FlatAlternative>)
 {
-    genSource(type, &OnboardTypeSourceGen::appendVariantSerializer, &OnboardTypeSourceGen::appendVariantDeserializer);
+    genSource(&type, &OnboardTypeSourceGen::appendVariantSerializer, &OnboardTypeSourceGen::appendVariantDeserializer);
     return false;
 }
 
-void OnboardTypeSourceGen::genTypeSource(const NamedType* type, bmcl::StringView name)
+void OnboardTypeSourceGen::genTypeSource(const FlatType& type, bmcl::StringView name)
 {
     _name = name;
-    _fileName = type->name();
-    _baseType = type;
-    genSource(type, type->moduleName());
-}
-
-void OnboardTypeSourceGen::genTypeSource(const GenericInstantiationType* instantiation, bmcl::StringView name)
-{
-    _name = name;
-    _fileName = name;
-    _baseType = instantiation;
-    const Type* type = instantiation->instantiatedType()->resolveFinalType();
-    _output->appendPragmaOnce(); //HACK
-    genSource(type, "_generic_");
-
-}
+    _baseType = type.type;
+    bmcl::StringView modName;
+    if (type.kind == TypeKind::GenericInstantiation) {
+        _fileName = name;
+        modName = "_generic_";
+        _output->appendPragmaOnce(); //HACK
+    } else {
+        _fileName = type.name;
+        modName = _package->moduleAt(type.module).name;
+    }
 
-void OnboardTypeSourceGen::genSource(const Type* type, bmcl::StringView modName)
-{
     _output->appendPragmaOnce(); //HACK
-    switch (type->typeKind()) {
+    switch (type.bodyKind) {
         case TypeKind::Variant:
-            appendIncludes(modName);
-            visitVariantType(type->asVariant());
-            return;
         case TypeKind::Struct:
-            appendIncludes(modName);
-            visitStructType(type->asStruct());
-            return;
         case TypeKind::Enum:
             appendIncludes(modName);
-            visitEnumType(type->asEnum());
+            traverseType(type);
             return;
         default:
             return;
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "decode/Config.h"
+#include "decode/parser/FlatPackageVisitor.h"
 #include "decode/generator/FuncPrototypeGen.h"
 #include "decode/generator/InlineTypeInspector.h"
 
@@ -21,39 +22,33 @@ namespace decode {
 class SrcBuilder;
 class TypeReprGen;
 class DynArrayType;
-class EnumType;
-class StructType;
-class VariantType;
-class NamedType;
-class DynArrayType;
-class GenericInstantiationType;
 
-class OnboardTypeSourceGen {
+class OnboardTypeSourceGen : public FlatPackageVisitor<OnboardTypeSourceGen> {
 public:
-    OnboardTypeSourceGen(SrcBuilder* output);
+    OnboardTypeSourceGen(const FlatPackage* package, SrcBuilder* output);
     ~OnboardTypeSourceGen();
 
-    void genTypeSource(const NamedType* type, bmcl::StringView name);
-    void genTypeSource(const GenericInstantiationType* type, bmcl::StringView name);
+    // type is a named type or generic instantiation from package tables
+    void genTypeSource(const FlatType& type, bmcl::StringView name);
     void genTypeSource(const DynArrayType* type);
 
+    bool visitEnumType(const FlatType& type, bmcl::ArrayView<FlatConstant> constants);
+    bool visitStructType(const FlatType& type, bmcl::ArrayView<FlatField> fields);
+    bool visitVariantType(const FlatType& type, bmcl::ArrayView<FlatAlternative> alternatives);
+
 private:
     template <typename T, typename F>
     void genSource(const T* type, F&& serGen, F&& deserGen);
 
-    void genSource(const Type* type, bmcl::StringView modName);
-
     bool visitDynArrayType(const DynArrayType* type);
-    bool visitEnumType(const EnumType* type);
-    bool visitStructType(const StructType* type);
-    bool visitVariantType(const VariantType* type);
 
-    void appendEnumSerializer(const EnumType* type);
-    void appendEnumDeserializer(const EnumType* type);
-    void appendStructSerializer(const StructType* type);
-    void appendStructDeserializer(const StructType* type);
-    void appendVariantSerializer(const VariantType* type);
-    void appendVariantDeserializer(const VariantType* type);
+    void appendEnumSerializer(const FlatType* type);
+    void appendEnumDeserializer(const FlatType* type);
+    void appendStructSerializer(const FlatType* type);
+    void appendStructDeserializer(const FlatType* type);
+    void appendVariantSerializer(const FlatType* type);
+    void appendVariantDeserializer(const FlatType* type);
+    void appendVariantFieldInspector(const FlatAlternative& field, bool isSerializer);
     void appendDynArraySerializer(const DynArrayType* type);
     void appendDynArrayDeserializer(const DynArrayType* type);
 
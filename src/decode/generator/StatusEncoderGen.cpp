@@ -9,7 +9,6 @@
 #include "decode/generator/StatusEncoderGen.h"
 #include "decode/core/HashSet.h"
 #include "decode/core/EncodedSizes.h"
-#include "decode/parser/Project.h"
 #include "decode/parser/Package.h"
 #include "decode/generator/TypeReprGen.h"
 #include "decode/generator/IncludeGen.h"
@@ -25,8 +24,9 @@
 
 namespace decode {
 
-StatusEncoderGen::StatusEncoderGen(SrcBuilder* output)
-    : _output(output)
+StatusEncoderGen::StatusEncoderGen(const FlatPackage* package, SrcBuilder* output)
+    : _package(package)
+    , _output(output)
     , _inlineInspector(output)
     , _prototypeGen(output)
 {
@@ -36,6 +36,18 @@ StatusEncoderGen::~StatusEncoderGen()
 {
 }
 
+static inline const StatusMsg* statusMsg(const FlatMsg& msg)
+{
+    assert(msg.kind == FlatMsgKind::Status);
+    return static_cast<const StatusMsg*>(msg.msg);
+}
+
+static inline const EventMsg* eventMsg(const FlatMsg& msg)
+{
+    assert(msg.kind == FlatMsgKind::Event);
+    return static_cast<const EventMsg*>(msg.msg);
+}
+
 static void appendTmDeserializerPrototype(SrcBuilder* dest)
 {
 
@@ -44,7 +56,7 @@ static void appendTmDeserializerPrototype(SrcBuilder* dest)
                     "const void* msg, void* userData), void* userData)");
 }
 
-void StatusEncoderGen::generateStatusDecoderHeader(const Project* project)
+void StatusEncoderGen::generateStatusDecoderHeader()
 {
     _output->startIncludeGuard("PRIVATE", "STATUS_DECODER");
 
@@ -62,11 +74,11 @@ void StatusEncoderGen::generateStatusDecoderHeader(const Project* project)
     _output->endIncludeGuard();
 }
 
-void StatusEncoderGen::generateAutosaveSource(const Project* project)
+void StatusEncoderGen::generateAutosaveSource()
 {
     std::size_t maxSize = 8;
-    for (const Component* comp : project->package()->components()) {
-        for (const VarRegexp* regexp : comp->savedVarsRange()) {
+    for (const FlatComponent& comp : _package->components()) {
+        for (const VarRegexp* regexp : _package->regexps(comp.savedVars)) {
             maxSize += regexp->type()->encodedSizes().max;
         }
     }
@@ -86,10 +98,10 @@ void StatusEncoderGen::generateAutosaveSource(const Project* project)
     _output->append("static PhotonError Photon_SerializeParams(PhotonWriter* dest)\n{\n");
     _output->appendWritableSizeCheck(ctx, 8);
     _output->append("    PhotonWriter_WriteU64Le(dest, _PHOTON_AUTOSAVE_MAX_SIZE);\n");
-    for (const Component* comp : project->package()->components()) {
-        _output->appendModIfdef(comp->moduleName());
-        for (const VarRegexp* regexp : comp->savedVarsRange()) {
-            currentField.appendWithFirstUpper(comp->moduleName());
+    for (const FlatComponent& comp : _package->components()) {
+        _output->appendModIfdef(comp.moduleName);
+        for (const VarRegexp* regexp : _package->regexps(comp.savedVars)) {
+            currentField.appendWithFirstUpper(comp.moduleName);
             appendInlineSerializer(regexp, &currentField, true);
             currentField.resize(7);
         }
@@ -103,10 +115,10 @@ void StatusEncoderGen::generateAutosaveSource(const Project* project)
                     "    if (maxVarSize != _PHOTON_AUTOSAVE_MAX_SIZE) {\n"
                     "        return PhotonError_InvalidValue;\n"
                     "    }\n");
-    for (const Component* comp : project->package()->components()) {
-        _output->appendModIfdef(comp->moduleName());
-        for (const VarRegexp* regexp : comp->savedVarsRange()) {
-            currentField.appendWithFirstUpper(comp->moduleName());
+    for (const FlatComponent& comp : _package->components()) {
+        _output->appendModIfdef(comp.moduleName);
+        for (const VarRegexp* regexp : _package->regexps(comp.savedVars)) {
+            currentField.appendWithFirstUpper(comp.moduleName);
             appendInlineSerializer(regexp, &currentField, false);
             currentField.resize(7);
         }
@@ -117,7 +129,7 @@ void StatusEncoderGen::generateAutosaveSource(const Project* project)
     _output->append("#undef _PHOTON_FNAME");
 }
 
-void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
+void StatusEncoderGen::generateStatusEncoderSource()
 {
     TypeDependsCollector coll;
     TypeDependsCollector::Depends includes;
@@ -130,12 +142,14 @@ void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
         _output->appendOnboardIncludePath(inc);
     }
 
-    for (const Component* comp : project->package()->components()) {
-        coll.collectStatuses(comp->statusesRange(), &includes);
+    for (const FlatComponent& comp : _package->components()) {
+        for (const FlatMsg& msg : _package->msgs(comp.statuses)) {
+            coll.collect(statusMsg(msg), &includes);
+        }
 
-        _output->appendModIfdef(comp->moduleName());
+        _output->appendModIfdef(comp.moduleName);
         includeGen.genOnboardIncludePaths(&includes);
-        _output->appendOnboardComponentInclude(comp->moduleName(), ".h");
+        _output->appendOnboardComponentInclude(comp.moduleName, ".h");
         _output->appendEndif();
 
         includes.clear();
@@ -143,9 +157,11 @@ void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
     _output->appendEol();
     _output->append("#define _PHOTON_FNAME \"photon/StatusEncoder.c\"\n\n");
 
-    for (const ComponentAndMsg& msg : project->package()->statusMsgs()) {
-        _output->appendModIfdef(msg.component->moduleName());
-        _prototypeGen.appendStatusEncoderFunctionPrototype(msg.component.get(), msg.msg.get());
+    for (FlatIndex msgIndex : _package->statusMsgs()) {
+        const FlatMsg& msg = _package->msgAt(msgIndex);
+        const FlatComponent& comp = _package->componentAt(msg.component);
+        _output->appendModIfdef(comp.moduleName);
+        _prototypeGen.appendStatusEncoderFunctionPrototype(comp.comp, statusMsg(msg));
         _output->append("\n{\n");
         _output->append("    (void)dest;\n");
         _output->append("    if (PhotonWriter_WritableSize(dest) < 2) {\n"
@@ -153,14 +169,14 @@ void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
                         "        return PhotonError_NotEnoughSpace;\n"
                         "    }\n");
         _output->append("    PhotonWriter_WriteU8(dest, ");
-        _output->appendNumericValue(msg.component->number());
+        _output->appendNumericValue(comp.number);
         _output->append(");\n    PhotonWriter_WriteU8(dest, ");
-        _output->appendNumericValue(msg.msg->number());
+        _output->appendNumericValue(msg.number);
         _output->append(");\n");
 
-        for (const VarRegexp* part : msg.msg->partsRange()) {
+        for (const VarRegexp* part : _package->regexps(msg.parts)) {
             SrcBuilder currentField("_photon");
-            currentField.appendWithFirstUpper(msg.component->moduleName());
+            currentField.appendWithFirstUpper(comp.moduleName);
             appendInlineSerializer(part, &currentField, true);
         }
         _output->append("    return PhotonError_Ok;\n}\n");
@@ -170,43 +186,30 @@ void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
     _output->append("#undef _PHOTON_FNAME\n");
 }
 
-static void appendInfix(SrcBuilder* dest, const StatusMsg*)
-{
-    dest->append("_StatusMsg_");
-}
-
-static void appendInfix(SrcBuilder* dest, const EventMsg*)
-{
-    dest->append("_EventMsg_");
-}
-
-static void appendPrototype(FuncPrototypeGen* dest, const Component* comp, const StatusMsg* msg)
-{
-    dest->appendStatusDecoderFunctionName(comp, msg);
-}
-
-static void appendPrototype(FuncPrototypeGen* dest, const Component* comp, const EventMsg* msg)
-{
-    dest->appendEventDecoderFunctionName(comp, msg);
-}
-
-template <typename T>
-void StatusEncoderGen::appendMsgSwitch(const Component* comp, const T* msg)
+void StatusEncoderGen::appendMsgSwitch(const FlatComponent& comp, const FlatMsg& msg)
 {
     _output->append("            case ");
-    _output->appendNumericValue(msg->number());
+    _output->appendNumericValue(msg.number);
     _output->append(": {\n");
-    if (!msg->partsRange().empty()) {
+    if (msg.parts.size != 0) {
         _output->append("                Photon");
 
-        _output->appendWithFirstUpper(comp->moduleName());
-        appendInfix(_output, msg);
-        _output->appendWithFirstUpper(msg->name());
+        _output->appendWithFirstUpper(comp.moduleName);
+        if (msg.kind == FlatMsgKind::Status) {
+            _output->append("_StatusMsg_");
+        } else {
+            _output->append("_EventMsg_");
+        }
+        _output->appendWithFirstUpper(msg.name);
 
         _output->append(" msg;\n"
                         "                PHOTON_TRY(");
 
-        appendPrototype(&_prototypeGen, comp, msg);
+        if (msg.kind == FlatMsgKind::Status) {
+            _prototypeGen.appendStatusDecoderFunctionName(comp.comp, statusMsg(msg));
+        } else {
+            _prototypeGen.appendEventDecoderFunctionName(comp.comp, eventMsg(msg));
+        }
 
         _output->append("(src, &msg));\n"
                         "                handler(compId, msgId, &msg, userData);\n"
@@ -219,16 +222,16 @@ void StatusEncoderGen::appendMsgSwitch(const Component* comp, const T* msg)
     }
 }
 
-void StatusEncoderGen::generateStatusDecoderSource(const Project* project)
+void StatusEncoderGen::generateStatusDecoderSource()
 {
     _output->append("#include \"photongen/onboard/StatusDecoder.h\"\n\n");
     _output->appendImplIncludePath("core/Try");
     _output->appendImplIncludePath("core/Logging");
     _output->appendEol();
 
-    for (const Component* comp : project->package()->components()) {
-        _output->appendSourceModIfdef(comp->moduleName());
-        _output->appendOnboardComponentInclude(comp->moduleName(), ".h");
+    for (const FlatComponent& comp : _package->components()) {
+        _output->appendSourceModIfdef(comp.moduleName);
+        _output->appendOnboardComponentInclude(comp.moduleName, ".h");
         _output->appendEndif();
     }
     _output->appendEol();
@@ -239,18 +242,18 @@ void StatusEncoderGen::generateStatusDecoderSource(const Project* project)
     fieldName.reserve(31);
     InlineSerContext ctx;
 
-    for (const Component* comp : project->package()->components()) {
-        if (!comp->hasStatuses() && !comp->hasEvents()) {
+    for (const FlatComponent& comp : _package->components()) {
+        if (comp.statuses.size == 0 && comp.events.size == 0) {
             continue;
         }
-        _output->appendSourceModIfdef(comp->moduleName());
+        _output->appendSourceModIfdef(comp.moduleName);
 
-        for (const StatusMsg* msg : comp->statusesRange()) {
-            _prototypeGen.appendStatusDecoderFunctionPrototype(comp, msg);
+        for (const FlatMsg& msg : _package->msgs(comp.statuses)) {
+            _prototypeGen.appendStatusDecoderFunctionPrototype(comp.comp, statusMsg(msg));
             _output->append("\n{\n");
             _output->append("    (void)src;\n    (void)dest;\n");
 
-            for (const VarRegexp* part : msg->partsRange()) {
+            for (const VarRegexp* part : _package->regexps(msg.parts)) {
                 fieldName.assign("dest->");
                 part->buildFieldName(&fieldName);
                 _inlineInspector.inspect<true, false>(part->type(), ctx, fieldName.view());
@@ -259,16 +262,16 @@ void StatusEncoderGen::generateStatusDecoderSource(const Project* project)
             _output->append("    return PhotonError_Ok;\n}\n\n");
         }
 
-        for (const EventMsg* msg : comp->eventsRange()) {
-            if (msg->partsRange().empty()) {
+        for (const FlatMsg& msg : _package->msgs(comp.events)) {
+            if (msg.parts.size == 0) {
                 continue;
             }
-            _prototypeGen.appendEventDecoderFunctionPrototype(comp, msg);
+            _prototypeGen.appendEventDecoderFunctionPrototype(comp.comp, eventMsg(msg));
             _output->append("\n{\n");
-            for (const Field* part : msg->partsRange()) {
+            for (const FlatField& part : _package->fields(msg.parts)) {
                 fieldName.assign("dest->");
-                fieldName.append(part->name());
-                _inlineInspector.genOnboardDeserializer(part->type(), ctx, fieldName.view());
+                fieldName.append(part.name);
+                _inlineInspector.genOnboardDeserializer(part.type, ctx, fieldName.view());
             }
 
             _output->append("    return PhotonError_Ok;\n}\n\n");
@@ -297,29 +300,29 @@ void StatusEncoderGen::generateStatusDecoderSource(const Project* project)
                     "        msgId = PhotonReader_ReadU8(src);\n\n"
                     "        switch (compId) {\n");
 
-    for (const Component* comp : project->package()->components()) {
+    for (const FlatComponent& comp : _package->components()) {
         _output->append("        case ");
-        _output->appendNumericValue(comp->number());
+        _output->appendNumericValue(comp.number);
         _output->append(": {\n");
 
-        _output->appendSourceModIfdef(comp->moduleName());
+        _output->appendSourceModIfdef(comp.moduleName);
         _output->append("            switch (msgId) {\n");
-        for (const StatusMsg* msg : comp->statusesRange()) {
+        for (const FlatMsg& msg : _package->msgs(comp.statuses)) {
             appendMsgSwitch(comp, msg);
         }
-        for (const EventMsg* msg : comp->eventsRange()) {
+        for (const FlatMsg& msg : _package->msgs(comp.events)) {
             appendMsgSwitch(comp, msg);
         }
 
         _output->append("            default:\n"
                         "                PHOTON_CRITICAL(\"Recieved invalid ");
-        _output->append(comp->name());
+        _output->append(comp.name);
         _output->append(" message id (%u, %u)\", (unsigned)compId, (unsigned)msgId);\n"
                         "                return PhotonError_InvalidMessageId;\n"
                         "            }\n"
                         "#else\n"
                         "            PHOTON_CRITICAL(\"Cannot decode ");
-        _output->append(comp->name());
+        _output->append(comp.name);
         _output->append(" msg, decoder disabled\");\n"
                         "            return PhotonError_InvalidComponentId;\n");
 
@@ -445,14 +448,14 @@ void StatusEncoderGen::appendInlineSerializer(const VarRegexp* part, SrcBuilder*
     }
 }
 
-void StatusEncoderGen::generateEventEncoderSource(const Project* project)
+void StatusEncoderGen::generateEventEncoderSource()
 {
-    for (const Ast* ast : project->package()->modules()) {
-        _output->appendModIfdef(ast->moduleName());
+    for (const FlatModule& module : _package->modules()) {
+        _output->appendModIfdef(module.name);
         _output->append("#include \"photongen/onboard/");
-        _output->append(ast->moduleName());
+        _output->append(module.name);
         _output->append("/");
-        _output->appendWithFirstUpper(ast->moduleName());
+        _output->appendWithFirstUpper(module.name);
         _output->append(".Component.h\"\n");
         _output->appendEndif();
     }
@@ -461,29 +464,29 @@ void StatusEncoderGen::generateEventEncoderSource(const Project* project)
 
     TypeReprGen reprGen(_output);
     _output->appendModIfdef("tm");
-    for (const Component* comp : project->package()->components()) {
-        if (!comp->hasEvents()) {
+    for (const FlatComponent& comp : _package->components()) {
+        if (comp.events.size == 0) {
             continue;
         }
-        _output->appendModIfdef(comp->moduleName());
-        for (const EventMsg* msg : comp->eventsRange()) {
-            _prototypeGen.appendEventEncoderFunctionPrototype(comp, msg, &reprGen);
-            if (msg->partsRange().size() == 0) {
+        _output->appendModIfdef(comp.moduleName);
+        for (const FlatMsg& msg : _package->msgs(comp.events)) {
+            _prototypeGen.appendEventEncoderFunctionPrototype(comp.comp, eventMsg(msg), &reprGen);
+            if (msg.parts.size == 0) {
                 _output->append("\n{\n    PhotonTm_BeginEventMsg(");
             } else {
                 _output->append("\n{\n    PhotonWriter* dest = PhotonTm_BeginEventMsg(");
             }
-            _output->appendNumericValue(comp->number());
+            _output->appendNumericValue(comp.number);
             _output->append(", ");
-            _output->appendNumericValue(msg->number());
+            _output->appendNumericValue(msg.number);
             _output->append(");\n");
 
             InlineSerContext ctx;
             StringBuilder nameBuilder;
             nameBuilder.reserve(15);
-            for (const Field* field : msg->partsRange()) {
-                derefPassedVarNameIfRequired(field->type(), field->name(), &nameBuilder);
-                _inlineInspector.inspect<true, true>(field->type(), ctx, nameBuilder.view());
+            for (const FlatField& field : _package->fields(msg.parts)) {
+                derefPassedVarNameIfRequired(field.type, field.name, &nameBuilder);
+                _inlineInspector.inspect<true, true>(field.type, ctx, nameBuilder.view());
                 nameBuilder.clear();
             }
 
@@ -10,6 +10,7 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/parser/FlatPackage.h"
 #include "decode/generator/FuncPrototypeGen.h"
 #include "decode/generator/InlineTypeInspector.h"
 
@@ -17,32 +18,30 @@
 
 namespace decode {
 
-struct ComponentAndMsg;
 class TypeReprGen;
 class SrcBuilder;
-class Project;
 class VarRegexp;
 class Type;
 
 class StatusEncoderGen {
 public:
-    StatusEncoderGen(SrcBuilder* output);
+    StatusEncoderGen(const FlatPackage* package, SrcBuilder* output);
     ~StatusEncoderGen();
 
-    void generateStatusDecoderHeader(const Project* project);
-    void generateStatusDecoderSource(const Project* project);
+    void generateStatusDecoderHeader();
+    void generateStatusDecoderSource();
 
-    void generateStatusEncoderSource(const Project* project);
+    void generateStatusEncoderSource();
 
-    void generateEventEncoderSource(const Project* project);
+    void generateEventEncoderSource();
 
-    void generateAutosaveSource(const Project* project);
+    void generateAutosaveSource();
 
 private:
     void appendInlineSerializer(const VarRegexp * part, SrcBuilder* currentField, bool isSerializer);
-    template <typename T>
-    void appendMsgSwitch(const Component* comp, const T* msg);
+    void appendMsgSwitch(const FlatComponent& comp, const FlatMsg& msg);
 
+    const FlatPackage* _package;
     SrcBuilder* _output;
     InlineTypeInspector _inlineInspector;
     FuncPrototypeGen _prototypeGen;
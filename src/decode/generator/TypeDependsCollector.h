@@ -24,7 +24,8 @@ class Function;
 
 class TypeDependsCollector : public ConstAstVisitor<TypeDependsCollector> {
 public:
-    using Depends = HashSet<Rc<const Type>>;
+    // types are owned by package
+    using Depends = HashSet<const Type*>;
 
     void collect(const Type* type, Depends* dest);
     void collect(const StatusMsg* msg, Depends* dest);
@@ -6,7 +6,7 @@
 
 namespace decode {
 
-Rc<Type> wrapPassedTypeIntoPointerIfRequired(Type* type)
+const Type* wrapPassedTypeIntoPointerIfRequired(const Type* type, ReferenceType* ptr)
 {
     switch (type->typeKind()) {
     case TypeKind::Reference:
@@ -19,11 +19,14 @@ Rc<Type> wrapPassedTypeIntoPointerIfRequired(Type* type)
     case TypeKind::Struct:
     case TypeKind::Variant:
     case TypeKind::GenericInstantiation:
-        return new ReferenceType(ReferenceKind::Pointer, false, type);
+        ptr->setReferenceKind(ReferenceKind::Pointer);
+        ptr->setMutable(false);
+        ptr->setPointee(const_cast<Type*>(type));
+        return ptr;
     case TypeKind::Imported:
-        return wrapPassedTypeIntoPointerIfRequired(type->asImported()->link());
+        return wrapPassedTypeIntoPointerIfRequired(type->asImported()->link(), ptr);
     case TypeKind::Alias:
-        return wrapPassedTypeIntoPointerIfRequired(type->asAlias()->alias());
+        return wrapPassedTypeIntoPointerIfRequired(type->asAlias()->alias(), ptr);
     case TypeKind::Generic:
         assert(false);
         return nullptr;
@@ -16,8 +16,10 @@
 namespace decode {
 
 class Type;
+class ReferenceType;
 class StringBuilder;
 
-Rc<Type> wrapPassedTypeIntoPointerIfRequired(Type* type);
+// returns type itself or ptr pointing to it, ptr is reused by caller to avoid allocating pointer types
+const Type* wrapPassedTypeIntoPointerIfRequired(const Type* type, ReferenceType* ptr);
 void derefPassedVarNameIfRequired(const Type* type, bmcl::StringView name, StringBuilder* dest);
 }
@@ -0,0 +1,1373 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/parser/AstSerializer.h"
+#include "decode/core/Try.h"
+#include "decode/core/FileInfo.h"
+#include "decode/core/HashMap.h"
+#include "decode/core/HashSet.h"
+#include "decode/core/Location.h"
+#include "decode/core/RangeAttr.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/AllBuiltinTypes.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Constant.h"
+#include "decode/ast/Decl.h"
+#include "decode/ast/DocBlock.h"
+#include "decode/ast/Field.h"
+#include "decode/ast/Function.h"
+#include "decode/ast/ModuleInfo.h"
+#include "decode/ast/Type.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+#include <bmcl/StringView.h>
+#include <bmcl/StringViewHash.h>
+#include <bmcl/ZigZag.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace decode {
+
+enum TypeRefTag : std::uint64_t {
+    nullTypeTag = 0,
+    builtinTypeTag = 1,
+    definitionTypeTag = 2,
+    firstBackrefTypeTag = 3,
+};
+
+enum class TypeAddMode : std::uint8_t {
+    Anonymous,
+    TopLevel,
+    GenericInstantiation,
+};
+
+enum class AccessorTag : std::uint8_t {
+    Field,
+    Index,
+    Range,
+};
+
+static bool isNamedTypeKind(TypeKind kind)
+{
+    switch (kind) {
+    case TypeKind::Enum:
+    case TypeKind::Struct:
+    case TypeKind::Variant:
+    case TypeKind::Imported:
+    case TypeKind::Alias:
+    case TypeKind::Generic:
+    case TypeKind::GenericParameter:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <typename T, typename R, typename L>
+static std::vector<const T*> sortedBy(R range, L&& less)
+{
+    std::vector<const T*> values;
+    for (const T* value : range) {
+        values.push_back(value);
+    }
+    std::sort(values.begin(), values.end(), std::forward<L>(less));
+    return values;
+}
+
+class AstSerializer {
+public:
+    AstSerializer(const Ast* ast, bmcl::Buffer* dest)
+        : _ast(ast)
+        , _dest(dest)
+        , _contents(ast->moduleInfo()->contents())
+    {
+    }
+
+    bool serialize();
+
+private:
+    void writeUint(std::uint64_t value);
+    void writeInt(std::int64_t value);
+    void writeUint8(std::uint8_t value);
+    void writeBool(bool value);
+    bool writeString(bmcl::StringView str);
+    void writeLocation(const Location& loc);
+    bool writeDocs(bmcl::OptionPtr<const DocBlock> docs);
+    void writeNumber(const NumberVariant& value);
+    bool writeField(const Field* field);
+    bool writeFields(FieldVec::ConstRange fields);
+    bool writeTypeRef(const Type* type);
+    bool writeTypeDefinition(const Type* type);
+    bool writeFunction(const Function* func);
+    bool writeFunctions(const ImplBlock* block);
+    bool writeVarRegexp(const VarRegexp* re);
+    bool writeComponent(const Component* comp);
+
+    const Ast* _ast;
+    bmcl::Buffer* _dest;
+    bmcl::StringView _contents;
+    HashMap<const Type*, std::size_t> _typeIndexes;
+};
+
+void AstSerializer::writeUint(std::uint64_t value)
+{
+    _dest->writeVarUint(value);
+}
+
+void AstSerializer::writeInt(std::int64_t value)
+{
+    _dest->writeVarUint(bmcl::zigZagEncode(value));
+}
+
+void AstSerializer::writeUint8(std::uint8_t value)
+{
+    _dest->writeUint8(value);
+}
+
+void AstSerializer::writeBool(bool value)
+{
+    _dest->writeUint8(value);
+}
+
+bool AstSerializer::writeString(bmcl::StringView str)
+{
+    writeUint(str.size());
+    if (str.isEmpty()) {
+        return true;
+    }
+    if (str.begin() < _contents.begin() || str.end() > _contents.end()) {
+        return false;
+    }
+    writeUint(str.begin() - _contents.begin());
+    return true;
+}
+
+void AstSerializer::writeLocation(const Location& loc)
+{
+    writeUint(loc.offset);
+}
+
+bool AstSerializer::writeDocs(bmcl::OptionPtr<const DocBlock> docs)
+{
+    writeBool(docs.isSome());
+    if (docs.isNone()) {
+        return true;
+    }
+    TRY(writeString(docs->shortDescription()));
+    writeUint(docs->longDescription().size());
+    for (bmcl::StringView desc : docs->longDescription()) {
+        TRY(writeString(desc));
+    }
+    return true;
+}
+
+void AstSerializer::writeNumber(const NumberVariant& value)
+{
+    writeUint8((std::uint8_t)value.kind());
+    switch (value.kind()) {
+    case NumberVariantKind::None:
+        return;
+    case NumberVariantKind::Signed:
+        writeInt(value.as<std::intmax_t>());
+        return;
+    case NumberVariantKind::Unsigned:
+        writeUint(value.as<std::uintmax_t>());
+        return;
+    case NumberVariantKind::Double: {
+        double d = value.as<double>();
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        writeUint(bits);
+        return;
+    }
+    }
+}
+
+bool AstSerializer::writeField(const Field* field)
+{
+    TRY(writeString(field->name()));
+    TRY(writeDocs(field->docs()));
+    TRY(writeTypeRef(field->type()));
+    auto attr = field->rangeAttribute();
+    writeBool(attr.isSome());
+    if (attr.isSome()) {
+        writeNumber(attr->minValue());
+        writeNumber(attr->maxValue());
+        writeNumber(attr->defaultValue());
+    }
+    return true;
+}
+
+bool AstSerializer::writeFields(FieldVec::ConstRange fields)
+{
+    writeUint(fields.size());
+    for (const Field* field : fields) {
+        TRY(writeField(field));
+    }
+    return true;
+}
+
+bool AstSerializer::writeTypeRef(const Type* type)
+{
+    if (!type) {
+        writeUint(nullTypeTag);
+        return true;
+    }
+    if (type->isBuiltin()) {
+        writeUint(builtinTypeTag);
+        writeUint8((std::uint8_t)type->asBuiltin()->builtinTypeKind());
+        return true;
+    }
+    auto it = _typeIndexes.find(type);
+    if (it != _typeIndexes.end()) {
+        writeUint(firstBackrefTypeTag + it->second);
+        return true;
+    }
+    writeUint(definitionTypeTag);
+    // index is assigned before children are written, reader reserves a slot in the same order
+    _typeIndexes.emplace(type, _typeIndexes.size());
+    return writeTypeDefinition(type);
+}
+
+bool AstSerializer::writeTypeDefinition(const Type* type)
+{
+    writeUint8((std::uint8_t)type->typeKind());
+    TRY(writeDocs(type->docs()));
+    if (isNamedTypeKind(type->typeKind())) {
+        const NamedType* named = static_cast<const NamedType*>(type);
+        if (named->moduleInfo() != _ast->moduleInfo()) {
+            return false;
+        }
+        TRY(writeString(named->name()));
+    }
+
+    switch (type->typeKind()) {
+    case TypeKind::Builtin:
+        return false;
+    case TypeKind::Reference: {
+        const ReferenceType* ref = type->asReference();
+        writeUint8((std::uint8_t)ref->referenceKind());
+        writeBool(ref->isMutable());
+        return writeTypeRef(ref->pointee());
+    }
+    case TypeKind::Array: {
+        const ArrayType* array = type->asArray();
+        writeUint(array->elementCount());
+        return writeTypeRef(array->elementType());
+    }
+    case TypeKind::DynArray: {
+        const DynArrayType* dynArray = type->asDynArray();
+        writeUint(dynArray->maxSize());
+        return writeTypeRef(dynArray->elementType());
+    }
+    case TypeKind::Function: {
+        const FunctionType* func = type->asFunction();
+        bmcl::Option<SelfArgument> self = func->selfArgument();
+        writeUint8(self.isSome() ? 1 + (std::uint8_t)self.unwrap() : 0);
+        TRY(writeFields(func->argumentsRange()));
+        return writeTypeRef(func->returnValue().data());
+    }
+    case TypeKind::Enum: {
+        const EnumType* enumeration = type->asEnum();
+        writeUint(enumeration->constantsRange().size());
+        for (const EnumConstant* c : enumeration->constantsRange()) {
+            TRY(writeString(c->name()));
+            TRY(writeDocs(c->docs()));
+            writeInt(c->value());
+            writeBool(c->isUserSet());
+        }
+        return true;
+    }
+    case TypeKind::Struct:
+        return writeFields(type->asStruct()->fieldsRange());
+    case TypeKind::Variant: {
+        const VariantType* variant = type->asVariant();
+        writeUint(variant->fieldsRange().size());
+        for (const VariantField* field : variant->fieldsRange()) {
+            writeUint8((std::uint8_t)field->variantFieldKind());
+            writeUint(field->id());
+            TRY(writeString(field->name()));
+            TRY(writeDocs(field->docs()));
+            switch (field->variantFieldKind()) {
+            case VariantFieldKind::Constant:
+                break;
+            case VariantFieldKind::Tuple:
+                writeUint(field->asTupleField()->typesRange().size());
+                for (const Type* t : field->asTupleField()->typesRange()) {
+                    TRY(writeTypeRef(t));
+                }
+                break;
+            case VariantFieldKind::Struct:
+                TRY(writeFields(field->asStructField()->fieldsRange()));
+                break;
+            }
+        }
+        return true;
+    }
+    case TypeKind::Imported:
+        return writeString(type->asImported()->importPath());
+    case TypeKind::Alias:
+        return writeTypeRef(type->asAlias()->alias());
+    case TypeKind::Generic: {
+        const GenericType* generic = type->asGeneric();
+        writeUint(generic->parametersRange().size());
+        for (const GenericParameterType* param : generic->parametersRange()) {
+            TRY(writeTypeRef(param));
+        }
+        return writeTypeRef(generic->innerType());
+    }
+    case TypeKind::GenericInstantiation: {
+        const GenericInstantiationType* instantiation = type->asGenericInstantiation();
+        TRY(writeString(instantiation->genericName()));
+        writeUint(instantiation->substitutedTypesRange().size());
+        for (const Type* t : instantiation->substitutedTypesRange()) {
+            TRY(writeTypeRef(t));
+        }
+        return writeTypeRef(instantiation->instantiatedType());
+    }
+    case TypeKind::GenericParameter:
+        return true;
+    }
+    return false;
+}
+
+bool AstSerializer::writeFunction(const Function* func)
+{
+    TRY(writeString(func->name()));
+    TRY(writeDocs(func->docs()));
+    return writeTypeRef(func->type());
+}
+
+bool AstSerializer::writeFunctions(const ImplBlock* block)
+{
+    writeUint(block->functionsRange().size());
+    for (const Function* func : block->functionsRange()) {
+        TRY(writeFunction(func));
+    }
+    return true;
+}
+
+bool AstSerializer::writeVarRegexp(const VarRegexp* re)
+{
+    writeUint(re->accessorsRange().size());
+    for (const Accessor* acc : re->accessorsRange()) {
+        if (acc->isFieldAccessor()) {
+            writeUint8((std::uint8_t)AccessorTag::Field);
+            TRY(writeString(acc->asFieldAccessor()->value()));
+            continue;
+        }
+        const SubscriptAccessor* subscript = acc->asSubscriptAccessor();
+        if (subscript->isIndex()) {
+            writeUint8((std::uint8_t)AccessorTag::Index);
+            writeUint(subscript->asIndex());
+            continue;
+        }
+        const Range& range = subscript->asRange();
+        writeUint8((std::uint8_t)AccessorTag::Range);
+        writeUint8(std::uint8_t(range.lowerBound.isSome()) | (std::uint8_t(range.upperBound.isSome()) << 1));
+        if (range.lowerBound.isSome()) {
+            writeUint(range.lowerBound.unwrap());
+        }
+        if (range.upperBound.isSome()) {
+            writeUint(range.upperBound.unwrap());
+        }
+    }
+    return true;
+}
+
+bool AstSerializer::writeComponent(const Component* comp)
+{
+    writeUint(comp->number());
+    TRY(writeFields(comp->varsRange()));
+
+    writeUint(comp->cmdsRange().size());
+    for (const Command* cmd : comp->cmdsRange()) {
+        TRY(writeFunction(cmd));
+        writeUint(cmd->number());
+        writeUint(cmd->argumentsRange().size());
+        for (const CmdArgument& arg : cmd->argumentsRange()) {
+            writeUint8((std::uint8_t)arg.argPassKind());
+        }
+    }
+
+    auto statuses = sortedBy<StatusMsg>(comp->statusesRange(), [](const StatusMsg* left, const StatusMsg* right) {
+        return left->number() < right->number();
+    });
+    writeUint(statuses.size());
+    for (const StatusMsg* msg : statuses) {
+        TRY(writeString(msg->name()));
+        writeUint(msg->number());
+        writeUint(msg->priority());
+        writeBool(msg->isEnabled());
+        writeUint(msg->partsRange().size());
+        for (const VarRegexp* part : msg->partsRange()) {
+            TRY(writeVarRegexp(part));
+        }
+    }
+
+    auto events = sortedBy<EventMsg>(comp->eventsRange(), [](const EventMsg* left, const EventMsg* right) {
+        return left->number() < right->number();
+    });
+    writeUint(events.size());
+    for (const EventMsg* msg : events) {
+        TRY(writeString(msg->name()));
+        writeUint(msg->number());
+        writeBool(msg->isEnabled());
+        TRY(writeFields(msg->partsRange()));
+    }
+
+    auto params = sortedBy<Parameter>(comp->paramsRange(), [](const Parameter* left, const Parameter* right) {
+        return left->name().begin() < right->name().begin();
+    });
+    writeUint(params.size());
+    for (const Parameter* param : params) {
+        TRY(writeString(param->name()));
+        writeUint(param->number());
+        writeBool(param->isReadOnly());
+        writeBool(param->hasAutoSave());
+        writeBool(param->hasCallback());
+        writeUint(param->pathPartsRange().size());
+        for (const FieldAccessor* acc : param->pathPartsRange()) {
+            TRY(writeString(acc->value()));
+        }
+    }
+
+    writeUint(comp->savedVarsRange().size());
+    for (const VarRegexp* re : comp->savedVarsRange()) {
+        TRY(writeVarRegexp(re));
+    }
+
+    writeBool(comp->implBlock().isSome());
+    if (comp->implBlock().isSome()) {
+        TRY(writeFunctions(comp->implBlock().unwrap()));
+    }
+    return true;
+}
+
+bool AstSerializer::serialize()
+{
+    const ModuleInfo* info = _ast->moduleInfo();
+    const ModuleDecl* decl = _ast->moduleDecl();
+    TRY(writeString(info->moduleName()));
+    TRY(writeDocs(info->docs()));
+    writeLocation(decl->startLocation());
+    writeLocation(decl->endLocation());
+
+    std::size_t numImported = 0;
+    writeUint(_ast->importsRange().size());
+    for (const ImportDecl* import : _ast->importsRange()) {
+        TRY(writeString(import->path()));
+        writeUint(import->typesRange().size());
+        for (const ImportedType* type : import->typesRange()) {
+            TRY(writeTypeRef(type));
+            numImported++;
+        }
+    }
+
+    // imported types are the first entries of Ast::typesRange(), they are readded by Ast::addTypeImport
+    HashSet<const Type*> instantiations;
+    for (const GenericInstantiationType* type : _ast->genericInstantiationsRange()) {
+        instantiations.insert(type);
+    }
+    std::size_t numTypes = _ast->typesRange().size();
+    if (numTypes < numImported) {
+        return false;
+    }
+    writeUint(numTypes - numImported);
+    std::size_t i = 0;
+    for (const Type* type : _ast->typesRange()) {
+        if (i++ < numImported) {
+            if (!type->isImported()) {
+                return false;
+            }
+            continue;
+        }
+        TypeAddMode mode = TypeAddMode::Anonymous;
+        if (instantiations.count(type)) {
+            mode = TypeAddMode::GenericInstantiation;
+        } else if (isNamedTypeKind(type->typeKind())) {
+            auto topLevel = _ast->findTypeWithName(static_cast<const NamedType*>(type)->name());
+            if (topLevel.isSome() && topLevel.unwrap() == type) {
+                mode = TypeAddMode::TopLevel;
+            }
+        }
+        writeUint8((std::uint8_t)mode);
+        TRY(writeTypeRef(type));
+    }
+
+    auto constants = sortedBy<Constant>(_ast->constantsRange(), [](const Constant* left, const Constant* right) {
+        return left->name().begin() < right->name().begin();
+    });
+    writeUint(constants.size());
+    for (const Constant* c : constants) {
+        TRY(writeString(c->name()));
+        TRY(writeTypeRef(c->type()));
+        writeUint(c->value());
+    }
+
+    std::vector<const ImplBlock*> blocks;
+    for (const ImplBlock* block : _ast->implBlocksRange()) {
+        blocks.push_back(block);
+    }
+    std::sort(blocks.begin(), blocks.end(), [](const ImplBlock* left, const ImplBlock* right) {
+        return left->name().begin() < right->name().begin();
+    });
+    writeUint(blocks.size());
+    for (const ImplBlock* block : blocks) {
+        TRY(writeString(block->name()));
+        writeLocation(block->startLocation());
+        TRY(writeFunctions(block));
+    }
+
+    writeBool(_ast->component().isSome());
+    if (_ast->component().isSome()) {
+        TRY(writeComponent(_ast->component().unwrap()));
+    }
+    return true;
+}
+
+class AstDeserializer {
+public:
+    AstDeserializer(bmcl::MemReader* src, const FileInfo* finfo, AllBuiltinTypes* builtinTypes)
+        : _src(src)
+        , _fileInfo(finfo)
+        , _builtinTypes(builtinTypes)
+        , _contents(finfo->contents())
+    {
+    }
+
+    bmcl::Result<Rc<Ast>, std::string> deserialize();
+
+private:
+    bool setError(const char* msg);
+    bool readUint(std::uint64_t* dest);
+    bool readInt(std::int64_t* dest);
+    bool readUint8(std::uint8_t* dest);
+    bool readBool(bool* dest);
+    template <typename E>
+    bool readEnum(E* dest, E last);
+    bool readString(bmcl::StringView* dest);
+    bool readLocation(Location* dest);
+    bool readDocs(Rc<DocBlock>* dest);
+    bool readNumber(NumberVariant* dest);
+    bool readField(Rc<Field>* dest);
+    template <typename F>
+    bool readFields(F&& add);
+    bool readTypeRef(Rc<Type>* dest);
+    bool readNonNullTypeRef(Rc<Type>* dest);
+    bool readNamedTypeRef(Rc<NamedType>* dest);
+    bool readTypeDefinition(Rc<Type>* dest);
+    bool readFunctionParts(bmcl::StringView* name, Rc<DocBlock>* docs, Rc<FunctionType>* type);
+    bool readFunctions(ImplBlock* block);
+    bool readVarRegexp(Rc<VarRegexp>* dest);
+    bool readComponent();
+    bool readAst();
+    BuiltinType* builtinType(BuiltinTypeKind kind);
+
+    bmcl::MemReader* _src;
+    const FileInfo* _fileInfo;
+    AllBuiltinTypes* _builtinTypes;
+    bmcl::StringView _contents;
+    Rc<Ast> _ast;
+    Rc<ModuleInfo> _moduleInfo;
+    RcVec<Type> _types;
+    std::string _error;
+};
+
+bool AstDeserializer::setError(const char* msg)
+{
+    if (_error.empty()) {
+        _error = msg;
+    }
+    return false;
+}
+
+bool AstDeserializer::readUint(std::uint64_t* dest)
+{
+    if (!_src->readVarUint(dest)) {
+        return setError("unexpected end of data");
+    }
+    return true;
+}
+
+bool AstDeserializer::readInt(std::int64_t* dest)
+{
+    std::uint64_t value;
+    TRY(readUint(&value));
+    *dest = bmcl::zigZagDecode(value);
+    return true;
+}
+
+bool AstDeserializer::readUint8(std::uint8_t* dest)
+{
+    if (_src->readableSize() < 1) {
+        return setError("unexpected end of data");
+    }
+    *dest = _src->readUint8();
+    return true;
+}
+
+bool AstDeserializer::readBool(bool* dest)
+{
+    std::uint8_t value;
+    TRY(readUint8(&value));
+    if (value > 1) {
+        return setError("invalid boolean value");
+    }
+    *dest = value;
+    return true;
+}
+
+template <typename E>
+bool AstDeserializer::readEnum(E* dest, E last)
+{
+    std::uint8_t value;
+    TRY(readUint8(&value));
+    if (value > (std::uint8_t)last) {
+        return setError("invalid enum value");
+    }
+    *dest = (E)value;
+    return true;
+}
+
+bool AstDeserializer::readString(bmcl::StringView* dest)
+{
+    std::uint64_t size;
+    TRY(readUint(&size));
+    if (size == 0) {
+        *dest = bmcl::StringView::empty();
+        return true;
+    }
+    std::uint64_t offset;
+    TRY(readUint(&offset));
+    if (offset > _contents.size() || size > (_contents.size() - offset)) {
+        return setError("string is out of file bounds");
+    }
+    *dest = bmcl::StringView(_contents.begin() + offset, size);
+    return true;
+}
+
+bool AstDeserializer::readLocation(Location* dest)
+{
+    std::uint64_t offset;
+    TRY(readUint(&offset));
+    if (offset > _contents.size()) {
+        return setError("location is out of file bounds");
+    }
+    *dest = Location(offset);
+    return true;
+}
+
+bool AstDeserializer::readDocs(Rc<DocBlock>* dest)
+{
+    bool hasDocs;
+    TRY(readBool(&hasDocs));
+    if (!hasDocs) {
+        *dest = nullptr;
+        return true;
+    }
+    bmcl::StringView shortDesc;
+    TRY(readString(&shortDesc));
+    std::uint64_t size;
+    TRY(readUint(&size));
+    DocBlock::DocVec longDesc;
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView desc;
+        TRY(readString(&desc));
+        longDesc.push_back(desc);
+    }
+    *dest = new DocBlock(shortDesc, std::move(longDesc));
+    return true;
+}
+
+bool AstDeserializer::readNumber(NumberVariant* dest)
+{
+    NumberVariantKind kind;
+    TRY(readEnum(&kind, NumberVariantKind::Double));
+    switch (kind) {
+    case NumberVariantKind::None:
+        *dest = NumberVariant();
+        return true;
+    case NumberVariantKind::Signed: {
+        std::int64_t value;
+        TRY(readInt(&value));
+        *dest = NumberVariant(std::intmax_t(value));
+        return true;
+    }
+    case NumberVariantKind::Unsigned: {
+        std::uint64_t value;
+        TRY(readUint(&value));
+        *dest = NumberVariant(std::uintmax_t(value));
+        return true;
+    }
+    case NumberVariantKind::Double: {
+        std::uint64_t bits;
+        TRY(readUint(&bits));
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        *dest = NumberVariant(value);
+        return true;
+    }
+    }
+    return false;
+}
+
+bool AstDeserializer::readField(Rc<Field>* dest)
+{
+    bmcl::StringView name;
+    Rc<DocBlock> docs;
+    Rc<Type> type;
+    bool hasRangeAttr;
+    TRY(readString(&name));
+    TRY(readDocs(&docs));
+    TRY(readNonNullTypeRef(&type));
+    TRY(readBool(&hasRangeAttr));
+    Rc<Field> field = new Field(name, type.get());
+    field->setDocs(docs.get());
+    if (hasRangeAttr) {
+        Rc<RangeAttr> attr = new RangeAttr;
+        NumberVariant value;
+        TRY(readNumber(&value));
+        attr->setMinValue(std::move(value));
+        TRY(readNumber(&value));
+        attr->setMaxValue(std::move(value));
+        TRY(readNumber(&value));
+        attr->setDefaultValue(std::move(value));
+        field->setRangeAttribute(attr.get());
+    }
+    *dest = std::move(field);
+    return true;
+}
+
+template <typename F>
+bool AstDeserializer::readFields(F&& add)
+{
+    std::uint64_t size;
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        Rc<Field> field;
+        TRY(readField(&field));
+        add(field.get());
+    }
+    return true;
+}
+
+BuiltinType* AstDeserializer::builtinType(BuiltinTypeKind kind)
+{
+    switch (kind) {
+    case BuiltinTypeKind::USize:
+        return _builtinTypes->usizeType();
+    case BuiltinTypeKind::ISize:
+        return _builtinTypes->isizeType();
+    case BuiltinTypeKind::Varint:
+        return _builtinTypes->varintType();
+    case BuiltinTypeKind::Varuint:
+        return _builtinTypes->varuintType();
+    case BuiltinTypeKind::U8:
+        return _builtinTypes->u8Type();
+    case BuiltinTypeKind::I8:
+        return _builtinTypes->i8Type();
+    case BuiltinTypeKind::U16:
+        return _builtinTypes->u16Type();
+    case BuiltinTypeKind::I16:
+        return _builtinTypes->i16Type();
+    case BuiltinTypeKind::U32:
+        return _builtinTypes->u32Type();
+    case BuiltinTypeKind::I32:
+        return _builtinTypes->i32Type();
+    case BuiltinTypeKind::U64:
+        return _builtinTypes->u64Type();
+    case BuiltinTypeKind::I64:
+        return _builtinTypes->i64Type();
+    case BuiltinTypeKind::F32:
+        return _builtinTypes->f32Type();
+    case BuiltinTypeKind::F64:
+        return _builtinTypes->f64Type();
+    case BuiltinTypeKind::Bool:
+        return _builtinTypes->boolType();
+    case BuiltinTypeKind::Void:
+        return _builtinTypes->voidType();
+    case BuiltinTypeKind::Char:
+        return _builtinTypes->charType();
+    }
+    return nullptr;
+}
+
+bool AstDeserializer::readTypeRef(Rc<Type>* dest)
+{
+    std::uint64_t tag;
+    TRY(readUint(&tag));
+    switch (tag) {
+    case nullTypeTag:
+        *dest = nullptr;
+        return true;
+    case builtinTypeTag: {
+        BuiltinTypeKind kind;
+        TRY(readEnum(&kind, BuiltinTypeKind::Char));
+        *dest = builtinType(kind);
+        return true;
+    }
+    case definitionTypeTag:
+        return readTypeDefinition(dest);
+    }
+    std::uint64_t index = tag - firstBackrefTypeTag;
+    if (index >= _types.size() || _types[index].isNull()) {
+        return setError("invalid type reference");
+    }
+    *dest = _types[index];
+    return true;
+}
+
+bool AstDeserializer::readNonNullTypeRef(Rc<Type>* dest)
+{
+    TRY(readTypeRef(dest));
+    if (dest->isNull()) {
+        return setError("unexpected null type");
+    }
+    return true;
+}
+
+bool AstDeserializer::readNamedTypeRef(Rc<NamedType>* dest)
+{
+    Rc<Type> type;
+    TRY(readNonNullTypeRef(&type));
+    if (!isNamedTypeKind(type->typeKind())) {
+        return setError("expected named type");
+    }
+    *dest = static_cast<NamedType*>(type.get());
+    return true;
+}
+
+bool AstDeserializer::readTypeDefinition(Rc<Type>* dest)
+{
+    // named types can be referenced by their children, their slots are filled before reading them
+    std::size_t index = _types.size();
+    _types.emplace_back();
+    TypeKind kind;
+    Rc<DocBlock> docs;
+    bmcl::StringView name;
+    TRY(readEnum(&kind, TypeKind::GenericParameter));
+    TRY(readDocs(&docs));
+    if (isNamedTypeKind(kind)) {
+        TRY(readString(&name));
+    }
+
+    Rc<Type> type;
+    switch (kind) {
+    case TypeKind::Builtin:
+        return setError("unexpected builtin type definition");
+    case TypeKind::Reference: {
+        ReferenceKind refKind;
+        bool isMutable;
+        Rc<Type> pointee;
+        TRY(readEnum(&refKind, ReferenceKind::Reference));
+        TRY(readBool(&isMutable));
+        TRY(readNonNullTypeRef(&pointee));
+        type = new ReferenceType(refKind, isMutable, pointee.get());
+        break;
+    }
+    case TypeKind::Array: {
+        std::uint64_t count;
+        Rc<Type> elementType;
+        TRY(readUint(&count));
+        TRY(readNonNullTypeRef(&elementType));
+        type = new ArrayType(count, elementType.get());
+        break;
+    }
+    case TypeKind::DynArray: {
+        std::uint64_t maxSize;
+        Rc<Type> elementType;
+        TRY(readUint(&maxSize));
+        TRY(readNonNullTypeRef(&elementType));
+        type = new DynArrayType(maxSize, elementType.get());
+        break;
+    }
+    case TypeKind::Function: {
+        Rc<FunctionType> func = new FunctionType;
+        _types[index] = func;
+        std::uint8_t self;
+        TRY(readUint8(&self));
+        if (self > 1 + (std::uint8_t)SelfArgument::Value) {
+            return setError("invalid self argument");
+        }
+        if (self != 0) {
+            func->setSelfArgument(SelfArgument(self - 1));
+        }
+        TRY(readFields([&func](Field* field) {
+            func->addArgument(field);
+        }));
+        Rc<Type> returnValue;
+        TRY(readTypeRef(&returnValue));
+        func->setReturnValue(returnValue.get());
+        type = func;
+        break;
+    }
+    case TypeKind::Enum: {
+        Rc<EnumType> enumeration = new EnumType(name, _moduleInfo.get());
+        _types[index] = enumeration;
+        std::uint64_t size;
+        TRY(readUint(&size));
+        for (std::uint64_t i = 0; i < size; i++) {
+            bmcl::StringView constantName;
+            Rc<DocBlock> constantDocs;
+            std::int64_t value;
+            bool isUserSet;
+            TRY(readString(&constantName));
+            TRY(readDocs(&constantDocs));
+            TRY(readInt(&value));
+            TRY(readBool(&isUserSet));
+            Rc<EnumConstant> constant = new EnumConstant(constantName, value, isUserSet);
+            constant->setDocs(constantDocs.get());
+            enumeration->addConstant(constant.get());
+        }
+        type = enumeration;
+        break;
+    }
+    case TypeKind::Struct: {
+        Rc<StructType> structure = new StructType(name, _moduleInfo.get());
+        _types[index] = structure;
+        TRY(readFields([&structure](Field* field) {
+            structure->addField(field);
+        }));
+        type = structure;
+        break;
+    }
+    case TypeKind::Variant: {
+        Rc<VariantType> variant = new VariantType(name, _moduleInfo.get());
+        _types[index] = variant;
+        std::uint64_t size;
+        TRY(readUint(&size));
+        for (std::uint64_t i = 0; i < size; i++) {
+            VariantFieldKind fieldKind;
+            std::uint64_t id;
+            bmcl::StringView fieldName;
+            Rc<DocBlock> fieldDocs;
+            TRY(readEnum(&fieldKind, VariantFieldKind::Struct));
+            TRY(readUint(&id));
+            TRY(readString(&fieldName));
+            TRY(readDocs(&fieldDocs));
+            Rc<VariantField> field;
+            switch (fieldKind) {
+            case VariantFieldKind::Constant:
+                field = new ConstantVariantField(id, fieldName);
+                break;
+            case VariantFieldKind::Tuple: {
+                Rc<TupleVariantField> tuple = new TupleVariantField(id, fieldName);
+                std::uint64_t numTypes;
+                TRY(readUint(&numTypes));
+                for (std::uint64_t j = 0; j < numTypes; j++) {
+                    Rc<Type> t;
+                    TRY(readNonNullTypeRef(&t));
+                    tuple->addType(t.get());
+                }
+                field = tuple;
+                break;
+            }
+            case VariantFieldKind::Struct: {
+                Rc<StructVariantField> structure = new StructVariantField(id, fieldName);
+                TRY(readFields([&structure](Field* f) {
+                    structure->addField(f);
+                }));
+                field = structure;
+                break;
+            }
+            }
+            field->setDocs(fieldDocs.get());
+            variant->addField(field.get());
+        }
+        type = variant;
+        break;
+    }
+    case TypeKind::Imported: {
+        bmcl::StringView importPath;
+        TRY(readString(&importPath));
+        type = new ImportedType(name, importPath, _moduleInfo.get());
+        break;
+    }
+    case TypeKind::Alias: {
+        Rc<Type> alias;
+        TRY(readNonNullTypeRef(&alias));
+        type = new AliasType(name, _moduleInfo.get(), alias.get());
+        break;
+    }
+    case TypeKind::Generic: {
+        std::uint64_t size;
+        TRY(readUint(&size));
+        RcVec<GenericParameterType> params;
+        for (std::uint64_t i = 0; i < size; i++) {
+            Rc<Type> param;
+            TRY(readNonNullTypeRef(&param));
+            if (!param->isGenericParameter()) {
+                return setError("expected generic parameter");
+            }
+            params.emplace_back(param->asGenericParemeter());
+        }
+        Rc<NamedType> inner;
+        TRY(readNamedTypeRef(&inner));
+        type = new GenericType(name, params, inner.get());
+        break;
+    }
+    case TypeKind::GenericInstantiation: {
+        bmcl::StringView genericName;
+        TRY(readString(&genericName));
+        std::uint64_t size;
+        TRY(readUint(&size));
+        RcVec<Type> substituted;
+        for (std::uint64_t i = 0; i < size; i++) {
+            Rc<Type> t;
+            TRY(readNonNullTypeRef(&t));
+            substituted.push_back(std::move(t));
+        }
+        Rc<NamedType> instantiated;
+        TRY(readNamedTypeRef(&instantiated));
+        type = new GenericInstantiationType(genericName, substituted, instantiated.get());
+        break;
+    }
+    case TypeKind::GenericParameter:
+        type = new GenericParameterType(name, _moduleInfo.get());
+        break;
+    }
+
+    type->setDocs(docs.get());
+    _types[index] = type;
+    *dest = std::move(type);
+    return true;
+}
+
+bool AstDeserializer::readFunctionParts(bmcl::StringView* name, Rc<DocBlock>* docs, Rc<FunctionType>* type)
+{
+    TRY(readString(name));
+    TRY(readDocs(docs));
+    Rc<Type> t;
+    TRY(readNonNullTypeRef(&t));
+    if (!t->isFunction()) {
+        return setError("expected function type");
+    }
+    *type = t->asFunction();
+    return true;
+}
+
+bool AstDeserializer::readFunctions(ImplBlock* block)
+{
+    std::uint64_t size;
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView name;
+        Rc<DocBlock> docs;
+        Rc<FunctionType> type;
+        TRY(readFunctionParts(&name, &docs, &type));
+        Rc<Function> func = new Function(name, type.get());
+        func->setDocs(docs.get());
+        block->addFunction(func.get());
+    }
+    return true;
+}
+
+bool AstDeserializer::readVarRegexp(Rc<VarRegexp>* dest)
+{
+    Rc<VarRegexp> re = new VarRegexp;
+    std::uint64_t size;
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        AccessorTag tag;
+        TRY(readEnum(&tag, AccessorTag::Range));
+        Rc<Accessor> acc;
+        switch (tag) {
+        case AccessorTag::Field: {
+            bmcl::StringView value;
+            TRY(readString(&value));
+            acc = new FieldAccessor(value, nullptr);
+            break;
+        }
+        case AccessorTag::Index: {
+            std::uint64_t index;
+            TRY(readUint(&index));
+            acc = new SubscriptAccessor(std::uintmax_t(index), nullptr);
+            break;
+        }
+        case AccessorTag::Range: {
+            std::uint8_t flags;
+            TRY(readUint8(&flags));
+            Range range;
+            std::uint64_t bound;
+            if (flags & 1) {
+                TRY(readUint(&bound));
+                range.lowerBound.emplace(bound);
+            }
+            if (flags & 2) {
+                TRY(readUint(&bound));
+                range.upperBound.emplace(bound);
+            }
+            acc = new SubscriptAccessor(range, nullptr);
+            break;
+        }
+        }
+        re->addAccessor(acc.get());
+    }
+    *dest = std::move(re);
+    return true;
+}
+
+bool AstDeserializer::readComponent()
+{
+    std::uint64_t number;
+    TRY(readUint(&number));
+    Rc<Component> comp = new Component(number, _moduleInfo.get());
+
+    TRY(readFields([&comp](Field* field) {
+        comp->addVar(field);
+    }));
+
+    std::uint64_t size;
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView name;
+        Rc<DocBlock> docs;
+        Rc<FunctionType> type;
+        TRY(readFunctionParts(&name, &docs, &type));
+        Rc<Command> cmd = new Command(name, type.get());
+        cmd->setDocs(docs.get());
+        std::uint64_t cmdNumber;
+        TRY(readUint(&cmdNumber));
+        cmd->setNumber(cmdNumber);
+        std::uint64_t numArgs;
+        TRY(readUint(&numArgs));
+        if (numArgs != cmd->argumentsRange().size()) {
+            return setError("invalid command argument number");
+        }
+        for (CmdArgument& arg : cmd->argumentsRange()) {
+            CmdArgPassKind kind;
+            TRY(readEnum(&kind, CmdArgPassKind::AllocPtr));
+            arg.setArgPassKind(kind);
+        }
+        comp->addCommand(cmd.get());
+    }
+
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView name;
+        std::uint64_t msgNumber;
+        std::uint64_t priority;
+        bool isEnabled;
+        TRY(readString(&name));
+        TRY(readUint(&msgNumber));
+        TRY(readUint(&priority));
+        TRY(readBool(&isEnabled));
+        Rc<StatusMsg> msg = new StatusMsg(name, msgNumber, priority, isEnabled);
+        std::uint64_t numParts;
+        TRY(readUint(&numParts));
+        for (std::uint64_t j = 0; j < numParts; j++) {
+            Rc<VarRegexp> part;
+            TRY(readVarRegexp(&part));
+            msg->addPart(part.get());
+        }
+        if (!comp->addStatus(msg.get())) {
+            return setError("duplicate status");
+        }
+    }
+
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView name;
+        std::uint64_t msgNumber;
+        bool isEnabled;
+        TRY(readString(&name));
+        TRY(readUint(&msgNumber));
+        TRY(readBool(&isEnabled));
+        Rc<EventMsg> msg = new EventMsg(name, msgNumber, isEnabled);
+        TRY(readFields([&msg](Field* field) {
+            msg->addField(field);
+        }));
+        if (!comp->addEvent(msg.get())) {
+            return setError("duplicate event");
+        }
+    }
+
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView name;
+        std::uint64_t paramNumber;
+        bool flag;
+        Rc<Parameter> param = new Parameter;
+        TRY(readString(&name));
+        param->setName(name);
+        TRY(readUint(&paramNumber));
+        param->setNumber(paramNumber);
+        TRY(readBool(&flag));
+        param->setReadOnly(flag);
+        TRY(readBool(&flag));
+        param->setHasAutoSave(flag);
+        TRY(readBool(&flag));
+        if (flag) {
+            param->setHasCallback(flag);
+        }
+        std::uint64_t numParts;
+        TRY(readUint(&numParts));
+        for (std::uint64_t j = 0; j < numParts; j++) {
+            bmcl::StringView value;
+            TRY(readString(&value));
+            Rc<FieldAccessor> acc = new FieldAccessor(value, nullptr);
+            param->addPathPart(acc.get());
+        }
+        if (!comp->addParam(param.get())) {
+            return setError("duplicate parameter");
+        }
+    }
+
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        Rc<VarRegexp> re;
+        TRY(readVarRegexp(&re));
+        comp->addSavedVar(re.get());
+    }
+
+    bool hasImplBlock;
+    TRY(readBool(&hasImplBlock));
+    if (hasImplBlock) {
+        Rc<ImplBlock> block = new ImplBlock;
+        TRY(readFunctions(block.get()));
+        comp->setImplBlock(block.get());
+    }
+
+    _ast->setComponent(comp.get());
+    return true;
+}
+
+bool AstDeserializer::readAst()
+{
+    _ast = new Ast(_builtinTypes);
+
+    bmcl::StringView moduleName;
+    Rc<DocBlock> moduleDocs;
+    Location start;
+    Location end;
+    TRY(readString(&moduleName));
+    TRY(readDocs(&moduleDocs));
+    TRY(readLocation(&start));
+    TRY(readLocation(&end));
+    _moduleInfo = new ModuleInfo(moduleName, _fileInfo);
+    _moduleInfo->setDocs(moduleDocs.get());
+    _ast->setModuleDecl(new ModuleDecl(_moduleInfo.get(), start, end));
+
+    std::uint64_t size;
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView path;
+        TRY(readString(&path));
+        Rc<ImportDecl> import = new ImportDecl(_moduleInfo.get(), path);
+        std::uint64_t numTypes;
+        TRY(readUint(&numTypes));
+        for (std::uint64_t j = 0; j < numTypes; j++) {
+            Rc<Type> type;
+            TRY(readNonNullTypeRef(&type));
+            if (!type->isImported() || _ast->findTypeWithName(type->asImported()->name()).isSome()) {
+                return setError("invalid imported type");
+            }
+            if (!import->addType(type->asImported())) {
+                return setError("duplicate imported type");
+            }
+        }
+        _ast->addTypeImport(import.get());
+    }
+
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        TypeAddMode mode;
+        Rc<Type> type;
+        TRY(readEnum(&mode, TypeAddMode::GenericInstantiation));
+        TRY(readNonNullTypeRef(&type));
+        switch (mode) {
+        case TypeAddMode::Anonymous:
+            _ast->addType(type.get());
+            break;
+        case TypeAddMode::TopLevel: {
+            if (!isNamedTypeKind(type->typeKind())) {
+                return setError("expected named type");
+            }
+            NamedType* named = static_cast<NamedType*>(type.get());
+            if (_ast->findTypeWithName(named->name()).isSome()) {
+                return setError("duplicate top level type");
+            }
+            _ast->addTopLevelType(named);
+            break;
+        }
+        case TypeAddMode::GenericInstantiation:
+            if (!type->isGenericInstantiation()) {
+                return setError("expected generic instantiation");
+            }
+            _ast->addGenericInstantiation(type->asGenericInstantiation());
+            break;
+        }
+    }
+
+    TRY(readUint(&size));
+    HashSet<bmcl::StringView> constantNames;
+    for (std::uint64_t i = 0; i < size; i++) {
+        bmcl::StringView name;
+        Rc<Type> type;
+        std::uint64_t value;
+        TRY(readString(&name));
+        TRY(readNonNullTypeRef(&type));
+        TRY(readUint(&value));
+        if (!constantNames.insert(name).second) {
+            return setError("duplicate constant");
+        }
+        Rc<Constant> constant = new Constant(name, value, type.get());
+        _ast->addConstant(constant.get());
+    }
+
+    TRY(readUint(&size));
+    for (std::uint64_t i = 0; i < size; i++) {
+        Rc<ImplBlock> block = new ImplBlock;
+        TRY(readString(&block->_name));
+        TRY(readLocation(&block->_start));
+        TRY(readFunctions(block.get()));
+        auto type = _ast->findTypeWithName(block->name());
+        if (type.isNone()) {
+            return setError("impl block for unknown type");
+        }
+        _ast->addImplBlock(type.unwrap(), block.get());
+    }
+
+    bool hasComponent;
+    TRY(readBool(&hasComponent));
+    if (hasComponent) {
+        TRY(readComponent());
+    }
+
+    if (!_src->isEmpty()) {
+        return setError("unexpected trailing data");
+    }
+    return true;
+}
+
+bmcl::Result<Rc<Ast>, std::string> AstDeserializer::deserialize()
+{
+    if (!readAst()) {
+        return _error;
+    }
+    return _ast;
+}
+
+bool serializeAst(const Ast* ast, bmcl::Buffer* dest)
+{
+    AstSerializer serializer(ast, dest);
+    return serializer.serialize();
+}
+
+bmcl::Result<Rc<Ast>, std::string> deserializeAst(bmcl::MemReader* src, const FileInfo* finfo, AllBuiltinTypes* builtinTypes)
+{
+    AstDeserializer deserializer(src, finfo, builtinTypes);
+    return deserializer.deserialize();
+}
+}
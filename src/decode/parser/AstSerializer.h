@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+
+#include <bmcl/Fwd.h>
+
+#include <cstdint>
+#include <string>
+
+namespace decode {
+
+class Ast;
+class AllBuiltinTypes;
+class FileInfo;
+
+// incremented on every change of serialized ast layout or of parser output
+constexpr std::uint32_t astSerializerVersion = 3;
+
+// serializes ast as produced by Parser (before Package::resolveAll)
+// strings are stored as offsets into module file contents, returns false if ast references foreign strings
+bool serializeAst(const Ast* ast, bmcl::Buffer* dest);
+
+// builtin types are shared with other modules of the package, finfo must have the same contents as the serialized module
+bmcl::Result<Rc<Ast>, std::string> deserializeAst(bmcl::MemReader* src, const FileInfo* finfo, AllBuiltinTypes* builtinTypes);
+}
@@ -65,6 +65,109 @@ public:
     }
 };
 
+// hash map that iterates in insertion order, used for declarations that end up in generated sources
+// so that output does not depend on hash function or standard library
+template <typename K, typename V>
+class RcSecondOrderedMap {
+public:
+    using Entry = std::pair<K, Rc<V>>;
+    using Entries = std::vector<Entry>;
+    using Iterator = SmartPtrIteratorAdaptor<PairSecondIteratorAdaptor<typename Entries::iterator>>;
+    using ConstIterator = SmartPtrIteratorAdaptor<PairSecondIteratorAdaptor<typename Entries::const_iterator>>;
+    using Range = IteratorRange<Iterator>;
+    using ConstRange = IteratorRange<ConstIterator>;
+
+    std::pair<typename Entries::iterator, bool> emplace(const K& key, V* value)
+    {
+        auto it = _indices.emplace(key, _entries.size());
+        if (!it.second) {
+            return std::make_pair(_entries.begin() + it.first->second, false);
+        }
+        _entries.emplace_back(key, value);
+        return std::make_pair(_entries.end() - 1, true);
+    }
+
+    typename Entries::iterator find(const K& key)
+    {
+        auto it = _indices.find(key);
+        if (it == _indices.end()) {
+            return _entries.end();
+        }
+        return _entries.begin() + it->second;
+    }
+
+    typename Entries::const_iterator find(const K& key) const
+    {
+        auto it = _indices.find(key);
+        if (it == _indices.end()) {
+            return _entries.end();
+        }
+        return _entries.begin() + it->second;
+    }
+
+    bmcl::OptionPtr<const V> findValueWithKey(const K& key) const
+    {
+        auto it = find(key);
+        if (it == _entries.end()) {
+            return bmcl::None;
+        }
+        return it->second.get();
+    }
+
+    bmcl::OptionPtr<V> findValueWithKey(const K& key)
+    {
+        auto it = find(key);
+        if (it == _entries.end()) {
+            return bmcl::None;
+        }
+        return it->second.get();
+    }
+
+    typename Entries::iterator begin()
+    {
+        return _entries.begin();
+    }
+
+    typename Entries::iterator end()
+    {
+        return _entries.end();
+    }
+
+    typename Entries::const_iterator begin() const
+    {
+        return _entries.begin();
+    }
+
+    typename Entries::const_iterator end() const
+    {
+        return _entries.end();
+    }
+
+    typename Entries::const_iterator cbegin() const
+    {
+        return _entries.cbegin();
+    }
+
+    typename Entries::const_iterator cend() const
+    {
+        return _entries.cend();
+    }
+
+    bool empty() const
+    {
+        return _entries.empty();
+    }
+
+    std::size_t size() const
+    {
+        return _entries.size();
+    }
+
+private:
+    Entries _entries;
+    HashMap<K, std::size_t> _indices;
+};
+
 template <typename K, typename V, typename C = std::less<K>>
 class RcSecondMap : public std::map<K, Rc<V>, C> {
 public:
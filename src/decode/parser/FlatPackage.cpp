@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/parser/FlatPackage.h"
+#include "decode/parser/Package.h"
+#include "decode/core/HashMap.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Function.h"
+#include "decode/ast/WireLayout.h"
+
+#include <cassert>
+
+namespace decode {
+
+template <typename T>
+inline FlatIndex FlatPackage::nextIndex(const std::vector<T>& table)
+{
+    assert(table.size() < invalidFlatIndex);
+    return FlatIndex(table.size());
+}
+
+template <typename T>
+static inline bmcl::ArrayView<T> slice(const std::vector<T>& table, FlatRange range)
+{
+    assert(std::size_t(range.begin) + range.size <= table.size());
+    return bmcl::ArrayView<T>(table.data() + range.begin, range.size);
+}
+
+FlatPackage::FlatPackage(const Package* package)
+    : _package(package)
+{
+    HashMap<const Component*, FlatIndex> compModules;
+    for (const Ast* ast : package->modules()) {
+        if (ast->component().isSome()) {
+            compModules.emplace(ast->component().unwrap(), nextIndex(_modules));
+        }
+        lowerModule(ast);
+    }
+
+    for (const Component* comp : package->components()) {
+        auto it = compModules.find(comp);
+        assert(it != compModules.end());
+        _modules[it->second].component = nextIndex(_components);
+        lowerComponent(comp, it->second);
+    }
+
+    HashMap<const TmMsg*, FlatIndex> msgIndices;
+    for (FlatIndex i = 0; i < _msgs.size(); i++) {
+        msgIndices.emplace(_msgs[i].msg, i);
+    }
+    _statusMsgs.reserve(package->statusMsgs().size());
+    for (const ComponentAndMsg& msg : package->statusMsgs()) {
+        auto it = msgIndices.find(msg.msg.get());
+        assert(it != msgIndices.end());
+        _statusMsgs.push_back(it->second);
+    }
+}
+
+FlatPackage::~FlatPackage()
+{
+}
+
+void FlatPackage::lowerModule(const Ast* ast)
+{
+    FlatIndex moduleIndex = nextIndex(_modules);
+    FlatModule module;
+    module.ast = ast;
+    module.name = ast->moduleName();
+    module.component = invalidFlatIndex;
+
+    module.types.begin = nextIndex(_types);
+    for (const NamedType* type : ast->namedTypesRange()) {
+        switch (type->typeKind()) {
+        case TypeKind::Imported:
+            continue;
+        case TypeKind::Generic:
+            lowerType(type, type->asGeneric()->innerType()->resolveFinalType(), type->name(), moduleIndex);
+            break;
+        default:
+            lowerType(type, type, type->name(), moduleIndex);
+            break;
+        }
+    }
+    module.types.size = nextIndex(_types) - module.types.begin;
+
+    module.instantiations.begin = nextIndex(_types);
+    for (const GenericInstantiationType* type : ast->genericInstantiationsRange()) {
+        lowerType(type, type->instantiatedType()->resolveFinalType(), bmcl::StringView::empty(), moduleIndex);
+    }
+    module.instantiations.size = nextIndex(_types) - module.instantiations.begin;
+
+    _modules.push_back(module);
+}
+
+template <typename R>
+FlatRange FlatPackage::lowerFields(R&& fields)
+{
+    FlatRange range;
+    range.begin = nextIndex(_fields);
+    for (const Field* field : fields) {
+        _fields.push_back(FlatField{field, field->type(), field->name()});
+    }
+    range.size = nextIndex(_fields) - range.begin;
+    return range;
+}
+
+FlatIndex FlatPackage::lowerType(const Type* type, const Type* body, bmcl::StringView name, FlatIndex module)
+{
+    FlatType flat;
+    flat.type = type;
+    flat.body = body;
+    flat.wireLayout = nullptr;
+    flat.name = name;
+    flat.module = module;
+    flat.kind = type->typeKind();
+    flat.bodyKind = body->typeKind();
+    flat.members = FlatRange{0, 0};
+
+    switch (flat.bodyKind) {
+    case TypeKind::Struct: {
+        const StructType* str = body->asStruct();
+        flat.members = lowerFields(str->fieldsRange());
+        flat.wireLayout = str->wireLayout();
+        if (!flat.wireLayout) {
+            // generic bodies are not laid out during package resolving
+            Rc<const WireLayout> layout = WireLayout::fromRange(str->fieldsRange());
+            flat.wireLayout = layout.get();
+            _layouts.push_back(std::move(layout));
+        }
+        break;
+    }
+    case TypeKind::Variant: {
+        std::vector<FlatAlternative> alternatives;
+        for (const VariantField* field : body->asVariant()->fieldsRange()) {
+            FlatAlternative alt;
+            alt.field = field;
+            alt.name = field->name();
+            alt.kind = field->variantFieldKind();
+            alt.fields = FlatRange{nextIndex(_fields), 0};
+            switch (alt.kind) {
+            case VariantFieldKind::Constant:
+                break;
+            case VariantFieldKind::Tuple:
+                for (const Type* t : field->asTupleField()->typesRange()) {
+                    _fields.push_back(FlatField{nullptr, t, bmcl::StringView::empty()});
+                }
+                alt.fields.size = nextIndex(_fields) - alt.fields.begin;
+                break;
+            case VariantFieldKind::Struct:
+                alt.fields = lowerFields(field->asStructField()->fieldsRange());
+                break;
+            }
+            alternatives.push_back(alt);
+        }
+        flat.members.begin = nextIndex(_alternatives);
+        _alternatives.insert(_alternatives.end(), alternatives.begin(), alternatives.end());
+        flat.members.size = nextIndex(_alternatives) - flat.members.begin;
+        break;
+    }
+    case TypeKind::Enum: {
+        flat.members.begin = nextIndex(_constants);
+        for (const EnumConstant* c : body->asEnum()->constantsRange()) {
+            _constants.push_back(FlatConstant{c, c->name(), c->value()});
+        }
+        flat.members.size = nextIndex(_constants) - flat.members.begin;
+        break;
+    }
+    default:
+        break;
+    }
+
+    FlatIndex index = nextIndex(_types);
+    _types.push_back(flat);
+    return index;
+}
+
+void FlatPackage::lowerComponent(const Component* comp, FlatIndex module)
+{
+    FlatIndex compIndex = nextIndex(_components);
+    FlatComponent flat;
+    flat.comp = comp;
+    flat.name = comp->name();
+    flat.moduleName = comp->moduleName();
+    flat.number = comp->number();
+    flat.module = module;
+
+    flat.statuses.begin = nextIndex(_msgs);
+    for (const StatusMsg* msg : comp->statusesRange()) {
+        FlatRange parts{nextIndex(_regexps), 0};
+        for (const VarRegexp* part : msg->partsRange()) {
+            _regexps.push_back(part);
+        }
+        parts.size = nextIndex(_regexps) - parts.begin;
+        _msgs.push_back(FlatMsg{msg, msg->name(), msg->number(), compIndex, FlatMsgKind::Status, parts});
+    }
+    flat.statuses.size = nextIndex(_msgs) - flat.statuses.begin;
+
+    flat.events.begin = nextIndex(_msgs);
+    for (const EventMsg* msg : comp->eventsRange()) {
+        FlatRange parts = lowerFields(msg->partsRange());
+        _msgs.push_back(FlatMsg{msg, msg->name(), msg->number(), compIndex, FlatMsgKind::Event, parts});
+    }
+    flat.events.size = nextIndex(_msgs) - flat.events.begin;
+
+    flat.commands.begin = nextIndex(_commands);
+    for (const Command* cmd : comp->cmdsRange()) {
+        FlatRange args{nextIndex(_fields), 0};
+        for (const CmdArgument& arg : cmd->argumentsRange()) {
+            _fields.push_back(FlatField{arg.field(), arg.type(), arg.name()});
+        }
+        args.size = nextIndex(_fields) - args.begin;
+        _commands.push_back(FlatCommand{cmd, cmd->name(), cmd->number(), compIndex, args});
+    }
+    flat.commands.size = nextIndex(_commands) - flat.commands.begin;
+
+    flat.savedVars.begin = nextIndex(_regexps);
+    for (const VarRegexp* var : comp->savedVarsRange()) {
+        _regexps.push_back(var);
+    }
+    flat.savedVars.size = nextIndex(_regexps) - flat.savedVars.begin;
+
+    _components.push_back(flat);
+}
+
+const Package* FlatPackage::package() const
+{
+    return _package.get();
+}
+
+bmcl::ArrayView<FlatModule> FlatPackage::modules() const
+{
+    return _modules;
+}
+
+bmcl::ArrayView<FlatType> FlatPackage::types() const
+{
+    return _types;
+}
+
+bmcl::ArrayView<FlatComponent> FlatPackage::components() const
+{
+    return _components;
+}
+
+bmcl::ArrayView<FlatMsg> FlatPackage::msgs() const
+{
+    return _msgs;
+}
+
+bmcl::ArrayView<FlatCommand> FlatPackage::commands() const
+{
+    return _commands;
+}
+
+bmcl::ArrayView<FlatIndex> FlatPackage::statusMsgs() const
+{
+    return _statusMsgs;
+}
+
+bmcl::ArrayView<FlatType> FlatPackage::types(FlatRange range) const
+{
+    return slice(_types, range);
+}
+
+bmcl::ArrayView<FlatField> FlatPackage::fields(FlatRange range) const
+{
+    return slice(_fields, range);
+}
+
+bmcl::ArrayView<FlatAlternative> FlatPackage::alternatives(FlatRange range) const
+{
+    return slice(_alternatives, range);
+}
+
+bmcl::ArrayView<FlatConstant> FlatPackage::constants(FlatRange range) const
+{
+    return slice(_constants, range);
+}
+
+bmcl::ArrayView<FlatMsg> FlatPackage::msgs(FlatRange range) const
+{
+    return slice(_msgs, range);
+}
+
+bmcl::ArrayView<FlatCommand> FlatPackage::commands(FlatRange range) const
+{
+    return slice(_commands, range);
+}
+
+bmcl::ArrayView<const VarRegexp*> FlatPackage::regexps(FlatRange range) const
+{
+    return slice(_regexps, range);
+}
+
+const FlatModule& FlatPackage::moduleAt(FlatIndex index) const
+{
+    return _modules[index];
+}
+
+const FlatType& FlatPackage::typeAt(FlatIndex index) const
+{
+    return _types[index];
+}
+
+const FlatComponent& FlatPackage::componentAt(FlatIndex index) const
+{
+    return _components[index];
+}
+
+const FlatMsg& FlatPackage::msgAt(FlatIndex index) const
+{
+    return _msgs[index];
+}
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/ast/Type.h"
+#include "decode/ast/Field.h"
+#include "decode/parser/Containers.h"
+
+#include <bmcl/ArrayView.h>
+#include <bmcl/StringView.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace decode {
+
+class Package;
+class Ast;
+class Component;
+class TmMsg;
+class Command;
+class VarRegexp;
+class WireLayout;
+
+using FlatIndex = std::uint32_t;
+
+constexpr FlatIndex invalidFlatIndex = std::numeric_limits<FlatIndex>::max();
+
+// contiguous slice of one of the package tables
+struct FlatRange {
+    FlatIndex begin;
+    FlatIndex size;
+};
+
+struct FlatModule {
+    const Ast* ast;
+    bmcl::StringView name;
+    // named types in declaration order, imported types are skipped
+    FlatRange types;
+    FlatRange instantiations;
+    // invalidFlatIndex if module has no component
+    FlatIndex component;
+};
+
+struct FlatType {
+    // named type or generic instantiation the entry was lowered from
+    const Type* type;
+    // type that defines members: the type itself, resolved inner type of generic or instantiated type
+    const Type* body;
+    // null unless body is a struct
+    const WireLayout* wireLayout;
+    // empty for generic instantiations
+    bmcl::StringView name;
+    FlatIndex module;
+    TypeKind kind;
+    TypeKind bodyKind;
+    // fields, alternatives or constants depending on body kind
+    FlatRange members;
+};
+
+struct FlatField {
+    // null for tuple variant elements
+    const Field* field;
+    const Type* type;
+    bmcl::StringView name;
+};
+
+struct FlatAlternative {
+    const VariantField* field;
+    bmcl::StringView name;
+    VariantFieldKind kind;
+    // struct fields or tuple elements
+    FlatRange fields;
+};
+
+struct FlatConstant {
+    const EnumConstant* constant;
+    bmcl::StringView name;
+    std::int64_t value;
+};
+
+enum class FlatMsgKind {
+    Status,
+    Event,
+};
+
+struct FlatMsg {
+    const TmMsg* msg;
+    bmcl::StringView name;
+    std::size_t number;
+    FlatIndex component;
+    FlatMsgKind kind;
+    // regexps for statuses, fields for events
+    FlatRange parts;
+};
+
+struct FlatCommand {
+    const Command* cmd;
+    bmcl::StringView name;
+    std::uintmax_t number;
+    FlatIndex component;
+    FlatRange args;
+};
+
+struct FlatComponent {
+    const Component* comp;
+    bmcl::StringView name;
+    bmcl::StringView moduleName;
+    std::size_t number;
+    FlatIndex module;
+    FlatRange statuses;
+    FlatRange events;
+    FlatRange commands;
+    FlatRange savedVars;
+};
+
+// resolved package frozen into contiguous tables with 32-bit indices
+// tables keep package iteration order so that generated code does not change,
+// nodes are referenced for rendering type expressions and are owned by package
+class FlatPackage : public RefCountable {
+public:
+    using Pointer = Rc<FlatPackage>;
+    using ConstPointer = Rc<const FlatPackage>;
+
+    explicit FlatPackage(const Package* package);
+    ~FlatPackage();
+
+    const Package* package() const;
+
+    bmcl::ArrayView<FlatModule> modules() const;
+    bmcl::ArrayView<FlatType> types() const;
+    bmcl::ArrayView<FlatComponent> components() const;
+    bmcl::ArrayView<FlatMsg> msgs() const;
+    bmcl::ArrayView<FlatCommand> commands() const;
+    // status messages in package order
+    bmcl::ArrayView<FlatIndex> statusMsgs() const;
+
+    bmcl::ArrayView<FlatType> types(FlatRange range) const;
+    bmcl::ArrayView<FlatField> fields(FlatRange range) const;
+    bmcl::ArrayView<FlatAlternative> alternatives(FlatRange range) const;
+    bmcl::ArrayView<FlatConstant> constants(FlatRange range) const;
+    bmcl::ArrayView<FlatMsg> msgs(FlatRange range) const;
+    bmcl::ArrayView<FlatCommand> commands(FlatRange range) const;
+    bmcl::ArrayView<const VarRegexp*> regexps(FlatRange range) const;
+
+    const FlatModule& moduleAt(FlatIndex index) const;
+    const FlatType& typeAt(FlatIndex index) const;
+    const FlatComponent& componentAt(FlatIndex index) const;
+    const FlatMsg& msgAt(FlatIndex index) const;
+
+private:
+    void lowerModule(const Ast* ast);
+    FlatIndex lowerType(const Type* type, const Type* body, bmcl::StringView name, FlatIndex module);
+    template <typename R>
+    FlatRange lowerFields(R&& fields);
+    void lowerComponent(const Component* comp, FlatIndex module);
+
+    template <typename T>
+    static FlatIndex nextIndex(const std::vector<T>& table);
+
+    Rc<const Package> _package;
+    std::vector<FlatModule> _modules;
+    std::vector<FlatType> _types;
+    std::vector<FlatField> _fields;
+    std::vector<FlatAlternative> _alternatives;
+    std::vector<FlatConstant> _constants;
+    std::vector<FlatComponent> _components;
+    std::vector<FlatMsg> _msgs;
+    std::vector<FlatCommand> _commands;
+    std::vector<const VarRegexp*> _regexps;
+    std::vector<FlatIndex> _statusMsgs;
+    // layouts of generic struct bodies, other layouts are owned by ast
+    std::vector<Rc<const WireLayout>> _layouts;
+};
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/parser/FlatPackage.h"
+
+namespace decode {
+
+// traverses flat package tables in order
+// any subrange of a table can be traversed on its own, so work can be split between threads
+template <typename B>
+class FlatPackageVisitor {
+public:
+    explicit FlatPackageVisitor(const FlatPackage* package);
+
+    void traversePackage();
+    void traverseModule(const FlatModule& module);
+    void traverseTypes(FlatRange range);
+    void traverseType(const FlatType& type);
+    void traverseComponents(FlatRange range);
+    void traverseComponent(const FlatComponent& comp);
+
+    const FlatPackage* package() const;
+
+    B& base();
+
+protected:
+    bool visitModule(const FlatModule& module);
+    bool visitEnumType(const FlatType& type, bmcl::ArrayView<FlatConstant> constants);
+    bool visitStructType(const FlatType& type, bmcl::ArrayView<FlatField> fields);
+    bool visitVariantType(const FlatType& type, bmcl::ArrayView<FlatAlternative> alternatives);
+    bool visitAliasType(const FlatType& type);
+    bool visitGenericInstantiationType(const FlatType& type);
+    bool visitComponent(const FlatComponent& comp);
+    bool visitStatusMsg(const FlatMsg& msg, bmcl::ArrayView<const VarRegexp*> parts);
+    bool visitEventMsg(const FlatMsg& msg, bmcl::ArrayView<FlatField> parts);
+    bool visitCommand(const FlatCommand& cmd, bmcl::ArrayView<FlatField> args);
+
+    const FlatPackage* _package;
+};
+
+template <typename B>
+inline FlatPackageVisitor<B>::FlatPackageVisitor(const FlatPackage* package)
+    : _package(package)
+{
+}
+
+template <typename B>
+inline B& FlatPackageVisitor<B>::base()
+{
+    return *static_cast<B*>(this);
+}
+
+template <typename B>
+inline const FlatPackage* FlatPackageVisitor<B>::package() const
+{
+    return _package;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitModule(const FlatModule& module)
+{
+    (void)module;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitEnumType(const FlatType& type, bmcl::ArrayView<FlatConstant> constants)
+{
+    (void)type;
+    (void)constants;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitStructType(const FlatType& type, bmcl::ArrayView<FlatField> fields)
+{
+    (void)type;
+    (void)fields;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitVariantType(const FlatType& type, bmcl::ArrayView<FlatAlternative> alternatives)
+{
+    (void)type;
+    (void)alternatives;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitAliasType(const FlatType& type)
+{
+    (void)type;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitGenericInstantiationType(const FlatType& type)
+{
+    (void)type;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitComponent(const FlatComponent& comp)
+{
+    (void)comp;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitStatusMsg(const FlatMsg& msg, bmcl::ArrayView<const VarRegexp*> parts)
+{
+    (void)msg;
+    (void)parts;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitEventMsg(const FlatMsg& msg, bmcl::ArrayView<FlatField> parts)
+{
+    (void)msg;
+    (void)parts;
+    return true;
+}
+
+template <typename B>
+inline bool FlatPackageVisitor<B>::visitCommand(const FlatCommand& cmd, bmcl::ArrayView<FlatField> args)
+{
+    (void)cmd;
+    (void)args;
+    return true;
+}
+
+template <typename B>
+void FlatPackageVisitor<B>::traversePackage()
+{
+    for (const FlatModule& module : _package->modules()) {
+        base().traverseModule(module);
+    }
+}
+
+template <typename B>
+void FlatPackageVisitor<B>::traverseModule(const FlatModule& module)
+{
+    if (!base().visitModule(module)) {
+        return;
+    }
+    base().traverseTypes(module.types);
+    base().traverseTypes(module.instantiations);
+    if (module.component != invalidFlatIndex) {
+        base().traverseComponent(_package->componentAt(module.component));
+    }
+}
+
+template <typename B>
+void FlatPackageVisitor<B>::traverseTypes(FlatRange range)
+{
+    for (const FlatType& type : _package->types(range)) {
+        base().traverseType(type);
+    }
+}
+
+// types are dispatched by body kind, so generics are visited as their inner type
+// and instantiations as instantiated type unless visitGenericInstantiationType returns false
+template <typename B>
+void FlatPackageVisitor<B>::traverseType(const FlatType& type)
+{
+    if (type.kind == TypeKind::GenericInstantiation && !base().visitGenericInstantiationType(type)) {
+        return;
+    }
+    switch (type.bodyKind) {
+    case TypeKind::Enum:
+        base().visitEnumType(type, _package->constants(type.members));
+        break;
+    case TypeKind::Struct:
+        base().visitStructType(type, _package->fields(type.members));
+        break;
+    case TypeKind::Variant:
+        base().visitVariantType(type, _package->alternatives(type.members));
+        break;
+    case TypeKind::Alias:
+        base().visitAliasType(type);
+        break;
+    default:
+        break;
+    }
+}
+
+template <typename B>
+void FlatPackageVisitor<B>::traverseComponents(FlatRange range)
+{
+    for (FlatIndex i = range.begin; i < range.begin + range.size; i++) {
+        base().traverseComponent(_package->componentAt(i));
+    }
+}
+
+template <typename B>
+void FlatPackageVisitor<B>::traverseComponent(const FlatComponent& comp)
+{
+    if (!base().visitComponent(comp)) {
+        return;
+    }
+    for (const FlatMsg& msg : _package->msgs(comp.statuses)) {
+        base().visitStatusMsg(msg, _package->regexps(msg.parts));
+    }
+    for (const FlatMsg& msg : _package->msgs(comp.events)) {
+        base().visitEventMsg(msg, _package->fields(msg.parts));
+    }
+    for (const FlatCommand& cmd : _package->commands(comp.commands)) {
+        base().visitCommand(cmd, _package->fields(cmd.args));
+    }
+}
+}
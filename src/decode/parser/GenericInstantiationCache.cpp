@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/parser/GenericInstantiationCache.h"
+#include "decode/ast/Type.h"
+
+#include <bmcl/ArrayView.h>
+#include <bmcl/Result.h>
+
+namespace decode {
+
+static const Type* keyType(const Type* type)
+{
+    if (type->isImported() && type->asImported()->link()) {
+        return type->asImported()->link();
+    }
+    return type;
+}
+
+GenericInstantiationCache::GenericInstantiationCache()
+    : _hits(0)
+    , _misses(0)
+{
+}
+
+GenericInstantiationCache::~GenericInstantiationCache()
+{
+}
+
+bmcl::Result<Rc<NamedType>, std::string> GenericInstantiationCache::instantiate(GenericType* type, bmcl::ArrayView<Rc<Type>> substitutedTypes)
+{
+    Key key;
+    key.first = type;
+    key.second.reserve(substitutedTypes.size());
+    for (const Rc<Type>& t : substitutedTypes) {
+        key.second.push_back(keyType(t.get()));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto it = _instances.find(key);
+        if (it != _instances.end()) {
+            _hits++;
+            return it->second;
+        }
+    }
+
+    // built without lock, if another thread was faster its instance is used
+    auto rv = type->instantiate(substitutedTypes);
+    if (rv.isErr()) {
+        return rv;
+    }
+    _misses++;
+
+    std::lock_guard<std::mutex> lock(_lock);
+    auto it = _instances.emplace(std::move(key), rv.unwrap());
+    return it.first->second;
+}
+
+std::size_t GenericInstantiationCache::hits() const
+{
+    return _hits;
+}
+
+std::size_t GenericInstantiationCache::misses() const
+{
+    return _misses;
+}
+}
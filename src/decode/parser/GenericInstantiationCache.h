@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+
+#include <bmcl/Fwd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace decode {
+
+class Type;
+class NamedType;
+class GenericType;
+
+// package wide cache of generic instantiations, every distinct instantiation is built once
+// substituted types are compared by identity, imported types are replaced by linked types
+// safe to use from multiple threads
+class GenericInstantiationCache {
+public:
+    GenericInstantiationCache();
+    ~GenericInstantiationCache();
+
+    bmcl::Result<Rc<NamedType>, std::string> instantiate(GenericType* type, bmcl::ArrayView<Rc<Type>> substitutedTypes);
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+private:
+    using Key = std::pair<const GenericType*, std::vector<const Type*>>;
+
+    std::mutex _lock;
+    std::map<Key, Rc<NamedType>> _instances;
+    std::atomic<std::size_t> _hits;
+    std::atomic<std::size_t> _misses;
+};
+}
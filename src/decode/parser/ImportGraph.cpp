@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/parser/ImportGraph.h"
+#include "decode/core/HashMap.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/Decl.h"
+
+#include <bmcl/StringView.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace decode {
+
+constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+ImportGraph::ImportGraph(bmcl::ArrayView<Ast*> modules)
+    : _modules(modules.begin(), modules.end())
+    , _imports(modules.size())
+    , _nextIndex(0)
+    , _nextComponent(0)
+{
+    HashMap<bmcl::StringView, std::size_t> modIndexes;
+    for (std::size_t i = 0; i < _modules.size(); i++) {
+        modIndexes.emplace(_modules[i]->moduleName(), i);
+    }
+
+    for (std::size_t i = 0; i < _modules.size(); i++) {
+        for (const ImportDecl* import : _modules[i]->importsRange()) {
+            auto it = modIndexes.find(import->path());
+            if (it != modIndexes.end()) {
+                _imports[i].push_back(it->second);
+            }
+        }
+    }
+
+    findComponents();
+}
+
+ImportGraph::~ImportGraph()
+{
+}
+
+const std::vector<ImportGraph::Modules>& ImportGraph::cycles() const
+{
+    return _cycles;
+}
+
+const std::vector<ImportGraph::Modules>& ImportGraph::waves() const
+{
+    return _waves;
+}
+
+void ImportGraph::findComponents()
+{
+    std::size_t size = _modules.size();
+    _index.assign(size, npos);
+    _lowLink.assign(size, npos);
+    _component.assign(size, npos);
+    _level.assign(size, 0);
+
+    // iterative tarjan, frame is (module, next import to visit)
+    std::vector<std::pair<std::size_t, std::size_t>> frames;
+    for (std::size_t root = 0; root < size; root++) {
+        if (_index[root] != npos) {
+            continue;
+        }
+        frames.emplace_back(root, 0);
+        _index[root] = _lowLink[root] = _nextIndex++;
+        _stack.push_back(root);
+        while (!frames.empty()) {
+            std::size_t v = frames.back().first;
+            std::size_t& edge = frames.back().second;
+            if (edge < _imports[v].size()) {
+                std::size_t w = _imports[v][edge];
+                edge++;
+                if (_index[w] == npos) {
+                    frames.emplace_back(w, 0);
+                    _index[w] = _lowLink[w] = _nextIndex++;
+                    _stack.push_back(w);
+                } else if (_component[w] == npos) {
+                    // w is on stack
+                    _lowLink[v] = std::min(_lowLink[v], _index[w]);
+                }
+                continue;
+            }
+            if (_lowLink[v] == _index[v]) {
+                addComponent(v);
+            }
+            frames.pop_back();
+            if (!frames.empty()) {
+                std::size_t parent = frames.back().first;
+                _lowLink[parent] = std::min(_lowLink[parent], _lowLink[v]);
+            }
+        }
+    }
+
+    std::size_t wavesNum = 0;
+    for (std::size_t level : _level) {
+        wavesNum = std::max(wavesNum, level + 1);
+    }
+    _waves.resize(wavesNum);
+    for (std::size_t i = 0; i < size; i++) {
+        _waves[_level[i]].push_back(_modules[i]);
+    }
+}
+
+void ImportGraph::addComponent(std::size_t root)
+{
+    // components are completed in reverse topological order, so all imports outside of this one already have levels
+    auto begin = std::find(_stack.begin(), _stack.end(), root);
+    std::size_t id = _nextComponent++;
+    for (auto it = begin; it < _stack.end(); it++) {
+        _component[*it] = id;
+    }
+
+    std::size_t level = 0;
+    bool isCycle = (_stack.end() - begin) > 1;
+    for (auto it = begin; it < _stack.end(); it++) {
+        for (std::size_t w : _imports[*it]) {
+            if (_component[w] == id) {
+                isCycle |= w == *it;
+            } else {
+                level = std::max(level, _level[w] + 1);
+            }
+        }
+    }
+
+    Modules cycle;
+    for (auto it = begin; it < _stack.end(); it++) {
+        _level[*it] = level;
+        if (isCycle) {
+            cycle.push_back(_modules[*it]);
+        }
+    }
+    if (isCycle) {
+        _cycles.push_back(std::move(cycle));
+    }
+    _stack.erase(begin, _stack.end());
+}
+}
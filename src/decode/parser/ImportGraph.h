@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <bmcl/ArrayView.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace decode {
+
+class Ast;
+
+// directed graph of module imports, imports of unknown modules are ignored
+class ImportGraph {
+public:
+    using Modules = std::vector<Ast*>;
+
+    explicit ImportGraph(bmcl::ArrayView<Ast*> modules);
+    ~ImportGraph();
+
+    // strongly connected components with more than one module or with a module importing itself
+    const std::vector<Modules>& cycles() const;
+
+    // modules grouped by import depth, modules of a wave only import modules of previous waves
+    // modules keep their relative order from constructor argument
+    const std::vector<Modules>& waves() const;
+
+private:
+    void findComponents();
+    void addComponent(std::size_t root);
+
+    Modules _modules;
+    std::vector<std::vector<std::size_t>> _imports;
+    std::vector<Modules> _cycles;
+    std::vector<Modules> _waves;
+
+    // tarjan scc state
+    std::vector<std::size_t> _index;
+    std::vector<std::size_t> _lowLink;
+    std::vector<std::size_t> _component;
+    std::vector<std::size_t> _level;
+    std::vector<std::size_t> _stack;
+    std::size_t _nextIndex;
+    std::size_t _nextComponent;
+};
+}
@@ -8,7 +8,9 @@
 
 #include "decode/parser/Lexer.h"
 #include "decode/parser/Token.h"
+#include "decode/core/SymbolTable.h"
 
+#include <bmcl/Assert.h>
 #include <bmcl/Logging.h>
 
 #include <tao/pegtl/memory_input.hpp>
@@ -17,6 +19,18 @@
 #include <tao/pegtl/ascii.hpp>
 #include <tao/pegtl/utf8.hpp>
 
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define DECODE_SCANNER_SSE2
+# include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
 using namespace tao; //temp
 
 namespace decode {
@@ -216,9 +230,9 @@ struct Action
 template <> \
 struct Action<grammar::name> {\
     template<typename Input>\
-    static void apply(const Input& in, std::vector<Token>* tokens)\
+    static void apply(const Input& in, TokenBuffer* tokens)\
     {\
-        tokens->emplace_back(TokenKind::name, in.begin(), in.end(), in.position().line, in.position().byte_in_line + 1);\
+        tokens->push(TokenKind::name, in.begin(), in.end());\
     }\
 };
 
@@ -273,57 +287,466 @@ RULE_TO_TOKEN(True);
 RULE_TO_TOKEN(False);
 RULE_TO_TOKEN(Eof);
 
-Lexer::Lexer()
+namespace scanner {
+
+enum CharFlags : std::uint8_t {
+    BlankFlag = 1,
+    AlphaFlag = 2,
+    AlnumFlag = 4,
+    IdentifierFlag = 8,
+};
+
+struct CharTable {
+    CharTable()
+    {
+        std::memset(flags, 0, sizeof(flags));
+        flags[std::uint8_t(' ')] = BlankFlag;
+        flags[std::uint8_t('\t')] = BlankFlag;
+        for (int c = '0'; c <= '9'; c++) {
+            flags[c] = AlnumFlag | IdentifierFlag;
+        }
+        for (int c = 'a'; c <= 'z'; c++) {
+            flags[c] = AlphaFlag | AlnumFlag | IdentifierFlag;
+            flags[c - 'a' + 'A'] = AlphaFlag | AlnumFlag | IdentifierFlag;
+        }
+        flags[std::uint8_t('_')] = IdentifierFlag;
+    }
+
+    bool is(char c, CharFlags flag) const
+    {
+        return flags[std::uint8_t(c)] & flag;
+    }
+
+    std::uint8_t flags[256];
+};
+
+static const CharTable charTable;
+
+#ifdef DECODE_SCANNER_SSE2
+
+static inline unsigned countTrailingZeros(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static inline __m128i inRange(__m128i block, char from, char to)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(from - 1)),
+                         _mm_cmplt_epi8(block, _mm_set1_epi8(to + 1)));
+}
+
+#endif
+
+// returns pointer to the first char that is not ' ' or '\t'
+static inline const char* skipBlankRun(const char* current, const char* end)
+{
+#ifdef DECODE_SCANNER_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    while (end - current >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)current);
+        __m128i isBlank = _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab));
+        unsigned mask = ~unsigned(_mm_movemask_epi8(isBlank)) & 0xffff;
+        if (mask) {
+            return current + countTrailingZeros(mask);
+        }
+        current += 16;
+    }
+#endif
+    while (current < end && charTable.is(*current, BlankFlag)) {
+        current++;
+    }
+    return current;
+}
+
+// returns pointer to the first char that is not [A-Za-z0-9_]
+static inline const char* skipIdentifierRun(const char* current, const char* end)
+{
+#ifdef DECODE_SCANNER_SSE2
+    const __m128i underscore = _mm_set1_epi8('_');
+    const __m128i lowerCaseBit = _mm_set1_epi8(0x20);
+    while (end - current >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)current);
+        __m128i isAlpha = inRange(_mm_or_si128(block, lowerCaseBit), 'a', 'z');
+        __m128i isDigit = inRange(block, '0', '9');
+        __m128i isIdent = _mm_or_si128(_mm_or_si128(isAlpha, isDigit), _mm_cmpeq_epi8(block, underscore));
+        unsigned mask = ~unsigned(_mm_movemask_epi8(isIdent)) & 0xffff;
+        if (mask) {
+            return current + countTrailingZeros(mask);
+        }
+        current += 16;
+    }
+#endif
+    while (current < end && charTable.is(*current, IdentifierFlag)) {
+        current++;
+    }
+    return current;
+}
+
+// returns pointer past the end of line that terminates the comment
+static inline const char* skipCommentRun(const char* current, const char* end)
+{
+    const void* eol = std::memchr(current, '\n', end - current);
+    if (!eol) {
+        return end;
+    }
+    return (const char*)eol + 1;
+}
+
+struct Keyword {
+    const char* name;
+    std::size_t size;
+    TokenKind kind;
+};
+
+// perfect hash: (size + 5 * first + second) % 64 is unique for every keyword
+static inline std::size_t keywordHash(const char* str, std::size_t size)
+{
+    return (size + 5 * std::size_t(std::uint8_t(str[0])) + std::size_t(std::uint8_t(str[1]))) & 63;
+}
+
+struct KeywordTable {
+    KeywordTable()
+    {
+        std::memset(keywords, 0, sizeof(keywords));
+        add("module",     TokenKind::Module);
+        add("import",     TokenKind::Import);
+        add("struct",     TokenKind::Struct);
+        add("enum",       TokenKind::Enum);
+        add("variant",    TokenKind::Variant);
+        add("type",       TokenKind::Type);
+        add("component",  TokenKind::Component);
+        add("variables",  TokenKind::Variables);
+        add("statuses",   TokenKind::Statuses);
+        add("events",     TokenKind::Events);
+        add("commands",   TokenKind::Commands);
+        add("parameters", TokenKind::Parameters);
+        add("autosave",   TokenKind::Autosave);
+        add("mut",        TokenKind::Mut);
+        add("const",      TokenKind::Const);
+        add("impl",       TokenKind::Impl);
+        add("fn",         TokenKind::Fn);
+        add("Fn",         TokenKind::UpperFn);
+        add("self",       TokenKind::Self);
+        add("true",       TokenKind::True);
+        add("false",      TokenKind::False);
+    }
+
+    void add(const char* name, TokenKind kind)
+    {
+        std::size_t size = std::strlen(name);
+        Keyword& kw = keywords[keywordHash(name, size)];
+        assert(kw.name == nullptr);
+        kw.name = name;
+        kw.size = size;
+        kw.kind = kind;
+    }
+
+    bool find(const char* str, std::size_t size, TokenKind* kind) const
+    {
+        if (size < 2 || size > 10) {
+            return false;
+        }
+        const Keyword& kw = keywords[keywordHash(str, size)];
+        if (kw.size != size || std::memcmp(kw.name, str, size) != 0) {
+            return false;
+        }
+        *kind = kw.kind;
+        return true;
+    }
+
+    Keyword keywords[64];
+};
+
+static const KeywordTable keywordTable;
+}
+
+// number of tokens produced by the scanner at a time, consumed tokens are discarded before scanning the next chunk
+static constexpr std::size_t scannerChunkSize = 256;
+
+Lexer::Lexer(LexerBackend backend)
     : _nextToken(0)
+    , _scanOffset(0)
+    , _isFinished(true)
+    , _backend(backend)
 {
-    _tokens.emplace_back();
+    _tokens.push(TokenKind::Invalid, nullptr, nullptr);
 }
 
-Lexer::Lexer(bmcl::StringView data)
+Lexer::Lexer(bmcl::StringView data, LexerBackend backend)
+    : _backend(backend)
 {
     reset(data);
 }
 
+Lexer::Lexer(bmcl::StringView data, LexerBackend backend, SymbolTable* symbols)
+    : _symbolTable(symbols)
+    , _backend(backend)
+{
+    reset(data);
+}
+
+Lexer::~Lexer()
+{
+}
+
+LexerBackend Lexer::backend() const
+{
+    return _backend;
+}
+
 void Lexer::reset(bmcl::StringView data)
 {
-    _tokens.clear();
+    BMCL_ASSERT(data.size() <= TokenBuffer::maxDataSize);
+    _tokens.reset(data.begin());
+    _localSymbols.clear();
     _data = data;
     _nextToken = 0;
+    _scanOffset = 0;
+    _isFinished = false;
+    switch (_backend) {
+    case LexerBackend::Scanner:
+        scanChunk();
+        break;
+    case LexerBackend::Pegtl:
+        tokenizeWithPegtl();
+        break;
+    }
+    internIdentifiers();
+}
+
+void Lexer::internIdentifiers()
+{
+    if (_symbolTable.isNull()) {
+        return;
+    }
+    for (std::size_t i = 0; i < _tokens.size(); i++) {
+        if (_tokens.kindAt(i) != TokenKind::Identifier) {
+            continue;
+        }
+        bmcl::StringView value = _tokens.tokenAt(i).value();
+        auto it = _localSymbols.find(value);
+        if (it == _localSymbols.end()) {
+            it = _localSymbols.emplace(value, _symbolTable->intern(value)).first;
+        }
+        _tokens.setSymbolAt(i, it->second);
+    }
+}
+
+void Lexer::tokenizeWithPegtl()
+{
     //TODO: catch pegtl exceptions
-    pegtl::memory_input<> input(data.begin(), data.size(), "");
+    pegtl::memory_input<> input(_data.begin(), _data.size(), "");
     try {
         pegtl::parse<grammar::Grammar, Action>(input, &_tokens);
     } catch (const pegtl::parse_error& err) {
         for (const pegtl::position& info : err.positions) {
-            _tokens.emplace_back(TokenKind::Invalid, info.source.data(), info.source.data() + info.source.size(), info.line, info.byte_in_line + 1);
+            const char* pos = _data.begin() + info.byte;
+            _tokens.push(TokenKind::Invalid, pos, pos);
         }
     }
+    _isFinished = true;
 }
 
-void Lexer::peekNextToken(Token* tok)
+// produces exactly the same token stream as grammar::Grammar, scannerChunkSize tokens at a time
+void Lexer::scanChunk()
+{
+    const char* current = _data.begin() + _scanOffset;
+    const char* end = _data.end();
+
+    auto addToken = [&](TokenKind kind, const char* tokenEnd) {
+        _tokens.push(kind, current, tokenEnd);
+        current = tokenEnd;
+    };
+
+    auto addPunctuation = [&](TokenKind single, char next, TokenKind dual) {
+        if ((end - current) > 1 && current[1] == next) {
+            addToken(dual, current + 2);
+        } else {
+            addToken(single, current + 1);
+        }
+    };
+
+    if (_data.isEmpty()) {
+        addToken(TokenKind::Invalid, current);
+        _isFinished = true;
+        return;
+    }
+
+    while (current < end) {
+        if (_tokens.size() >= scannerChunkSize) {
+            _scanOffset = current - _data.begin();
+            return;
+        }
+        char c = *current;
+        switch (c) {
+        case ' ':
+        case '\t':
+            addToken(TokenKind::Blank, scanner::skipBlankRun(current + 1, end));
+            continue;
+        case '\n':
+            addToken(TokenKind::Eol, current + 1);
+            continue;
+        case '\r':
+            if ((end - current) > 1 && current[1] == '\n') {
+                addToken(TokenKind::Eol, current + 2);
+                continue;
+            }
+            goto error;
+        case '/':
+            if ((end - current) > 2 && current[1] == '/' && current[2] == '/') {
+                addToken(TokenKind::DocComment, scanner::skipCommentRun(current + 3, end));
+            } else {
+                addToken(TokenKind::Slash, current + 1);
+            }
+            continue;
+        case ',':
+            addToken(TokenKind::Comma, current + 1);
+            continue;
+        case ':':
+            addPunctuation(TokenKind::Colon, ':', TokenKind::DoubleColon);
+            continue;
+        case ';':
+            addToken(TokenKind::SemiColon, current + 1);
+            continue;
+        case '[':
+            addToken(TokenKind::LBracket, current + 1);
+            continue;
+        case ']':
+            addToken(TokenKind::RBracket, current + 1);
+            continue;
+        case '{':
+            addToken(TokenKind::LBrace, current + 1);
+            continue;
+        case '}':
+            addToken(TokenKind::RBrace, current + 1);
+            continue;
+        case '(':
+            addToken(TokenKind::LParen, current + 1);
+            continue;
+        case ')':
+            addToken(TokenKind::RParen, current + 1);
+            continue;
+        case '<':
+            addToken(TokenKind::LessThen, current + 1);
+            continue;
+        case '>':
+            addToken(TokenKind::MoreThen, current + 1);
+            continue;
+        case '*':
+            addToken(TokenKind::Star, current + 1);
+            continue;
+        case '&':
+            addToken(TokenKind::Ampersand, current + 1);
+            continue;
+        case '#':
+            addToken(TokenKind::Hash, current + 1);
+            continue;
+        case '=':
+            addToken(TokenKind::Equality, current + 1);
+            continue;
+        case '!':
+            addToken(TokenKind::Exclamation, current + 1);
+            continue;
+        case '-':
+            addPunctuation(TokenKind::Dash, '>', TokenKind::RightArrow);
+            continue;
+        case '.':
+            addPunctuation(TokenKind::Dot, '.', TokenKind::DoubleDot);
+            continue;
+        default:
+            break;
+        }
+
+        if (scanner::charTable.is(c, scanner::AlphaFlag)) {
+            // keywords are matched only if not followed by an alphanumeric char, '_' is allowed
+            const char* identEnd = scanner::skipIdentifierRun(current + 1, end);
+            const char* alnumEnd = current + 1;
+            while (alnumEnd < identEnd && scanner::charTable.is(*alnumEnd, scanner::AlnumFlag)) {
+                alnumEnd++;
+            }
+            TokenKind kind;
+            if (scanner::keywordTable.find(current, alnumEnd - current, &kind)) {
+                addToken(kind, alnumEnd);
+            } else {
+                addToken(TokenKind::Identifier, identEnd);
+            }
+            continue;
+        }
+        if (c == '_') {
+            addToken(TokenKind::Identifier, scanner::skipIdentifierRun(current + 1, end));
+            continue;
+        }
+        if (c >= '0' && c <= '9') {
+            const char* numEnd = current + 1;
+            while (numEnd < end && *numEnd >= '0' && *numEnd <= '9') {
+                numEnd++;
+            }
+            addToken(TokenKind::Number, numEnd);
+            continue;
+        }
+
+error:
+        addToken(TokenKind::Invalid, current);
+        _isFinished = true;
+        return;
+    }
+
+    addToken(TokenKind::Eof, current);
+    _isFinished = true;
+}
+
+bool Lexer::ensureNextToken()
 {
     if (_nextToken < _tokens.size()) {
-        *tok = _tokens[_nextToken];
+        return true;
+    }
+    if (_isFinished) {
+        return false;
+    }
+    _tokens.clear();
+    _nextToken = 0;
+    scanChunk();
+    internIdentifiers();
+    return true;
+}
+
+Location Lexer::location(const char* pos) const
+{
+    BMCL_ASSERT(pos >= _data.begin() && pos <= _data.end());
+    return Location(pos - _data.begin());
+}
+
+void Lexer::peekNextToken(Token* tok)
+{
+    if (ensureNextToken()) {
+        *tok = _tokens.tokenAt(_nextToken);
     } else {
-        *tok = _tokens.back(); //eol
+        *tok = _tokens.tokenAt(_tokens.size() - 1); //eol
     }
 }
 
 bool Lexer::nextIs(TokenKind kind)
 {
-    if (_nextToken < _tokens.size()) {
-        return kind == _tokens[_nextToken].kind();
+    if (ensureNextToken()) {
+        return kind == _tokens.kindAt(_nextToken);
     }
     return kind == TokenKind::Eol;
 }
 
 void Lexer::consumeNextToken(Token* tok)
 {
-    if (_nextToken < _tokens.size()) {
-        *tok = _tokens[_nextToken];
+    if (ensureNextToken()) {
+        *tok = _tokens.tokenAt(_nextToken);
         _nextToken++;
     } else {
-        *tok = _tokens.back();
+        *tok = _tokens.tokenAt(_tokens.size() - 1);
     }
 }
 }
@@ -10,30 +10,121 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/LexerBackend.h"
+#include "decode/core/Location.h"
+#include "decode/core/HashMap.h"
+#include "decode/core/Symbol.h"
 #include "decode/parser/Token.h"
 
+#include <bmcl/Assert.h>
 #include <bmcl/StringView.h>
+#include <bmcl/StringViewHash.h>
 
 #include <vector>
+#include <cstdint>
+#include <limits>
 
 namespace decode {
 
+// struct-of-arrays token storage, offsets and sizes are relative to the lexed buffer
+class TokenBuffer {
+public:
+    // token offsets and sizes are stored as 32 bit values
+    static constexpr std::size_t maxDataSize = std::numeric_limits<std::uint32_t>::max();
+
+    TokenBuffer()
+        : _base(nullptr)
+    {
+    }
+
+    void reset(const char* base)
+    {
+        _base = base;
+        clear();
+    }
+
+    void clear()
+    {
+        _kinds.clear();
+        _offsets.clear();
+        _sizes.clear();
+        _symbols.clear();
+    }
+
+    void push(TokenKind kind, const char* begin, const char* end)
+    {
+        BMCL_ASSERT(begin >= _base && end >= begin && std::size_t(end - _base) <= maxDataSize);
+        _kinds.push_back(kind);
+        _offsets.push_back(std::uint32_t(begin - _base));
+        _sizes.push_back(std::uint32_t(end - begin));
+        _symbols.emplace_back();
+    }
+
+    void setSymbolAt(std::size_t i, Symbol symbol)
+    {
+        _symbols[i] = symbol;
+    }
+
+    std::size_t size() const
+    {
+        return _kinds.size();
+    }
+
+    TokenKind kindAt(std::size_t i) const
+    {
+        return _kinds[i];
+    }
+
+    Token tokenAt(std::size_t i) const
+    {
+        return Token(_kinds[i], _base + _offsets[i], _sizes[i], _symbols[i]);
+    }
+
+private:
+    const char* _base;
+    std::vector<TokenKind> _kinds;
+    std::vector<std::uint32_t> _offsets;
+    std::vector<std::uint32_t> _sizes;
+    std::vector<Symbol> _symbols;
+};
+
+class SymbolTable;
+
 class Lexer : public RefCountable {
 public:
-    Lexer();
-    Lexer(bmcl::StringView data);
+    Lexer(LexerBackend backend = LexerBackend::Scanner);
+    Lexer(bmcl::StringView data, LexerBackend backend = LexerBackend::Scanner);
+    // identifiers are interned into symbols at lex time
+    Lexer(bmcl::StringView data, LexerBackend backend, SymbolTable* symbols);
+    ~Lexer();
 
     void reset(bmcl::StringView data);
 
+    LexerBackend backend() const;
+
     void consumeNextToken(Token* dest);
     void peekNextToken(Token* dest);
 
     bool nextIs(TokenKind kind);
 
+    // byte offset of pos in lexed data, line and column are computed only when report is printed
+    Location location(const char* pos) const;
+
 private:
-    std::vector<Token> _tokens;
+    bool ensureNextToken();
+    void tokenizeWithPegtl();
+    void scanChunk();
+    void internIdentifiers();
+
+    TokenBuffer _tokens;
+    Rc<SymbolTable> _symbolTable;
+    // avoids locking symbol table for repeated identifiers
+    HashMap<bmcl::StringView, Symbol> _localSymbols;
     bmcl::StringView _data;
     std::size_t _nextToken;
+    std::size_t _scanOffset;
+    bool _isFinished;
+    LexerBackend _backend;
 };
 
 }
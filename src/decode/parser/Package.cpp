@@ -13,23 +13,40 @@
 #include "decode/core/Try.h"
 #include "decode/core/Utils.h"
 #include "decode/core/FileInfo.h"
+#include "decode/core/Arena.h"
+#include "decode/core/SymbolTable.h"
+#include "decode/core/Parallel.h"
 #include "decode/core/ProgressPrinter.h"
+#include "decode/ast/AllBuiltinTypes.h"
+#include "decode/ast/TypeTable.h"
 #include "decode/ast/Ast.h"
 #include "decode/ast/ModuleInfo.h"
 #include "decode/ast/Component.h"
 #include "decode/ast/Decl.h"
 #include "decode/ast/Type.h"
+#include "decode/ast/WireLayout.h"
+#include "decode/ast/Function.h"
 #include "decode/ast/Field.h"
+#include "decode/parser/GenericInstantiationCache.h"
+#include "decode/parser/ImportGraph.h"
 #include "decode/parser/Parser.h"
+#include "decode/parser/ParseCache.h"
+#include "decode/parser/AstSerializer.h"
+#include "decode/parser/PackageIndex.h"
 
 #include <bmcl/Buffer.h>
 #include <bmcl/Logging.h>
 #include <bmcl/MemReader.h>
+#include <bmcl/Option.h>
 #include <bmcl/Result.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
 #if defined(__linux__)
 # include <dirent.h>
@@ -43,6 +60,9 @@ namespace decode {
 Package::Package(Configuration* cfg, Diagnostics* diag)
     : _diag(diag)
     , _cfg(cfg)
+    , _symbols(new SymbolTable)
+    , _types(new TypeTable)
+    , _isPartial(false)
 {
 }
 
@@ -53,12 +73,12 @@ Package::~Package()
 PackageResult Package::readFromFiles(Configuration* cfg, Diagnostics* diag, bmcl::ArrayView<std::string> files)
 {
     Rc<Package> package = new Package(cfg, diag);
-    Parser p(diag);
+    // types created during resolve are allocated from the same arena
+    Rc<Arena> arena = new Arena;
+    ArenaScope arenaScope(arena.get());
 
-    for (const std::string& path : files) {
-        if (!package->addFile(path.c_str(), &p)) {
-            return PackageResult();
-        }
+    if (!package->addFiles(files)) {
+        return PackageResult();
     }
 
     if (!package->resolveAll()) {
@@ -75,42 +95,191 @@ static void addDecodeError(Diagnostics* diag, bmcl::StringView msg)
 
 PackageResult Package::decodeFromMemory(Configuration* cfg, Diagnostics* diag, const void* src, std::size_t size)
 {
-    bmcl::MemReader reader(src, size);
+    bmcl::SharedBytes storage = bmcl::SharedBytes::create((const std::uint8_t*)src, size);
+    return decode(cfg, diag, storage, bmcl::Bytes(storage.data(), storage.size()), bmcl::None);
+}
+
+PackageResult Package::decodeFromMemory(Configuration* cfg, Diagnostics* diag, const bmcl::SharedBytes& storage, bmcl::Bytes data)
+{
+    return decode(cfg, diag, storage, data, bmcl::None);
+}
+
+PackageResult Package::decodeModulesFromMemory(Configuration* cfg, Diagnostics* diag, const void* src, std::size_t size, bmcl::ArrayView<std::string> modules)
+{
+    bmcl::SharedBytes storage = bmcl::SharedBytes::create((const std::uint8_t*)src, size);
+    return decode(cfg, diag, storage, bmcl::Bytes(storage.data(), storage.size()), modules);
+}
+
+PackageResult Package::decodeModulesFromMemory(Configuration* cfg, Diagnostics* diag, const bmcl::SharedBytes& storage, bmcl::Bytes data, bmcl::ArrayView<std::string> modules)
+{
+    return decode(cfg, diag, storage, data, modules);
+}
 
+PackageResult Package::decode(Configuration* cfg, Diagnostics* diag, const bmcl::SharedBytes& storage, bmcl::Bytes data, bmcl::Option<bmcl::ArrayView<std::string>> modules)
+{
     Rc<Package> package = new Package(cfg, diag);
-    Parser p(diag);
+    Rc<AllBuiltinTypes> builtinTypes = new AllBuiltinTypes;
+    Rc<Arena> arena = new Arena;
+    ArenaScope arenaScope(arena.get());
+
+    if (PackageIndex::isIndexed(data.data(), data.size())) {
+        PackageIndexResult index = PackageIndex::decode(data.data(), data.size());
+        if (index.isErr()) {
+            addDecodeError(diag, index.unwrapErr());
+            return PackageResult();
+        }
 
-    while (!reader.isEmpty()) {
-        auto fname = deserializeString(&reader);
-        if (fname.isErr()) {
-            addDecodeError(diag, fname.unwrapErr());
+        std::vector<std::size_t> entries;
+        if (modules.isSome()) {
+            auto closure = index.unwrap()->importClosure(modules.unwrap());
+            if (closure.isErr()) {
+                addDecodeError(diag, closure.unwrapErr());
+                return PackageResult();
+            }
+            entries = closure.take();
+            package->_isPartial = entries.size() != index.unwrap()->entries().size();
+        } else {
+            for (std::size_t i = 0; i < index.unwrap()->entries().size(); i++) {
+                entries.push_back(i);
+            }
+        }
+
+        if (!package->decodeIndexed(index.unwrap().get(), entries, storage, builtinTypes.get())) {
+            return PackageResult();
+        }
+        // package is encoded the same way it was loaded
+        if (package->_preparsedAsts.empty()) {
+            cfg->setPackageEncoding(PackageEncoding::Indexed);
+        } else {
+            cfg->setPackageEncoding(PackageEncoding::Preparsed);
+            package->_preparsedStorage.push_back(storage);
+        }
+    } else {
+        // imports are only known after parsing, so source packages are always decoded completely
+        bmcl::MemReader reader(data.data(), data.size());
+        if (!package->decodeSources(&reader, storage, builtinTypes.get())) {
             return PackageResult();
         }
+    }
 
-        auto contents = deserializeString(&reader);
+    if (!package->resolveAll()) {
+        return PackageResult();
+    }
+
+    return std::move(package);
+}
+
+bool Package::decodeSources(bmcl::MemReader* reader, const bmcl::SharedBytes& storage, AllBuiltinTypes* builtinTypes)
+{
+    Parser p(_diag.get(), _cfg->lexerBackend(), builtinTypes, _symbols.get(), _types.get());
+    while (!reader->isEmpty()) {
+        auto fname = deserializeString(reader);
+        if (fname.isErr()) {
+            addDecodeError(_diag.get(), fname.unwrapErr());
+            return false;
+        }
+
+        auto contents = deserializeString(reader);
         if (contents.isErr()) {
-            addDecodeError(diag, contents.unwrapErr());
-            return PackageResult();
+            addDecodeError(_diag.get(), contents.unwrapErr());
+            return false;
         }
 
-        Rc<FileInfo> finfo = new FileInfo(fname.unwrap().toStdString(), contents.unwrap().toStdString());
+        Rc<FileInfo> finfo = new FileInfo(fname.unwrap().toStdString(), storage, contents.unwrap());
 
         ParseResult ast = p.parseFile(finfo.get());
         if (ast.isErr()) {
-            return PackageResult();
+            return false;
         }
 
-        package->addAst(ast.unwrap().get());
+        addAst(ast.unwrap().get());
     }
+    return true;
+}
 
-    if (!package->resolveAll()) {
-        return PackageResult();
-    }
+bool Package::decodeIndexed(const PackageIndex* index, bmcl::ArrayView<std::size_t> entries, const bmcl::SharedBytes& storage, AllBuiltinTypes* builtinTypes)
+{
+    // asts serialized by other decode versions are ignored and modules are parsed from sources
+    bool isAstCompatible = index->astVersion() == astSerializerVersion;
+
+    std::unique_ptr<Parser> parser;
+    for (std::size_t i : entries) {
+        const PackageIndexEntry& entry = index->entries()[i];
+        bmcl::Bytes record = index->record(entry);
+        if (PackageIndex::hashRecord(record) != entry.hash) {
+            addDecodeError(_diag.get(), "Record of module " + entry.moduleName.toStdString() + " is corrupted (hash mismatch)");
+            return false;
+        }
+        bmcl::MemReader reader(record.data(), record.size());
 
-    return std::move(package);
+        auto fname = deserializeString(&reader);
+        if (fname.isErr()) {
+            addDecodeError(_diag.get(), fname.unwrapErr());
+            return false;
+        }
+
+        auto contents = deserializeString(&reader);
+        if (contents.isErr()) {
+            addDecodeError(_diag.get(), contents.unwrapErr());
+            return false;
+        }
+
+        std::uint64_t astSize;
+        if (!reader.readVarUint(&astSize) || reader.readableSize() < astSize) {
+            addDecodeError(_diag.get(), "Unexpected EOF reading serialized ast");
+            return false;
+        }
+
+        Rc<FileInfo> finfo = new FileInfo(fname.unwrap().toStdString(), storage, contents.unwrap());
+
+        Rc<Ast> ast;
+        // modules that could not be serialized are stored without ast
+        if (isAstCompatible && astSize != 0) {
+            bmcl::MemReader astReader(reader.current(), astSize);
+            auto rv = deserializeAst(&astReader, finfo.get(), builtinTypes);
+            if (rv.isErr()) {
+                addDecodeError(_diag.get(), "Error reading ast of `" + finfo->fileName() + "`: " + rv.unwrapErr());
+                return false;
+            }
+            ast = rv.unwrap();
+            _preparsedAsts.emplace(ast.get(), bmcl::Bytes(reader.current(), astSize));
+        } else {
+            if (!parser) {
+                parser.reset(new Parser(_diag.get(), _cfg->lexerBackend(), builtinTypes, _symbols.get(), _types.get()));
+            }
+            ParseResult rv = parser->parseFile(finfo.get());
+            if (rv.isErr()) {
+                return false;
+            }
+            ast = rv.unwrap();
+        }
+
+        if (ast->moduleName() != entry.moduleName) {
+            addDecodeError(_diag.get(), "Module `" + ast->moduleName().toStdString() + "` is indexed as `" + entry.moduleName.toStdString() + "`");
+            return false;
+        }
+        addAst(ast.get());
+    }
+    return true;
 }
 
 void Package::encode(bmcl::Buffer* dest) const
+{
+    assert(!_isPartial);
+    switch (_cfg->packageEncoding()) {
+    case PackageEncoding::Sources:
+        encodeSources(dest);
+        return;
+    case PackageEncoding::Indexed:
+        encodeIndexed(dest, false);
+        return;
+    case PackageEncoding::Preparsed:
+        encodeIndexed(dest, true);
+        return;
+    }
+}
+
+void Package::encodeSources(bmcl::Buffer* dest) const
 {
     for (const Ast* it : modules()) {
         const FileInfo* finfo = it->moduleInfo()->fileInfo();
@@ -119,27 +288,145 @@ void Package::encode(bmcl::Buffer* dest) const
     }
 }
 
+void Package::encodeIndexed(bmcl::Buffer* dest, bool withAsts) const
+{
+    Rc<PackageIndex> index = new PackageIndex;
+    bmcl::Buffer records;
+    for (const Ast* it : modules()) {
+        const FileInfo* finfo = it->moduleInfo()->fileInfo();
+        PackageIndexEntry entry;
+        entry.moduleName = it->moduleName();
+        for (const ImportDecl* import : it->importsRange()) {
+            entry.imports.push_back(import->path());
+        }
+
+        entry.offset = records.size();
+        serializeString(finfo->fileName(), &records);
+        serializeString(finfo->contents(), &records);
+        auto ast = _preparsedAsts.find(it);
+        if (!withAsts || ast == _preparsedAsts.end()) {
+            records.writeVarUint(0);
+        } else {
+            records.writeVarUint(ast->second.size());
+            records.write(ast->second.data(), ast->second.size());
+        }
+        entry.size = records.size() - entry.offset;
+        entry.hash = PackageIndex::hashRecord(bmcl::Bytes(records.data() + entry.offset, entry.size));
+        index->addEntry(std::move(entry));
+    }
+    index->encode(astSerializerVersion, dest);
+    dest->write(records.data(), records.size());
+}
+
 void Package::addAst(Ast* ast)
 {
     bmcl::StringView modName = ast->moduleName();
     _modNameToAstMap.emplace(modName, ast);
 }
 
-bool Package::addFile(const char* path, Parser* p)
+bool Package::addFiles(bmcl::ArrayView<std::string> files)
 {
+    Rc<ParseCache> cache;
+    if (_cfg->parseCacheDir().isSome()) {
+        cache = new ParseCache(_cfg->parseCacheDir().unwrap());
+        TRY(cache->init(_diag.get()));
+    }
+
+    // every worker has its own parser and ast arena, reports are collected per file and merged in file order
+    struct FileResult {
+        Rc<Ast> ast;
+        Rc<Diagnostics> diag;
+        bmcl::Buffer preparsed;
+        bool isPreparsed;
+    };
+
+    // builtin types are referenced from all modules
+    std::size_t numJobs = isRcThreadSafe ? std::max<std::size_t>(1, std::min(_cfg->numJobs(), files.size())) : 1;
+    Rc<AllBuiltinTypes> builtinTypes = new AllBuiltinTypes;
+    std::vector<Rc<Diagnostics>> workerDiags;
+    std::vector<Rc<Arena>> arenas;
+    std::vector<std::unique_ptr<Parser>> parsers;
+    for (std::size_t i = 0; i < numJobs; i++) {
+        workerDiags.emplace_back(new Diagnostics);
+        arenas.emplace_back(new Arena);
+        parsers.emplace_back(new Parser(workerDiags.back().get(), _cfg->lexerBackend(), builtinTypes.get(), _symbols.get(), _types.get()));
+    }
+
+    // asts are serialized before resolving as it modifies them
+    bool keepPreparsed = _cfg->packageEncoding() == PackageEncoding::Preparsed;
+
+    // files after the first failed one are not parsed
+    std::atomic<std::size_t> firstFailed(files.size());
+    std::vector<FileResult> results(files.size());
+    parallelFor(numJobs, files.size(), [&](std::size_t i, std::size_t worker) {
+        results[i].diag = new Diagnostics;
+        if (i > firstFailed) {
+            return;
+        }
+        ArenaScope arenaScope(arenas[worker].get());
+        results[i].ast = parseFile(files[i], parsers[worker].get(), workerDiags[worker].get(), builtinTypes.get(), cache.get());
+        results[i].diag->takeReportsFrom(workerDiags[worker].get());
+        results[i].isPreparsed = !results[i].ast.isNull() && keepPreparsed && serializeAst(results[i].ast.get(), &results[i].preparsed);
+        if (results[i].ast.isNull()) {
+            std::size_t current = firstFailed;
+            while (i < current && !firstFailed.compare_exchange_weak(current, i)) {
+            }
+        }
+    });
+
     ProgressPrinter printer(_cfg->verboseOutput());
-    printer.printActionProgress("Parsing", "file `" + std::string(path) + "`");
-    ParseResult ast = p->parseFile(path);
-    if (ast.isErr()) {
-        return false;
+    for (std::size_t i = 0; i < files.size(); i++) {
+        printer.printActionProgress("Parsing", "file `" + files[i] + "`");
+        _diag->takeReportsFrom(results[i].diag.get());
+        if (results[i].ast.isNull()) {
+            return false;
+        }
+        addAst(results[i].ast.get());
+        if (results[i].isPreparsed) {
+            _preparsedStorage.push_back(bmcl::SharedBytes::create(results[i].preparsed.data(), results[i].preparsed.size()));
+            _preparsedAsts.emplace(results[i].ast.get(), bmcl::Bytes(_preparsedStorage.back().data(), _preparsedStorage.back().size()));
+        }
     }
 
-    addAst(ast.unwrap().get());
+    if (!cache.isNull()) {
+        printer.printActionProgress("Cache", std::to_string(cache->hits()) + " hits, " + std::to_string(cache->misses()) + " misses");
+    }
 
     return true;
 }
 
-bool Package::resolveGenerics(Ast* ast)
+Rc<Ast> Package::parseFile(const std::string& path, Parser* p, Diagnostics* parserDiag, AllBuiltinTypes* builtinTypes, ParseCache* cache)
+{
+    if (!cache) {
+        ParseResult ast = p->parseFile(path.c_str());
+        if (ast.isErr()) {
+            return nullptr;
+        }
+        return ast.unwrap();
+    }
+
+    FileInfoResult finfo = FileInfo::fromFile(path.c_str());
+    if (finfo.isErr()) {
+        return nullptr;
+    }
+
+    Rc<Ast> cached = cache->load(finfo.unwrap().get(), builtinTypes);
+    if (!cached.isNull()) {
+        return cached;
+    }
+
+    ParseResult ast = p->parseFile(finfo.unwrap().get());
+    if (ast.isErr()) {
+        return nullptr;
+    }
+    // asts with warnings are not cached so that warnings are reported on every run
+    if (!parserDiag->hasReports()) {
+        cache->store(ast.unwrap().get());
+    }
+    return ast.unwrap();
+}
+
+bool Package::resolveGenerics(Ast* ast, GenericInstantiationCache* cache)
 {
     bool isOk = true;
     for (GenericInstantiationType* type : ast->genericInstantiationsRange()) {
@@ -148,7 +435,7 @@ bool Package::resolveGenerics(Ast* ast)
             t = t->asImported()->link();
         }
         if (t->isGeneric()) {
-            auto rv = t->asGeneric()->instantiate(type->substitutedTypes());
+            auto rv = cache->instantiate(t->asGeneric(), type->substitutedTypes());
             if (rv.isErr()) {
                 BMCL_CRITICAL() << "failed to instantiate type " + type->genericName().toStdString() + ": " + rv.unwrapErr();
                 isOk = false;
@@ -169,7 +456,7 @@ bool Package::resolveImports(Ast* ast)
 {
     bool isOk = true;
     for (ImportDecl* import : ast->importsRange()) {
-        auto searchedAst = _modNameToAstMap.find(import->path().toStdString());
+        auto searchedAst = _modNameToAstMap.find(import->path());
         if (searchedAst == _modNameToAstMap.end()) {
             isOk = false;
             BMCL_CRITICAL() << "invalid import mod in "
@@ -185,19 +472,21 @@ bool Package::resolveImports(Ast* ast)
                 BMCL_CRITICAL() << "invalid import type in "
                                 << ast->moduleName().toStdString() << ": "
                                 << modifiedType->name().toStdString();
-            } else {
-                if (modifiedType->typeKind() == foundType.unwrap()->typeKind()) {
+                continue;
+            }
+            NamedType* type = foundType.unwrap();
+            if (type->isImported()) {
+                // imported module is resolved in one of previous waves
+                type = type->asImported()->link();
+                if (!type) {
                     isOk = false;
-                    //TODO: report error - circular imports
-                    BMCL_CRITICAL() << "circular imports "
-                                    << ast->moduleName().toStdString()
-                                    << ": " << modifiedType->name().toStdString();
-                    BMCL_CRITICAL() << "circular imports "
-                                    << searchedAst->first.toStdString() << ".decode: "
-                                    << foundType.unwrap()->name().toStdString();
+                    BMCL_CRITICAL() << "unresolved reexported type in "
+                                    << ast->moduleName().toStdString() << ": "
+                                    << modifiedType->name().toStdString();
+                    continue;
                 }
-                modifiedType->setLink(foundType.unwrap());
             }
+            modifiedType->setLink(type);
         }
     }
     return isOk;
@@ -360,13 +649,17 @@ bool Package::resolveVarRegexp(Ast* ast, Component* comp, VarRegexp* re)
     if (!lastSubscript.isNull()) {
         if (lastSubscript->type()->isArray()) {
             //TODO: support range
-            contType = new ArrayType(lastSubscript->type()->asArray()->elementCount(), lastField->type());
+            contType = _types->arrayType(lastSubscript->type()->asArray()->elementCount(), lastField->type());
         } else if (lastSubscript->type()->isDynArray()) {
-            contType = new DynArrayType(lastSubscript->type()->asDynArray()->maxSize(), lastField->type());
+            contType = _types->dynArrayType(lastSubscript->type()->asDynArray()->maxSize(), lastField->type());
         } else {
             assert(false);
         }
-        ast->addType(contType.get());
+        // canonical type can already be listed by parser or by previous regexp
+        Ast::Types::Range types = ast->typesRange();
+        if (std::find(types.begin(), types.end(), contType.get()) == types.end()) {
+            ast->addType(contType.get());
+        }
     } else {
         contType = lastField->type();
     }
@@ -386,20 +679,98 @@ bool Package::mapComponent(Ast* ast)
 
 bool Package::resolveAll()
 {
+    std::vector<Ast*> mods;
+    for (Ast* ast : modules()) {
+        mods.push_back(ast);
+    }
+    ImportGraph graph(mods);
+    if (!graph.cycles().empty()) {
+        //TODO: report error
+        for (const ImportGraph::Modules& cycle : graph.cycles()) {
+            std::string msg = "circular imports: ";
+            for (const Ast* ast : cycle) {
+                msg += ast->moduleName().toStdString();
+                msg += ' ';
+            }
+            BMCL_CRITICAL() << msg;
+        }
+        BMCL_CRITICAL() << "failed to resolve package";
+        return false;
+    }
+
+    // modules of one wave only reference types of previous waves
+    std::size_t numJobs = isRcThreadSafe ? std::max<std::size_t>(1, _cfg->numJobs()) : 1;
+    std::vector<Rc<Arena>> arenas;
+    for (std::size_t i = 0; i < numJobs; i++) {
+        arenas.emplace_back(new Arena);
+    }
+    GenericInstantiationCache instantiations;
+    std::atomic<bool> isWaveOk(true);
+    for (const ImportGraph::Modules& wave : graph.waves()) {
+        parallelFor(numJobs, wave.size(), [&](std::size_t i, std::size_t worker) {
+            ArenaScope arenaScope(arenas[worker].get());
+            // generics reference imported types, they can't be resolved if some links are missing
+            if (!resolveImports(wave[i]) || !resolveGenerics(wave[i], &instantiations)) {
+                isWaveOk = false;
+            }
+        });
+        // next waves depend on unresolved types
+        if (!isWaveOk) {
+            BMCL_CRITICAL() << "failed to resolve package";
+            return false;
+        }
+    }
+
+    // component numbers, status order and parameter numbers depend on module order
     bool isOk = true;
     uint64_t paramNum = 0;
     for (Ast* modifiedAst : modules()) {
-        //BMCL_DEBUG() << "resolving " << modifiedAst->moduleInfo()->moduleName().toStdString();
         TRY(mapComponent(modifiedAst));
-        isOk &= resolveImports(modifiedAst);
-        isOk &= resolveGenerics(modifiedAst);
         isOk &= resolveStatuses(modifiedAst);
         isOk &= resolveParameters(modifiedAst, &paramNum);
     }
     if (!isOk) {
         BMCL_CRITICAL() << "failed to resolve package";
+        return false;
+    }
+    cacheTypeFacts();
+    buildWireLayouts();
+    return true;
+}
+
+void Package::buildWireLayouts()
+{
+    for (Ast* ast : modules()) {
+        for (Type* type : ast->typesRange()) {
+            if (type->isGenericInstantiation()) {
+                type = type->asGenericInstantiation()->instantiatedType();
+            }
+            if (type->isStruct() && !type->asStruct()->wireLayout()) {
+                type->asStruct()->setWireLayout(WireLayout::fromRange(type->asStruct()->fieldsRange()).get());
+            }
+        }
+    }
+    for (Component* comp : components()) {
+        for (Command* cmd : comp->cmdsRange()) {
+            cmd->setWireLayout(WireLayout::fromRange(cmd->argumentsRange()).get());
+        }
+        for (StatusMsg* msg : comp->statusesRange()) {
+            msg->setWireLayout(WireLayout::fromRange(msg->partsRange()).get());
+        }
+        for (EventMsg* msg : comp->eventsRange()) {
+            msg->setWireLayout(WireLayout::fromRange(msg->partsRange()).get());
+        }
+    }
+}
+
+void Package::cacheTypeFacts()
+{
+    // generators query sizes of the same types many times
+    for (const Ast* ast : modules()) {
+        for (const Type* type : ast->typesRange()) {
+            type->cacheFacts();
+        }
     }
-    return isOk;
 }
 
 bmcl::OptionPtr<Ast> Package::moduleWithName(bmcl::StringView name)
@@ -440,6 +811,11 @@ Package::AstMap::Range Package::modules()
     return _modNameToAstMap;
 }
 
+bool Package::isPartial() const
+{
+    return _isPartial;
+}
+
 const Diagnostics* Package::diagnostics() const
 {
     return _diag.get();
@@ -10,20 +10,30 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
 #include "decode/parser/Containers.h"
 
 #include <bmcl/Fwd.h>
 #include <bmcl/Buffer.h>
+#include <bmcl/SharedBytes.h>
+
+#include <vector>
 
 namespace decode {
 
 class Ast;
 class Diagnostics;
 class Parser;
+class ParseCache;
+class GenericInstantiationCache;
+class AllBuiltinTypes;
 class Package;
+class PackageIndex;
 class Component;
 class VarRegexp;
 class Configuration;
+class SymbolTable;
+class TypeTable;
 struct ComponentAndMsg;
 
 using PackageResult = bmcl::Result<Rc<Package>, void>;
@@ -45,11 +55,21 @@ public:
 
     static PackageResult readFromFiles(Configuration* cfg, Diagnostics* diag, bmcl::ArrayView<std::string> files);
     static PackageResult decodeFromMemory(Configuration* cfg, Diagnostics* diag, const void* src, std::size_t size);
+    // module contents are not copied, data must be a part of storage
+    static PackageResult decodeFromMemory(Configuration* cfg, Diagnostics* diag, const bmcl::SharedBytes& storage, bmcl::Bytes data);
+    // decodes only listed modules and modules they import, source packages are always decoded completely
+    static PackageResult decodeModulesFromMemory(Configuration* cfg, Diagnostics* diag, const void* src, std::size_t size, bmcl::ArrayView<std::string> modules);
+    static PackageResult decodeModulesFromMemory(Configuration* cfg, Diagnostics* diag, const bmcl::SharedBytes& storage, bmcl::Bytes data, bmcl::ArrayView<std::string> modules);
 
     ~Package();
 
+    // encoding is selected by Configuration::packageEncoding(), decoding functions accept any of them
+    // partial packages can't be encoded
     void encode(bmcl::Buffer* dest) const;
 
+    // true if only some modules of indexed package were decoded
+    bool isPartial() const;
+
     AstMap::ConstRange modules() const;
     AstMap::Range modules();
     ComponentMap::ConstRange components() const;
@@ -66,23 +86,38 @@ public:
 private:
     Package(Configuration* cfg, Diagnostics* diag);
 
-    bool addFile(const char* path, Parser* p);
+    bool addFiles(bmcl::ArrayView<std::string> files);
+    static PackageResult decode(Configuration* cfg, Diagnostics* diag, const bmcl::SharedBytes& storage, bmcl::Bytes data, bmcl::Option<bmcl::ArrayView<std::string>> modules);
+    bool decodeSources(bmcl::MemReader* reader, const bmcl::SharedBytes& storage, AllBuiltinTypes* builtinTypes);
+    bool decodeIndexed(const PackageIndex* index, bmcl::ArrayView<std::size_t> entries, const bmcl::SharedBytes& storage, AllBuiltinTypes* builtinTypes);
+    void encodeSources(bmcl::Buffer* dest) const;
+    void encodeIndexed(bmcl::Buffer* dest, bool withAsts) const;
+    Rc<Ast> parseFile(const std::string& path, Parser* p, Diagnostics* parserDiag, AllBuiltinTypes* builtinTypes, ParseCache* cache);
     void addAst(Ast* ast);
     bool resolveAll();
     bool resolveImports(Ast* ast);
-    bool resolveGenerics(Ast* ast);
+    bool resolveGenerics(Ast* ast, GenericInstantiationCache* cache);
     bool resolveStatuses(Ast* ast);
     bool resolveParameters(Ast* ast, uint64_t* paramNum);
 
     bool resolveVarRegexp(Ast* ast, Component* comp, VarRegexp* regexp);
 
     bool mapComponent(Ast* ast);
+    void cacheTypeFacts();
+    void buildWireLayouts();
 
     Rc<Diagnostics> _diag;
     Rc<Configuration> _cfg;
+    Rc<SymbolTable> _symbols;
+    Rc<TypeTable> _types;
     AstMap _modNameToAstMap;
     ComponentMap _components;
     CompAndMsgVec _statusMsgs;
+    // parser output serialized before resolving, only kept for preparsed encoding
+    // views point into _preparsedStorage
+    HashMap<const Ast*, bmcl::Bytes> _preparsedAsts;
+    std::vector<bmcl::SharedBytes> _preparsedStorage;
+    bool _isPartial;
 };
 
 }
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/parser/PackageIndex.h"
+#include "decode/core/HashMap.h"
+#include "decode/core/Utils.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+#include <bmcl/Sha3.h>
+#include <bmcl/StringViewHash.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace decode {
+
+// source packages start with non empty file name, so indexed packages are detected by leading zero byte
+const std::array<std::uint8_t, 4> indexedPackageMagic = {{0x00, 0x64, 0x70, 0x6b}};
+// incremented on every change of index or record layout, serialized asts are versioned separately
+constexpr std::uint64_t indexedPackageVersion = 3;
+
+PackageIndex::PackageIndex()
+    : _astVersion(0)
+    , _data(nullptr)
+    , _dataSize(0)
+{
+}
+
+PackageIndex::~PackageIndex()
+{
+}
+
+bool PackageIndex::isIndexed(const void* src, std::size_t size)
+{
+    return size >= indexedPackageMagic.size() && std::memcmp(src, indexedPackageMagic.data(), indexedPackageMagic.size()) == 0;
+}
+
+PackageModuleHash PackageIndex::hashRecord(bmcl::Bytes record)
+{
+    return bmcl::Sha3<512>::calcInOneStep(record);
+}
+
+PackageIndexResult PackageIndex::decode(const void* src, std::size_t size)
+{
+    if (!isIndexed(src, size)) {
+        return std::string("Invalid package magic");
+    }
+    bmcl::MemReader reader(src, size);
+    reader.skip(indexedPackageMagic.size());
+
+    std::uint64_t version;
+    if (!reader.readVarUint(&version)) {
+        return std::string("Error reading package version");
+    }
+    if (version != indexedPackageVersion) {
+        return "Unsupported package version " + std::to_string(version);
+    }
+
+    Rc<PackageIndex> index = new PackageIndex;
+    if (!reader.readVarUint(&index->_astVersion)) {
+        return std::string("Error reading ast version");
+    }
+
+    std::uint64_t numModules;
+    if (!reader.readVarUint(&numModules)) {
+        return std::string("Error reading module number");
+    }
+    for (std::uint64_t i = 0; i < numModules; i++) {
+        PackageIndexEntry entry;
+        auto name = deserializeString(&reader);
+        if (name.isErr()) {
+            return "Error reading module name (" + name.unwrapErr() + ")";
+        }
+        entry.moduleName = name.unwrap();
+
+        if (reader.readableSize() < entry.hash.size()) {
+            return std::string("Unexpected EOF reading module hash");
+        }
+        reader.read(entry.hash.data(), entry.hash.size());
+
+        std::uint64_t numImports;
+        if (!reader.readVarUint(&numImports)) {
+            return std::string("Error reading import number");
+        }
+        for (std::uint64_t j = 0; j < numImports; j++) {
+            auto import = deserializeString(&reader);
+            if (import.isErr()) {
+                return "Error reading import (" + import.unwrapErr() + ")";
+            }
+            entry.imports.push_back(import.unwrap());
+        }
+
+        std::uint64_t offset;
+        std::uint64_t recordSize;
+        if (!reader.readVarUint(&offset) || !reader.readVarUint(&recordSize)) {
+            return std::string("Error reading module record position");
+        }
+        entry.offset = offset;
+        entry.size = recordSize;
+        index->_entries.push_back(std::move(entry));
+    }
+
+    index->_data = reader.current();
+    index->_dataSize = reader.readableSize();
+    for (const PackageIndexEntry& entry : index->_entries) {
+        if (entry.offset > index->_dataSize || entry.size > index->_dataSize - entry.offset) {
+            return "Record of module " + entry.moduleName.toStdString() + " is out of bounds";
+        }
+    }
+    return std::move(index);
+}
+
+void PackageIndex::encode(std::uint64_t astVersion, bmcl::Buffer* dest) const
+{
+    dest->write(indexedPackageMagic.data(), indexedPackageMagic.size());
+    dest->writeVarUint(indexedPackageVersion);
+    dest->writeVarUint(astVersion);
+    dest->writeVarUint(_entries.size());
+    for (const PackageIndexEntry& entry : _entries) {
+        serializeString(entry.moduleName, dest);
+        dest->write(entry.hash.data(), entry.hash.size());
+        dest->writeVarUint(entry.imports.size());
+        for (bmcl::StringView import : entry.imports) {
+            serializeString(import, dest);
+        }
+        dest->writeVarUint(entry.offset);
+        dest->writeVarUint(entry.size);
+    }
+}
+
+void PackageIndex::addEntry(PackageIndexEntry&& entry)
+{
+    _entries.push_back(std::move(entry));
+}
+
+bmcl::ArrayView<PackageIndexEntry> PackageIndex::entries() const
+{
+    return _entries;
+}
+
+std::uint64_t PackageIndex::astVersion() const
+{
+    return _astVersion;
+}
+
+bmcl::Bytes PackageIndex::record(const PackageIndexEntry& entry) const
+{
+    return bmcl::Bytes(_data + entry.offset, entry.size);
+}
+
+const PackageIndexEntry* PackageIndex::entryWithName(bmcl::StringView name) const
+{
+    auto it = std::find_if(_entries.begin(), _entries.end(), [name](const PackageIndexEntry& entry) {
+        return entry.moduleName == name;
+    });
+    if (it == _entries.end()) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+bmcl::Result<std::vector<std::size_t>, std::string> PackageIndex::importClosure(bmcl::ArrayView<std::string> modules) const
+{
+    HashMap<bmcl::StringView, std::size_t> indices;
+    for (std::size_t i = 0; i < _entries.size(); i++) {
+        indices.emplace(_entries[i].moduleName, i);
+    }
+
+    std::vector<bool> isRequired(_entries.size(), false);
+    std::vector<std::size_t> stack;
+    for (const std::string& name : modules) {
+        auto it = indices.find(name);
+        if (it == indices.end()) {
+            return "No module with name " + name;
+        }
+        stack.push_back(it->second);
+    }
+    while (!stack.empty()) {
+        std::size_t current = stack.back();
+        stack.pop_back();
+        if (isRequired[current]) {
+            continue;
+        }
+        isRequired[current] = true;
+        for (bmcl::StringView import : _entries[current].imports) {
+            auto it = indices.find(import);
+            if (it == indices.end()) {
+                return "Module " + _entries[current].moduleName.toStdString() + " imports unknown module " + import.toStdString();
+            }
+            stack.push_back(it->second);
+        }
+    }
+
+    std::vector<std::size_t> closure;
+    for (std::size_t i = 0; i < _entries.size(); i++) {
+        if (isRequired[i]) {
+            closure.push_back(i);
+        }
+    }
+    return std::move(closure);
+}
+}
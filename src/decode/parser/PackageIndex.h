@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/ArrayView.h>
+#include <bmcl/StringView.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace decode {
+
+class PackageIndex;
+
+using PackageModuleHash = std::array<std::uint8_t, 512 / 8>;
+using PackageIndexResult = bmcl::Result<Rc<PackageIndex>, std::string>;
+
+struct PackageIndexEntry {
+    bmcl::StringView moduleName;
+    // hash of module record, checked before record is decoded
+    PackageModuleHash hash;
+    std::vector<bmcl::StringView> imports;
+    // module record position relative to package data
+    std::size_t offset;
+    std::size_t size;
+};
+
+// module table of indexed packages
+// allows decoding only required modules without reading the rest of the package
+class PackageIndex : public RefCountable {
+public:
+    using Pointer = Rc<PackageIndex>;
+    using ConstPointer = Rc<const PackageIndex>;
+    using Entries = std::vector<PackageIndexEntry>;
+
+    PackageIndex();
+    ~PackageIndex();
+
+    static bool isIndexed(const void* src, std::size_t size);
+    // index references src memory, it must outlive index
+    static PackageIndexResult decode(const void* src, std::size_t size);
+
+    static PackageModuleHash hashRecord(bmcl::Bytes record);
+
+    // writes header and module table, records are appended after them in entry order
+    void encode(std::uint64_t astVersion, bmcl::Buffer* dest) const;
+    void addEntry(PackageIndexEntry&& entry);
+
+    bmcl::ArrayView<PackageIndexEntry> entries() const;
+    std::uint64_t astVersion() const;
+    bmcl::Bytes record(const PackageIndexEntry& entry) const;
+    const PackageIndexEntry* entryWithName(bmcl::StringView name) const;
+
+    // returns indices of listed modules and all modules they import in table order
+    bmcl::Result<std::vector<std::size_t>, std::string> importClosure(bmcl::ArrayView<std::string> modules) const;
+
+private:
+    Entries _entries;
+    std::uint64_t _astVersion;
+    const std::uint8_t* _data;
+    std::size_t _dataSize;
+};
+}
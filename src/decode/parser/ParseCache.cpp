@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/parser/ParseCache.h"
+#include "decode/parser/AstSerializer.h"
+#include "decode/core/Diagnostics.h"
+#include "decode/core/FileInfo.h"
+#include "decode/core/Utils.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/ModuleInfo.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/FileUtils.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+#include <bmcl/Sha3.h>
+
+#include <array>
+#include <cstdio>
+#include <random>
+
+namespace decode {
+
+using CacheHashType = bmcl::Sha3<512>;
+using CacheKey = std::array<std::uint8_t, 512 / 8>;
+
+const std::array<std::uint8_t, 4> cacheMagic = {{0x64, 0x70, 0x63, 0x00}};
+
+static CacheKey cacheKey(bmcl::StringView contents)
+{
+    return CacheHashType::calcInOneStep(contents.asBytes());
+}
+
+static std::string entryPath(const std::string& dir, const CacheKey& key)
+{
+    constexpr const char* chars = "0123456789abcdef";
+    std::string path = dir;
+    path.push_back('/');
+    // first half of the key is enough to name the entry, full key is checked on load
+    for (std::size_t i = 0; i < key.size() / 2; i++) {
+        path.push_back(chars[(key[i] & 0xf0) >> 4]);
+        path.push_back(chars[key[i] & 0x0f]);
+    }
+    path.append(".ast");
+    return path;
+}
+
+ParseCache::ParseCache(const std::string& dir)
+    : _dir(dir)
+    , _hits(0)
+    , _misses(0)
+{
+}
+
+ParseCache::~ParseCache()
+{
+}
+
+bool ParseCache::init(Diagnostics* diag)
+{
+    return makeDirectoryRecursive(_dir, diag);
+}
+
+Rc<Ast> ParseCache::load(FileInfo* finfo, AllBuiltinTypes* builtinTypes)
+{
+    CacheKey key = cacheKey(finfo->contents());
+    auto rv = bmcl::readFileIntoString(entryPath(_dir, key).c_str());
+    if (rv.isErr()) {
+        _misses++;
+        return nullptr;
+    }
+
+    bmcl::MemReader reader(rv.unwrap().data(), rv.unwrap().size());
+    std::array<std::uint8_t, 4> magic;
+    std::uint64_t version;
+    CacheKey storedKey;
+    if (reader.readableSize() < magic.size()) {
+        _misses++;
+        return nullptr;
+    }
+    reader.read(magic.data(), magic.size());
+    if (magic != cacheMagic || !reader.readVarUint(&version) || reader.readableSize() < storedKey.size()) {
+        _misses++;
+        return nullptr;
+    }
+    reader.read(storedKey.data(), storedKey.size());
+    if (version != astSerializerVersion || storedKey != key) {
+        _misses++;
+        return nullptr;
+    }
+
+    auto ast = deserializeAst(&reader, finfo, builtinTypes);
+    if (ast.isErr()) {
+        _misses++;
+        return nullptr;
+    }
+
+    _hits++;
+    return ast.unwrap();
+}
+
+void ParseCache::store(const Ast* ast)
+{
+    const FileInfo* finfo = ast->moduleInfo()->fileInfo();
+    CacheKey key = cacheKey(finfo->contents());
+
+    bmcl::Buffer dest;
+    dest.write(cacheMagic.data(), cacheMagic.size());
+    dest.writeVarUint(astSerializerVersion);
+    dest.write(key.data(), key.size());
+    if (!serializeAst(ast, &dest)) {
+        return;
+    }
+
+    // entry is written to a temporary file first so that concurrent runs never read partial entries
+    std::string path = entryPath(_dir, key);
+    std::string tmpPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    Rc<Diagnostics> diag = new Diagnostics;
+    if (!saveOutput(tmpPath, bmcl::Bytes(dest.data(), dest.size()), diag.get())) {
+        std::remove(tmpPath.c_str());
+        return;
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+    }
+}
+
+std::size_t ParseCache::hits() const
+{
+    return _hits;
+}
+
+std::size_t ParseCache::misses() const
+{
+    return _misses;
+}
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace decode {
+
+class Ast;
+class AllBuiltinTypes;
+class Diagnostics;
+class FileInfo;
+
+// on-disk cache of parsed modules, entries are keyed by hash of module contents and serializer version
+// safe to use from multiple threads
+class ParseCache : public RefCountable {
+public:
+    using Pointer = Rc<ParseCache>;
+    using ConstPointer = Rc<const ParseCache>;
+
+    ParseCache(const std::string& dir);
+    ~ParseCache();
+
+    bool init(Diagnostics* diag);
+
+    // returns null on cache miss
+    Rc<Ast> load(FileInfo* finfo, AllBuiltinTypes* builtinTypes);
+    // errors are ignored, entry is rebuilt on next run
+    void store(const Ast* ast);
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+private:
+    std::string _dir;
+    std::atomic<std::size_t> _hits;
+    std::atomic<std::size_t> _misses;
+};
+}
@@ -12,9 +12,11 @@
 #include "decode/core/Diagnostics.h"
 #include "decode/core/CfgOption.h"
 #include "decode/core/HashMap.h"
+#include "decode/core/SymbolTable.h"
 #include "decode/core/RangeAttr.h"
 #include "decode/core/CmdCallAttr.h"
 #include "decode/ast/AllBuiltinTypes.h"
+#include "decode/ast/TypeTable.h"
 #include "decode/ast/Decl.h"
 #include "decode/ast/DocBlock.h"
 #include "decode/ast/Ast.h"
@@ -29,7 +31,6 @@
 #include "decode/ast/Component.h"
 #include "decode/ast/Constant.h"
 
-#include <bmcl/FileUtils.h>
 #include <bmcl/Logging.h>
 #include <bmcl/Result.h>
 #include <bmcl/Panic.h>
@@ -49,12 +50,20 @@
 namespace decode {
 
 #define ADD_BUILTIN_MAP(name, str) \
-    _btMap.emplace(str, _builtinTypes->name##Type())
+    _btMap.emplace(_symbols->intern(str), _builtinTypes->name##Type())
 
-Parser::Parser(Diagnostics* diag)
+Parser::Parser(Diagnostics* diag, LexerBackend lexerBackend)
+    : Parser(diag, lexerBackend, new AllBuiltinTypes, new SymbolTable, new TypeTable)
+{
+}
+
+Parser::Parser(Diagnostics* diag, LexerBackend lexerBackend, AllBuiltinTypes* builtinTypes, SymbolTable* symbols, TypeTable* types)
     : _diag(diag)
-    , _builtinTypes(new AllBuiltinTypes)
+    , _builtinTypes(builtinTypes)
+    , _symbols(symbols)
+    , _types(types)
     , _currentTmMsgNum(0)
+    , _lexerBackend(lexerBackend)
 {
     ADD_BUILTIN_MAP(usize, "usize");
     ADD_BUILTIN_MAP(isize, "isize");
@@ -186,24 +195,6 @@ static std::string tokenKindToString(TokenKind kind)
     bmcl::panic("unreachable"); //TODO: add macro
 }
 
-void Parser::finishSplittingLines()
-{
-    const char* start = _lastLineStart;
-    const char* current = start;
-    while (true) {
-        char c = *current;
-        if (c == '\n') {
-            _fileInfo->addLine(start, current);
-            start = current;
-        }
-        if (c == '\0') {
-            break;
-        }
-        current++;
-    }
-    _lastLineStart = current;
-}
-
 void Parser::reportUnexpectedTokenError(TokenKind expected)
 {
     std::string msg = "expected " + tokenKindToString(expected);
@@ -212,23 +203,20 @@ void Parser::reportUnexpectedTokenError(TokenKind expected)
 
 ParseResult Parser::parseFile(const char* fname)
 {
-    bmcl::Result<std::string, int> rv = bmcl::readFileIntoString(fname);
-    if (rv.isErr()) {
+    FileInfoResult finfo = FileInfo::fromFile(fname);
+    if (finfo.isErr()) {
         return ParseResult();
     }
 
-    Rc<FileInfo> finfo = new FileInfo(std::string(fname), rv.take());
-    return parseFile(finfo.get());
+    return parseFile(finfo.unwrap().get());
 }
 
 ParseResult Parser::parseFile(FileInfo* finfo)
 {
     cleanup();
     if (parseOneFile(finfo)) {
-        finishSplittingLines();
         return _ast;
     }
-    finishSplittingLines();
     return ParseResult();
 }
 
@@ -237,12 +225,6 @@ void Parser::consume()
     _lexer->consumeNextToken(&_currentToken);
 }
 
-void Parser::addLine()
-{
-    const char* current = _currentToken.begin();
-    _fileInfo->addLine(_lastLineStart, current);
-}
-
 bool Parser::skipCommentsAndSpace()
 {
     while (true) {
@@ -254,9 +236,7 @@ bool Parser::skipCommentsAndSpace()
             consume();
             break;
         case TokenKind::Eol:
-            addLine();
             consume();
-            _lastLineStart = _currentToken.begin();
             break;
 //         case TokenKind::RawComment:
 //             consume();
@@ -266,7 +246,6 @@ bool Parser::skipCommentsAndSpace()
             consume();
             break;
         case TokenKind::Eof:
-            addLine();
             return true;
         case TokenKind::Invalid:
             reportCurrentTokenError("invalid token");
@@ -322,7 +301,7 @@ template <typename T>
 Rc<T> Parser::beginDecl()
 {
     Rc<T> decl = new T;
-    decl->_start = _currentToken.location();
+    decl->_start = currentLoc();
     return decl;
 }
 
@@ -336,7 +315,7 @@ void Parser::consumeAndEndDecl(const Rc<T>& decl)
 template <typename T>
 void Parser::endDecl(const Rc<T>& decl)
 {
-    decl->_end = _currentToken.location();
+    decl->_end = currentLoc();
     decl->_moduleInfo = _moduleInfo;
 }
 
@@ -364,7 +343,7 @@ bool Parser::currentTokenIs(TokenKind kind)
 Rc<Report> Parser::reportTokenError(Token* tok, const char* msg)
 {
     Rc<Report> report = _diag->addReport();
-    report->setLocation(_fileInfo.get(), tok->location());
+    report->setLocation(_fileInfo.get(), _lexer->location(tok->begin()));
     report->setLevel(Report::Error);
     report->setMessage(msg);
     report->setHighlightMessage(true);
@@ -384,7 +363,7 @@ Rc<Report> Parser::reportCurrentTokenError(const std::string& str)
 bool Parser::parseModuleDecl()
 {
     Rc<DocBlock> docs = createDocsFromComments();
-    Location start = _currentToken.location();
+    Location start = currentLoc();
     TRY(expectCurrentToken(TokenKind::Module, "every module must begin with module declaration"));
     consume();
 
@@ -397,7 +376,7 @@ bool Parser::parseModuleDecl()
     _moduleInfo = new ModuleInfo(modName, _fileInfo.get());
     _moduleInfo->setDocs(docs.get());
 
-    Rc<ModuleDecl> modDecl = new ModuleDecl(_moduleInfo.get(), start, _currentToken.location());
+    Rc<ModuleDecl> modDecl = new ModuleDecl(_moduleInfo.get(), start, currentLoc());
     _ast->setModuleDecl(modDecl.get());
     consume();
 
@@ -415,6 +394,13 @@ void Parser::clearUnusedDocCommentsAndAttributes()
 void Parser::clearGenericParameters()
 {
     _currentGenericParameters.clear();
+    _currentGenericParameterSymbols.clear();
+}
+
+void Parser::addTopLevelType(NamedType* type, Symbol symbol)
+{
+    _ast->addTopLevelType(type);
+    _typesBySymbol.emplace(symbol, type);
 }
 
 bool Parser::parseImports()
@@ -435,6 +421,8 @@ bool Parser::parseImports()
             if (!import->addType(type.get())) {
                 reportCurrentTokenError("duplicate import");
                 //TODO: add note - previous import
+            } else {
+                _typesBySymbol.emplace(_currentToken.symbol(), type.get());
             }
             consume();
         };
@@ -871,15 +859,15 @@ bool Parser::parseImplBlock()
         return true;
     }));
 
-    bmcl::OptionPtr<NamedType> type = _ast->findTypeWithName(block->name());
-    if (type.isNone()) {
+    auto type = _typesBySymbol.find(typeNameToken.symbol());
+    if (type == _typesBySymbol.end()) {
         std::string msg = "no type with name " + typeNameToken.value().toStdString();
         reportTokenError(&typeNameToken, msg.c_str());
         return false;
     }
 
     //TODO: check conflicts
-    _ast->addImplBlock(type.unwrap(), block.get());
+    _ast->addImplBlock(type->second.get(), block.get());
 
     clearUnusedDocCommentsAndAttributes();
     return true;
@@ -895,6 +883,7 @@ bool Parser::parseAlias()
 
     TRY(expectCurrentToken(TokenKind::Identifier));
     bmcl::StringView name = _currentToken.value();
+    Symbol symbol = _currentToken.symbol();
 
     consumeAndSkipBlanks();
     TRY(expectCurrentToken(TokenKind::Equality));
@@ -914,12 +903,20 @@ bool Parser::parseAlias()
     consume();
 
     //TODO: check conflicts
-    _ast->addTopLevelType(type.get());
+    addTopLevelType(type.get(), symbol);
 
     clearUnusedDocCommentsAndAttributes();
     return true;
 }
 
+void Parser::addAnonymousType(Type* type)
+{
+    // canonical types are shared with other modules, every module lists them once
+    if (_anonymousTypes.insert(type).second) {
+        _ast->addType(type);
+    }
+}
+
 Rc<Type> Parser::parseReferenceType()
 {
     TRY(skipCommentsAndSpace());
@@ -952,8 +949,8 @@ Rc<Type> Parser::parseReferenceType()
         return nullptr;
     }
 
-    Rc<ReferenceType> type = new ReferenceType(ReferenceKind::Reference, isMutable, pointee.get());
-    _ast->addType(type.get());
+    Rc<ReferenceType> type = _types->referenceType(ReferenceKind::Reference, isMutable, pointee.get());
+    addAnonymousType(type.get());
     return type;
 }
 
@@ -983,8 +980,8 @@ Rc<Type> Parser::parsePointerType()
     }
 
     if (!pointee.isNull()) {
-        Rc<ReferenceType> type = new ReferenceType(ReferenceKind::Pointer, isMutable, pointee.get());
-        _ast->addType(type.get());
+        Rc<ReferenceType> type = _types->referenceType(ReferenceKind::Pointer, isMutable, pointee.get());
+        addAnonymousType(type.get());
         return type;
     }
 
@@ -1078,8 +1075,8 @@ Rc<Type> Parser::parseDynArrayType()
     TRY(expectCurrentToken(TokenKind::RBracket));
     consume();
 
-    Rc<DynArrayType> type = new DynArrayType(maxSize, innerType.get());
-    _ast->addType(type.get());
+    Rc<DynArrayType> type = _types->dynArrayType(maxSize, innerType.get());
+    addAnonymousType(type.get());
     return type;
 }
 
@@ -1105,8 +1102,8 @@ Rc<Type> Parser::parseArrayType()
     TRY(expectCurrentToken(TokenKind::RBracket));
     consume();
 
-    Rc<ArrayType> type = new ArrayType(elementCount, innerType.get());
-    _ast->addType(type.get());
+    Rc<ArrayType> type = _types->arrayType(elementCount, innerType.get());
+    addAnonymousType(type.get());
     return type;
 }
 
@@ -1150,6 +1147,7 @@ Rc<Type> Parser::parseBuiltinOrResolveType()
 {
     TRY(expectCurrentToken(TokenKind::Identifier));
     bmcl::StringView name = _currentToken.value();
+    Symbol symbol = _currentToken.symbol();
     consume();
 
     if (currentTokenIs(TokenKind::LessThen)) {
@@ -1162,14 +1160,15 @@ Rc<Type> Parser::parseBuiltinOrResolveType()
             vec->push_back(std::move(type));
             return true;
         }));
-        auto type = _ast->findTypeWithName(name);
-        if (type.isNone()) {
+        auto it = _typesBySymbol.find(symbol);
+        if (it == _typesBySymbol.end()) {
             std::string msg = "No type with name " + name.toStdString();
             reportCurrentTokenError(msg.c_str());
             return nullptr;
         }
+        NamedType* type = it->second.get();
         if (type->isImported() || type->isGeneric()) {
-            Rc<GenericInstantiationType> generic = new GenericInstantiationType(name, vec, type.unwrap());
+            Rc<GenericInstantiationType> generic = new GenericInstantiationType(name, vec, type);
             _ast->addGenericInstantiation(generic.get());
             return generic;
         } else {
@@ -1179,23 +1178,21 @@ Rc<Type> Parser::parseBuiltinOrResolveType()
         }
     }
 
-    auto it = _btMap.find(name);
+    auto it = _btMap.find(symbol);
     if (it != _btMap.end()) {
         return it->second;
     }
-    auto link = _ast->findTypeWithName(name);
-    if (link.isSome()) {
-        return link.unwrap();
+    auto jt = _typesBySymbol.find(symbol);
+    if (jt != _typesBySymbol.end()) {
+        return jt->second;
     }
-    auto jt = std::find_if(_currentGenericParameters.begin(), _currentGenericParameters.end(), [name](const Rc<GenericParameterType>& type) {
-        return type->name() == name;
-    });
-    if (jt == _currentGenericParameters.end()) {
+    auto kt = std::find(_currentGenericParameterSymbols.begin(), _currentGenericParameterSymbols.end(), symbol);
+    if (kt == _currentGenericParameterSymbols.end()) {
         std::string msg = "No type with name " + name.toStdString();
         reportCurrentTokenError(msg.c_str());
         return nullptr;
     }
-    return *jt;
+    return _currentGenericParameters[kt - _currentGenericParameterSymbols.begin()];
 }
 
 Rc<Field> Parser::parseField()
@@ -1372,6 +1369,7 @@ bool Parser::parseTag(TokenKind startToken, F&& fieldParser, A&&... args)
     TRY(expectCurrentToken(TokenKind::Identifier));
 
     bmcl::StringView name = _currentToken.value();
+    Symbol symbol = _currentToken.symbol();
     Rc<T> type = new T(name, _moduleInfo.get());
     type->setDocs(docs.get());
     consumeAndSkipBlanks();
@@ -1382,6 +1380,7 @@ bool Parser::parseTag(TokenKind startToken, F&& fieldParser, A&&... args)
             //TODO: check name conflicts
             TRY(expectCurrentToken(TokenKind::Identifier));
             _currentGenericParameters.emplace_back(new GenericParameterType(_currentToken.value(), _moduleInfo.get()));
+            _currentGenericParameterSymbols.push_back(_currentToken.symbol());
             consume();
             return true;
         }));
@@ -1394,9 +1393,9 @@ bool Parser::parseTag(TokenKind startToken, F&& fieldParser, A&&... args)
     clearGenericParameters();
 
     if (!genericType.isNull()) {
-        _ast->addTopLevelType(genericType.get());
+        addTopLevelType(genericType.get(), symbol);
     } else {
-        _ast->addTopLevelType(type.get());
+        addTopLevelType(type.get(), symbol);
     }
     return true;
 }
@@ -1856,8 +1855,12 @@ bool Parser::parseOneFile(FileInfo* finfo)
     _currentTmMsgNum = 0;
     _fileInfo = finfo;
 
-    _lastLineStart = _fileInfo->contents().c_str();
-    _lexer = new Lexer(bmcl::StringView(_fileInfo->contents()));
+    if (_fileInfo->contents().size() > TokenBuffer::maxDataSize) {
+        _diag->buildSystemFileErrorReport("failed to parse file", "file size must be less than 4 GiB", _fileInfo->fileName());
+        return false;
+    }
+
+    _lexer = new Lexer(_fileInfo->contents(), _lexerBackend, _symbols.get());
     _ast = new Ast(_builtinTypes.get());
 
     _lexer->consumeNextToken(&_currentToken);
@@ -1872,6 +1875,8 @@ bool Parser::parseOneFile(FileInfo* finfo)
 void Parser::cleanup()
 {
     _docComments.clear();
+    _typesBySymbol.clear();
+    _anonymousTypes.clear();
     _lexer = nullptr;
     _fileInfo = nullptr;
     _moduleInfo = nullptr;
@@ -1880,7 +1885,7 @@ void Parser::cleanup()
 
 Location Parser::currentLoc() const
 {
-    return _currentToken.location();
+    return _lexer->location(_currentToken.begin());
 }
 }
 
@@ -10,9 +10,12 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/LexerBackend.h"
+#include "decode/core/Location.h"
 #include "decode/parser/Token.h"
 #include "decode/core/Iterator.h"
 #include "decode/core/HashMap.h"
+#include "decode/core/HashSet.h"
 #include "decode/parser/Containers.h"
 
 #include <bmcl/Fwd.h>
@@ -53,6 +56,9 @@ class Type;
 class TypeDecl;
 class VariantType;
 class AllBuiltinTypes;
+class SymbolTable;
+class TypeTable;
+class NamedType;
 class CmdCallAttr;
 class Parameter;
 class VarRegexp;
@@ -64,7 +70,9 @@ using ParseResult = bmcl::Result<Rc<Ast>, void>;
 
 class DECODE_EXPORT Parser {
 public:
-    Parser(Diagnostics* diag);
+    Parser(Diagnostics* diag, LexerBackend lexerBackend = LexerBackend::Scanner);
+    // builtin types, symbol and type tables are shared between parsers that produce modules of the same package
+    Parser(Diagnostics* diag, LexerBackend lexerBackend, AllBuiltinTypes* builtinTypes, SymbolTable* symbols, TypeTable* types);
     Parser(Parser&& other) = delete; // msvc 2015 hack
     ~Parser();
 
@@ -83,8 +91,6 @@ private:
     bool consumeAndExpectCurrentToken(TokenKind expected, const char* msg);
     void reportUnexpectedTokenError(TokenKind expected);
 
-    void addLine();
-
     void consume();
     bool skipCommentsAndSpace();
     void consumeAndSkipBlanks();
@@ -173,11 +179,11 @@ private:
 
     bool currentTokenIs(TokenKind kind);
 
-    void finishSplittingLines();
-
     Rc<DocBlock> createDocsFromComments();
     void clearUnusedDocCommentsAndAttributes();
     void clearGenericParameters();
+    void addTopLevelType(NamedType* type, Symbol symbol);
+    void addAnonymousType(Type* type);
 
     Rc<Report> reportCurrentTokenError(const char* msg);
     Rc<Report> reportCurrentTokenError(const std::string& str);
@@ -192,14 +198,21 @@ private:
     Rc<ModuleInfo> _moduleInfo;
 
     Rc<AllBuiltinTypes> _builtinTypes;
+    Rc<SymbolTable> _symbols;
+    Rc<TypeTable> _types;
 
-    const char* _lastLineStart;
     std::size_t _currentTmMsgNum;
     std::size_t _currentCmdRegexpNum;
     std::vector<bmcl::StringView> _docComments;
     RcVec<GenericParameterType> _currentGenericParameters;
+    std::vector<Symbol> _currentGenericParameterSymbols;
     Rc<RangeAttr> _lastRangeAttr;
     Rc<CmdCallAttr> _lastCmdCallAttr;
-    HashMap<bmcl::StringView, Rc<BuiltinType>> _btMap;
+    HashMap<Symbol, Rc<BuiltinType>> _btMap;
+    // top level types of current module, mirrors Ast::findTypeWithName
+    HashMap<Symbol, Rc<NamedType>> _typesBySymbol;
+    // canonical anonymous types already added to current module
+    HashSet<const Type*> _anonymousTypes;
+    LexerBackend _lexerBackend;
 };
 }
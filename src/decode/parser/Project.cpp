@@ -17,22 +17,27 @@
 #include "decode/ast/Ast.h"
 #include "decode/ast/Component.h"
 #include "decode/generator/Generator.h"
-#include "decode/core/Zpaq.h"
+#include "decode/core/Compression.h"
+#include "decode/core/Delta.h"
 #include "decode/core/Utils.h"
 #include "decode/core/ProgressPrinter.h"
 #include "decode/core/HashMap.h"
+#include "decode/core/FileInfo.h"
 
 #include <bmcl/Result.h>
 #include <bmcl/StringView.h>
 #include <bmcl/Logging.h>
 #include <bmcl/MemReader.h>
-#include <bmcl/FileUtils.h>
+#include <bmcl/SharedBytes.h>
 #include <bmcl/Sha3.h>
 #include <bmcl/FixedArrayView.h>
 
 #include <toml11/toml.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <set>
+#include <thread>
 
 namespace decode {
 
@@ -143,16 +148,16 @@ static void addParseError(bmcl::StringView path, bmcl::StringView cause, Diagnos
 
 static TableResult readToml(const std::string& path, Diagnostics* diag)
 {
-    auto file = bmcl::readFileIntoString(path.c_str());
+    FileInfoResult file = FileInfo::fromFile(path.c_str());
     if (file.isErr()) {
         diag->buildSystemFileErrorReport("failed to read file", file.unwrapErr(), path);
         return TableResult();
     }
-    std::string::iterator begin = file.unwrap().begin();
-    std::string::iterator end = file.unwrap().end();
+    const char* begin = file.unwrap()->contents().begin();
+    const char* end = file.unwrap()->contents().end();
     try {
         return toml::parse_data::invoke(begin, end);
-    } catch (const std::pair<std::string::iterator, toml::syntax_error>& exc) {
+    } catch (const std::pair<const char*, toml::syntax_error>& exc) {
         addParseError(path, exc.second.what(), diag);
         //BMCL_DEBUG() << std::string(exc.first, end);
         return TableResult();
@@ -406,12 +411,19 @@ ProjectResult Project::fromFile(Configuration* cfg, Diagnostics* diag, const cha
 
 bool Project::generate(const char* destDir, const GeneratorConfig& cfg)
 {
+    if (isPartial()) {
+        addError("error generating sources", "project was decoded partially", _diag.get());
+        return false;
+    }
+
     ProgressPrinter printer(_cfg->verboseOutput());
     printer.printActionProgress("Generating", "sources");
 
     Rc<Generator> gen = new Generator(_diag.get());
     gen->setOutPath(destDir);
     bool genOk = gen->generateProject(this, cfg);
+    printer.printActionProgress("Saved", std::to_string(gen->numWrittenFiles()) + " files, "
+                                + std::to_string(gen->numUnchangedFiles()) + " files unchanged");
     //if (genOk) {
     //    BMCL_DEBUG() << "generating complete";
     //} else {
@@ -440,10 +452,26 @@ const MagicType magic = {{0x7a, 0x70, 0x61, 0x71}};
 
 ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std::size_t size)
 {
-    ZpaqResult rv = zpaqDecompress(src, size);
-    if (rv.isErr()) {
-        addError("error decompressing project from memory", rv.unwrapErr(), diag);
-        return ProjectResult();
+    return decode(diag, src, size, bmcl::None);
+}
+
+ProjectResult Project::decodeDevicesFromMemory(Diagnostics* diag, const void* src, std::size_t size, bmcl::ArrayView<std::string> deviceNames)
+{
+    return decode(diag, src, size, deviceNames);
+}
+
+ProjectResult Project::decode(Diagnostics* diag, const void* src, std::size_t size, bmcl::Option<bmcl::ArrayView<std::string>> deviceNames)
+{
+    // module sources reference decompressed project instead of being copied
+    bmcl::SharedBytes data;
+    CompressionCodec codec;
+    {
+        CompressionResult rv = decompressData(src, size, std::max(1u, std::thread::hardware_concurrency()), &codec);
+        if (rv.isErr()) {
+            addError("error decompressing project from memory", rv.unwrapErr(), diag);
+            return ProjectResult();
+        }
+        data = bmcl::SharedBytes::create(rv.unwrap().data(), rv.unwrap().size());
     }
 
     auto addReadErr = [diag](bmcl::StringView cause) {
@@ -454,7 +482,7 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
         addReadErr(cause.toStdString() + "(" + strCause.toStdString() + ")");
     };
 
-    bmcl::MemReader reader(rv.unwrap().data(), rv.unwrap().size());
+    bmcl::MemReader reader(data.data(), data.size());
     if (reader.readableSize() < (magic.size() + 2)) {
         addReadErr("Unexpected EOF reading magic");
         return ProjectResult();
@@ -473,6 +501,7 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
 
     cfg->setGeneratedCodeDebugLevel(reader.readUint8());
     cfg->setCompressionLevel(reader.readUint8());
+    cfg->setCompressionCodec(codec);
 
     uint64_t numOptions;
     if (!reader.readVarUint(&numOptions)) {
@@ -523,12 +552,12 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
     }
 
     uint32_t packageSize = reader.readUint32Le();
-
-    PackageResult package = Package::decodeFromMemory(cfg.get(), diag, reader.current(), packageSize);
-
-    if (package.isErr()) {
+    if (reader.readableSize() < packageSize) {
+        addReadErr("Unexpected EOF reading package");
         return ProjectResult();
     }
+    const uint8_t* packageData = reader.current();
+    // devices are read before package so that only modules of requested devices are decoded
     reader.skip(packageSize);
 
     uint64_t devNum;
@@ -549,11 +578,11 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
 
     std::vector<Rc<Device>> devices;
     std::vector<Rc<DeviceConnection>> connections;
+    std::vector<std::vector<bmcl::StringView>> deviceModules;
     for (uint64_t i = 0; i < devNum; i++) {
         Rc<Device> dev = new Device;
         Rc<DeviceConnection> conn = new DeviceConnection(dev.get());
         connections.push_back(conn);
-        dev->_package = package.unwrap();
         if (!reader.readVarUint(&dev->_id)) {
             addReadErr("Error reading device id");
             return ProjectResult();
@@ -572,20 +601,55 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
             return ProjectResult();
         }
 
+        deviceModules.emplace_back();
         for (uint64_t j = 0; j < modNum; j++) {
             auto modName = deserializeString(&reader);
-            if (name.isErr()) {
+            if (modName.isErr()) {
                 addReadStrErr("Error reading module name", modName.unwrapErr());
                 return ProjectResult();
             }
-            auto mod = package.unwrap()->moduleWithName(modName.unwrap());
-            if (mod.isNone()) {
+            deviceModules.back().push_back(modName.unwrap());
+        }
+        devices.push_back(std::move(dev));
+    }
+
+    PackageResult package;
+    if (deviceNames.isSome()) {
+        std::vector<std::string> modules;
+        for (const std::string& devName : deviceNames.unwrap()) {
+            auto it = std::find_if(devices.begin(), devices.end(), [&devName](const Rc<Device>& dev) {
+                return dev->_name == devName;
+            });
+            if (it == devices.end()) {
+                addReadErr("No device with name " + devName);
+                return ProjectResult();
+            }
+            for (bmcl::StringView modName : deviceModules[it - devices.begin()]) {
+                modules.push_back(modName.toStdString());
+            }
+        }
+        package = Package::decodeModulesFromMemory(cfg.get(), diag, data, bmcl::Bytes(packageData, packageSize), modules);
+    } else {
+        package = Package::decodeFromMemory(cfg.get(), diag, data, bmcl::Bytes(packageData, packageSize));
+    }
+    if (package.isErr()) {
+        return ProjectResult();
+    }
+
+    for (std::size_t i = 0; i < devices.size(); i++) {
+        devices[i]->_package = package.unwrap();
+        for (bmcl::StringView modName : deviceModules[i]) {
+            auto mod = package.unwrap()->moduleWithName(modName);
+            if (mod.isSome()) {
+                devices[i]->_modules.emplace_back(mod.unwrap());
+                continue;
+            }
+            // devices that were not requested keep only modules shared with requested ones
+            if (deviceNames.isNone()) {
                 addReadErr("Invalid module name reference");
                 return ProjectResult();
             }
-            dev->_modules.emplace_back(mod.unwrap());
         }
-        devices.push_back(std::move(dev));
     }
 
     for (uint64_t i = 0; i < devNum; i++) {
@@ -631,9 +695,11 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
         }
     }
 
-    for (uint64_t i = 0; i < package.unwrap()->components().size(); i++) {
+    // component numbers are stored for all components of encoded package
+    std::size_t compNum = 0;
+    while (!reader.isEmpty()) {
         auto compName = deserializeString(&reader);
-        if (name.isErr()) {
+        if (compName.isErr()) {
             addReadStrErr("Error reading component name", compName.unwrapErr());
             return ProjectResult();
         }
@@ -642,7 +708,11 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
             addReadErr("Error reading component number");
             return ProjectResult();
         }
+        compNum++;
         auto mod = package.unwrap()->moduleWithName(compName.unwrap());
+        if (mod.isNone() && deviceNames.isSome()) {
+            continue;
+        }
         if (mod.isNone()) {
             addReadErr("Invalid component name reference");
             return ProjectResult();
@@ -653,12 +723,11 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
         }
         mod.unwrap()->component()->setNumber(num);
     }
-    package.unwrap()->sortComponentsByNumber();
-
-    if (reader.current() != reader.end()) {
-        addReadErr("Expected EOF");
+    if (deviceNames.isNone() && compNum != package.unwrap()->components().size()) {
+        addReadErr("Invalid component number");
         return ProjectResult();
     }
+    package.unwrap()->sortComponentsByNumber();
 
     Rc<Project> proj = new Project(cfg.get(), diag);
     proj->_master = devices[masterIndex];
@@ -670,86 +739,257 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
     return proj;
 }
 
-bmcl::Buffer Project::encode() const
+static std::string toSeconds(std::chrono::steady_clock::duration delta)
 {
-    bmcl::Buffer dest;
-    dest.write(magic.data(), magic.size());
+    double microseconds = std::chrono::duration_cast<std::chrono::microseconds>(delta).count();
+    return std::to_string(microseconds / 1000000) + "s";
+}
 
-    dest.writeUint8(_cfg->generatedCodeDebugLevel());
-    dest.writeUint8(_cfg->compressionLevel());
+bool Project::isPartial() const
+{
+    return _package->isPartial();
+}
+
+bool Project::encode(bmcl::Buffer* dest) const
+{
+    // skipped modules and components would be silently dropped from package and device table
+    if (isPartial()) {
+        addError("error encoding project", "project was decoded partially", _diag.get());
+        return false;
+    }
+
+    dest->write(magic.data(), magic.size());
 
-    dest.writeVarUint(_cfg->numOptions());
+    dest->writeUint8(_cfg->generatedCodeDebugLevel());
+    dest->writeUint8(_cfg->compressionLevel());
+
+    dest->writeVarUint(_cfg->numOptions());
     for (const auto& it : _cfg->optionsRange()) {
-        dest.writeVarUint(it.first.size());
-        dest.write(it.first.data(), it.first.size());
+        dest->writeVarUint(it.first.size());
+        dest->write(it.first.data(), it.first.size());
         if (it.second.isSome()) {
-            dest.writeUint8(1);
-            dest.writeVarUint(it.second->size());
-            dest.write(it.second->data(), it.second->size());
+            dest->writeUint8(1);
+            dest->writeVarUint(it.second->size());
+            dest->write(it.second->data(), it.second->size());
         } else {
-            dest.writeUint8(0);
+            dest->writeUint8(0);
         }
     }
 
-    dest.writeVarUint(_mccId);
-    serializeString(_name, &dest);
+    dest->writeVarUint(_mccId);
+    serializeString(_name, dest);
 
-    std::size_t sizeOffset = dest.size();
-    dest.writeUint32(0);
-    _package->encode(&dest);
+    std::size_t sizeOffset = dest->size();
+    dest->writeUint32(0);
+    _package->encode(dest);
 
-    std::size_t packageSize = dest.size() - sizeOffset - 4;
-    le32enc(dest.data() + sizeOffset, packageSize);
+    std::size_t packageSize = dest->size() - sizeOffset - 4;
+    le32enc(dest->data() + sizeOffset, packageSize);
 
-    dest.writeVarUint(_devices.size());
+    dest->writeVarUint(_devices.size());
 
     auto mt = std::find(_devices.begin(), _devices.end(), _master);
     assert(mt != _devices.end());
-    dest.writeVarUint(mt - _devices.begin());
+    dest->writeVarUint(mt - _devices.begin());
 
     for (const Rc<Device>& dev : _devices) {
-        dest.writeVarUint(dev->_id);
-        serializeString(dev->_name, &dest);
-        dest.writeVarUint(dev->_modules.size());
+        dest->writeVarUint(dev->_id);
+        serializeString(dev->_name, dest);
+        dest->writeVarUint(dev->_modules.size());
         for (const Rc<Ast>& module : dev->_modules) {
-            serializeString(module->moduleInfo()->moduleName(), &dest);
+            serializeString(module->moduleInfo()->moduleName(), dest);
         }
     }
 
     for (std::size_t i = 0; i < _devices.size(); i++) {
         const Rc<DeviceConnection>& conn = _connections[i];
-        dest.writeVarUint(i);
-        dest.writeVarUint(conn->_tmSources.size());
+        dest->writeVarUint(i);
+        dest->writeVarUint(conn->_tmSources.size());
         //TODO: refact
         for (const Rc<Device>& tmSrc : conn->_tmSources) {
             auto it = std::find(_devices.begin(), _devices.end(), tmSrc);
             assert(it != _devices.end());
-            dest.writeVarUint(it - _devices.begin());
+            dest->writeVarUint(it - _devices.begin());
         }
 
-        dest.writeVarUint(conn->_cmdTargets.size());
+        dest->writeVarUint(conn->_cmdTargets.size());
         for (const Rc<Device>& tmSrc : conn->_cmdTargets) {
             auto it = std::find(_devices.begin(), _devices.end(), tmSrc);
             assert(it != _devices.end());
-            dest.writeVarUint(it - _devices.begin());
+            dest->writeVarUint(it - _devices.begin());
         }
     }
 
     for (const Component* comp : _package->components()) {
-        serializeString(comp->name(), &dest);
-        dest.writeVarUint(comp->number());
+        serializeString(comp->name(), dest);
+        dest->writeVarUint(comp->number());
+    }
+    return true;
+}
+
+BufferResult Project::encode() const
+{
+    auto start = std::chrono::steady_clock::now();
+    bmcl::Buffer dest;
+    if (!encode(&dest)) {
+        return BufferResult();
     }
+    auto end = std::chrono::steady_clock::now();
 
-    //BMCL_DEBUG() << "uncompressed project size: " << dest.size();
+    ProgressPrinter printer(_cfg->verboseOutput());
+    printer.printActionProgress("Encoded", "project (" + std::to_string(dest.size()) + " bytes) in " + toSeconds(end - start));
+    return compress(dest);
+}
 
-    ZpaqResult compressed = zpaqCompress(dest.data(), dest.size(), _cfg->compressionLevel());
+bmcl::Buffer Project::compress(bmcl::Bytes encoded) const
+{
+    auto start = std::chrono::steady_clock::now();
+    CompressionResult compressed = compressData(_cfg->compressionCodec(), encoded.data(), encoded.size(), _cfg->compressionLevel(), _cfg->numJobs());
     assert(compressed.isOk());
+    auto end = std::chrono::steady_clock::now();
 
-    //BMCL_DEBUG() << "compressed project size: " << compressed.unwrap().size();
+    ProgressPrinter printer(_cfg->verboseOutput());
+    std::string method = compressionCodecName(_cfg->compressionCodec());
+    if (_cfg->compressionCodec() == CompressionCodec::Zpaq) {
+        method += " level " + std::to_string(_cfg->compressionLevel());
+    }
+    printer.printActionProgress("Compressed", "project with " + method
+                                + " (" + std::to_string(compressed.unwrap().size()) + " bytes) in " + toSeconds(end - start));
 
     return compressed.take();
 }
 
+// incremented on every change of compressed output for same settings
+constexpr std::uint8_t compressionKeyVersion = 1;
+
+std::array<std::uint8_t, 512 / 8> Project::compressionKey(bmcl::Bytes encoded) const
+{
+    std::array<std::uint8_t, 3> settings = {{compressionKeyVersion, (std::uint8_t)_cfg->compressionCodec(), (std::uint8_t)_cfg->compressionLevel()}};
+    HashType ctx;
+    ctx.update(encoded);
+    ctx.update(bmcl::Bytes(settings.data(), settings.size()));
+    return ctx.finalize();
+}
+
+const MagicType deltaMagic = {{0x7a, 0x70, 0x64, 0x6c}};
+constexpr std::uint64_t deltaVersion = 2;
+
+BufferResult Project::encodeDelta(bmcl::Bytes basePackage, bmcl::Bytes package) const
+{
+    CompressionResult base = decompressData(basePackage.data(), basePackage.size(), _cfg->numJobs());
+    if (base.isErr()) {
+        addError("error decompressing base package", base.unwrapErr(), _diag.get());
+        return BufferResult();
+    }
+    // result is compressed again on apply, settings must match ones used for package
+    CompressionCodec codec;
+    CompressionResult target = decompressData(package.data(), package.size(), _cfg->numJobs(), &codec);
+    if (target.isErr()) {
+        addError("error decompressing package", target.unwrapErr(), _diag.get());
+        return BufferResult();
+    }
+
+    bmcl::Buffer ops = deltaEncode(base.unwrap(), target.unwrap());
+    DeltaResult check = deltaApply(base.unwrap(), ops);
+    if (check.isErr() || check.unwrap().size() != target.unwrap().size()
+        || std::memcmp(check.unwrap().data(), target.unwrap().data(), target.unwrap().size()) != 0) {
+        addError("error encoding package delta", "delta does not reproduce package", _diag.get());
+        return BufferResult();
+    }
+    CompressionResult compressedOps = compressData(_cfg->compressionCodec(), ops.data(), ops.size(), _cfg->compressionLevel(), _cfg->numJobs());
+    if (compressedOps.isErr()) {
+        addError("error compressing package delta", compressedOps.unwrapErr(), _diag.get());
+        return BufferResult();
+    }
+
+    auto baseHash = hash(basePackage);
+    auto targetHash = hash(package);
+    bmcl::Buffer dest;
+    dest.write(deltaMagic.data(), deltaMagic.size());
+    dest.writeVarUint(deltaVersion);
+    dest.write(baseHash.data(), baseHash.size());
+    dest.write(targetHash.data(), targetHash.size());
+    dest.writeUint8((std::uint8_t)codec);
+    dest.writeUint8(_cfg->compressionLevel());
+    dest.write(compressedOps.unwrap().data(), compressedOps.unwrap().size());
+    return std::move(dest);
+}
+
+BufferResult Project::applyDelta(Diagnostics* diag, bmcl::Bytes basePackage, bmcl::Bytes delta)
+{
+    auto addReadErr = [diag](bmcl::StringView cause) {
+        addError("error applying package delta", cause, diag);
+    };
+
+    bmcl::MemReader reader(delta.data(), delta.size());
+    std::array<std::uint8_t, 512 / 8> baseHash;
+    std::array<std::uint8_t, 512 / 8> targetHash;
+    MagicType m;
+    if (reader.readableSize() < m.size()) {
+        addReadErr("Unexpected EOF reading magic");
+        return BufferResult();
+    }
+    reader.read(m.data(), m.size());
+    if (m != deltaMagic) {
+        addReadErr("Invalid magic");
+        return BufferResult();
+    }
+    std::uint64_t version;
+    if (!reader.readVarUint(&version)) {
+        addReadErr("Error reading delta version");
+        return BufferResult();
+    }
+    if (version != deltaVersion) {
+        addReadErr("Unsupported delta version " + std::to_string(version));
+        return BufferResult();
+    }
+    if (reader.readableSize() < baseHash.size() + targetHash.size() + 2) {
+        addReadErr("Unexpected EOF reading delta header");
+        return BufferResult();
+    }
+    reader.read(baseHash.data(), baseHash.size());
+    reader.read(targetHash.data(), targetHash.size());
+    std::uint8_t codec = reader.readUint8();
+    std::uint8_t level = reader.readUint8();
+    if (codec > (std::uint8_t)CompressionCodec::Zpaq) {
+        addReadErr("Unknown compression codec " + std::to_string(codec));
+        return BufferResult();
+    }
+
+    if (hash(basePackage) != baseHash) {
+        addReadErr("Delta was made for another base package");
+        return BufferResult();
+    }
+
+    std::size_t numJobs = std::max(1u, std::thread::hardware_concurrency());
+    CompressionResult base = decompressData(basePackage.data(), basePackage.size(), numJobs);
+    if (base.isErr()) {
+        addError("error decompressing base package", base.unwrapErr(), diag);
+        return BufferResult();
+    }
+    CompressionResult ops = decompressData(reader.current(), reader.readableSize(), numJobs);
+    if (ops.isErr()) {
+        addError("error decompressing package delta", ops.unwrapErr(), diag);
+        return BufferResult();
+    }
+    DeltaResult target = deltaApply(base.unwrap(), ops.unwrap());
+    if (target.isErr()) {
+        addReadErr(target.unwrapErr());
+        return BufferResult();
+    }
+
+    CompressionResult package = compressData((CompressionCodec)codec, target.unwrap().data(), target.unwrap().size(), level, numJobs);
+    if (package.isErr()) {
+        addError("error compressing package", package.unwrapErr(), diag);
+        return BufferResult();
+    }
+    if (hash(package.unwrap()) != targetHash) {
+        addReadErr("Result does not match package hash");
+        return BufferResult();
+    }
+    return package.take();
+}
+
 DeviceVec::ConstIterator Project::devicesBegin() const
 {
     return _devices.begin();
@@ -31,6 +31,7 @@ class Device;
 struct GeneratorConfig;
 
 using ProjectResult = bmcl::Result<Rc<Project>, void>;
+using BufferResult = bmcl::Result<bmcl::Buffer, void>;
 
 using DeviceVec = RcVec<Device>;
 
@@ -89,6 +90,9 @@ public:
 
     static ProjectResult fromFile(Configuration* cfg, Diagnostics* diag, const char* projectFilePath);
     static ProjectResult decodeFromMemory(Diagnostics* diag, const void* src, std::size_t size);
+    // decodes only modules of listed devices and modules they import if package is indexed
+    // other devices keep modules shared with listed ones
+    static ProjectResult decodeDevicesFromMemory(Diagnostics* diag, const void* src, std::size_t size, bmcl::ArrayView<std::string> deviceNames);
     ~Project();
 
     static std::array<std::uint8_t, 512 / 8> hash(bmcl::Bytes data);
@@ -104,8 +108,22 @@ public:
     DeviceVec::ConstRange devices() const;
     RcVec<DeviceConnection>::ConstRange deviceConnections() const;
 
-    bmcl::Buffer encode() const;
-    void encode(bmcl::Buffer* dest) const;
+    // true if only some devices were decoded from indexed package, such projects can't be encoded
+    bool isPartial() const;
+
+    // compressed with configured codec
+    BufferResult encode() const;
+    // without compression
+    bool encode(bmcl::Buffer* dest) const;
+    // compresses output of encode(dest) with configured codec
+    bmcl::Buffer compress(bmcl::Bytes encoded) const;
+    // hash of output of encode(dest) and compression settings, equal keys give equal compress() results
+    std::array<std::uint8_t, 512 / 8> compressionKey(bmcl::Bytes encoded) const;
+    // delta that turns basePackage into package, both are encode() results
+    // delta is compressed with configured codec
+    BufferResult encodeDelta(bmcl::Bytes basePackage, bmcl::Bytes package) const;
+    // returns package that delta was made for, basePackage and result are checked against hashes stored in delta
+    static BufferResult applyDelta(Diagnostics* diag, bmcl::Bytes basePackage, bmcl::Bytes delta);
     bmcl::Option<const SourcesToCopy&> sourcesForModule(const Ast* module) const;
     bmcl::OptionPtr<const Device> deviceWithName(bmcl::StringView name) const;
     bmcl::OptionPtr<Device> deviceWithName(bmcl::StringView name);
@@ -113,6 +131,8 @@ public:
 private:
     Project(Configuration* cfg, Diagnostics* diag);
 
+    static ProjectResult decode(Diagnostics* diag, const void* src, std::size_t size, bmcl::Option<bmcl::ArrayView<std::string>> deviceNames);
+
     Rc<Configuration> _cfg;
     Rc<Diagnostics> _diag;
     Rc<Package> _package;
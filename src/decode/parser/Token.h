@@ -9,15 +9,16 @@
 #pragma once
 
 #include "decode/Config.h"
-#include "decode/core/Location.h"
+#include "decode/core/Symbol.h"
 
 #include <bmcl/StringView.h>
 
 #include <cstddef>
+#include <cstdint>
 
 namespace decode {
 
-enum class TokenKind {
+enum class TokenKind : std::uint8_t {
     Invalid = 0,
     DocComment,
 //   RawComment,
@@ -73,42 +74,34 @@ enum class TokenKind {
 
 class Token {
 public:
-    Token(TokenKind kind, const char* start, const char* end, std::size_t line, std::size_t column)
-        : _kind(kind)
-        , _value(start, end)
-        , _loc(line, column)
+    Token(TokenKind kind, const char* start, std::uint32_t size, Symbol symbol = Symbol())
+        : _begin(start)
+        , _size(size)
+        , _symbol(symbol)
+        , _kind(kind)
     {
     }
 
     Token()
-        : _kind(TokenKind::Invalid)
-        , _loc(0, 0)
+        : _begin(nullptr)
+        , _size(0)
+        , _kind(TokenKind::Invalid)
     {
     }
 
     const char* begin() const
     {
-        return _value.begin();
+        return _begin;
     }
 
     const char* end() const
     {
-        return _value.end();
+        return _begin + _size;
     }
 
-    std::size_t line() const
+    std::size_t size() const
     {
-        return _loc.line;
-    }
-
-    std::size_t column() const
-    {
-        return _loc.column;
-    }
-
-    const Location& location() const
-    {
-        return _loc;
+        return _size;
     }
 
     TokenKind kind() const
@@ -118,12 +111,19 @@ public:
 
     bmcl::StringView value() const
     {
-        return _value;
+        return bmcl::StringView(_begin, _size);
+    }
+
+    // valid only for identifiers lexed with a symbol table
+    Symbol symbol() const
+    {
+        return _symbol;
     }
 
 private:
+    const char* _begin;
+    std::uint32_t _size;
+    Symbol _symbol;
     TokenKind _kind;
-    bmcl::StringView _value;
-    Location _loc;
 };
 }
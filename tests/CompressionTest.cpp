@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Compression.h"
+#include "decode/core/Lz.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace decode;
+
+using Data = std::vector<std::uint8_t>;
+
+static Data randomData(std::size_t size, std::uint32_t seed)
+{
+    Data data(size);
+    std::uint32_t state = seed;
+    for (std::uint8_t& byte : data) {
+        state = state * 1664525 + 1013904223;
+        byte = state >> 24;
+    }
+    return data;
+}
+
+static Data textData(std::size_t size)
+{
+    const char* line = "struct Point { x: u32, y: u32, z: &[u8; 16] }\n";
+    Data data;
+    while (data.size() < size) {
+        data.insert(data.end(), line, line + std::strlen(line));
+    }
+    data.resize(size);
+    return data;
+}
+
+static Data asData(bmcl::Bytes bytes)
+{
+    return Data(bytes.begin(), bytes.end());
+}
+
+static std::vector<Data> testInputs()
+{
+    std::vector<Data> inputs;
+    inputs.push_back(Data());
+    inputs.push_back(Data(1, 'a'));
+    inputs.push_back(Data(5, 'a'));
+    inputs.push_back(randomData(3, 1));
+    inputs.push_back(randomData(100 * 1024, 2));
+    inputs.push_back(Data(1024 * 1024, 0));
+    inputs.push_back(textData(200 * 1024));
+    Data mixed = randomData(10000, 3);
+    Data text = textData(10000);
+    mixed.insert(mixed.end(), text.begin(), text.end());
+    mixed.insert(mixed.end(), mixed.begin(), mixed.begin() + 5000);
+    inputs.push_back(mixed);
+    return inputs;
+}
+
+static bmcl::Buffer compress(CompressionCodec codec, const Data& data)
+{
+    CompressionResult rv = compressData(codec, data.data(), data.size(), 1);
+    EXPECT_TRUE(rv.isOk());
+    if (rv.isErr()) {
+        return bmcl::Buffer();
+    }
+    return rv.take();
+}
+
+// header is magic, codec and varuint decompressed size
+static bmcl::Bytes payloadOf(const bmcl::Buffer& compressed)
+{
+    bmcl::MemReader reader(compressed.data(), compressed.size());
+    reader.skip(5);
+    std::uint64_t size;
+    EXPECT_TRUE(reader.readVarUint(&size));
+    return bmcl::Bytes(reader.current(), reader.readableSize());
+}
+
+static bmcl::Buffer withHeader(std::uint8_t codec, std::uint64_t size, bmcl::Bytes payload)
+{
+    bmcl::Buffer dest;
+    dest.write("dcmp", 4);
+    dest.writeUint8(codec);
+    dest.writeVarUint(size);
+    dest.write(payload.data(), payload.size());
+    return dest;
+}
+
+static const CompressionCodec codecs[] = {CompressionCodec::Stored, CompressionCodec::Fast, CompressionCodec::Zpaq};
+
+TEST(Compression, roundTrip)
+{
+    for (CompressionCodec codec : codecs) {
+        for (const Data& input : testInputs()) {
+            bmcl::Buffer compressed = compress(codec, input);
+            CompressionCodec usedCodec = CompressionCodec::Stored;
+            CompressionResult decompressed = decompressData(compressed.data(), compressed.size(), 4, &usedCodec);
+            ASSERT_TRUE(decompressed.isOk()) << compressionCodecName(codec) << " size " << input.size();
+            EXPECT_EQ(input, asData(decompressed.unwrap())) << compressionCodecName(codec);
+            EXPECT_EQ(codec, usedCodec);
+        }
+    }
+}
+
+TEST(Compression, zpaqBlocksRoundTrip)
+{
+    // several independently compressed blocks
+    Data input = textData(3 * 1024 * 1024 + 100);
+    CompressionResult compressed = compressData(CompressionCodec::Zpaq, input.data(), input.size(), 1, 4);
+    ASSERT_TRUE(compressed.isOk());
+    CompressionResult decompressed = decompressData(compressed.unwrap().data(), compressed.unwrap().size(), 4);
+    ASSERT_TRUE(decompressed.isOk());
+    EXPECT_EQ(input, asData(decompressed.unwrap()));
+}
+
+TEST(Compression, repetitiveInputIsCompressed)
+{
+    Data input(1024 * 1024, 'x');
+    EXPECT_LT(compress(CompressionCodec::Fast, input).size(), input.size() / 100);
+    EXPECT_LT(compress(CompressionCodec::Zpaq, input).size(), input.size() / 100);
+}
+
+TEST(Compression, declaredSizeMismatchIsRejected)
+{
+    Data input = textData(10000);
+    for (CompressionCodec codec : codecs) {
+        bmcl::Buffer compressed = compress(codec, input);
+        bmcl::Bytes payload = payloadOf(compressed);
+        for (std::uint64_t size : {std::uint64_t(0), std::uint64_t(input.size() - 1), std::uint64_t(input.size() + 1), std::uint64_t(1) << 40}) {
+            bmcl::Buffer modified = withHeader((std::uint8_t)codec, size, payload);
+            EXPECT_TRUE(decompressData(modified.data(), modified.size()).isErr()) << compressionCodecName(codec) << " size " << size;
+        }
+    }
+}
+
+TEST(Compression, badMagicIsRejected)
+{
+    Data input = textData(10000);
+    for (CompressionCodec codec : {CompressionCodec::Stored, CompressionCodec::Fast}) {
+        bmcl::Buffer compressed = compress(codec, input);
+        for (std::size_t i = 0; i < 4; i++) {
+            Data modified = asData(compressed);
+            modified[i] ^= 0x20;
+            // data without magic is decompressed as zpaq archive
+            EXPECT_TRUE(decompressData(modified.data(), modified.size()).isErr()) << compressionCodecName(codec) << " byte " << i;
+        }
+    }
+    EXPECT_TRUE(decompressData(nullptr, 0).isErr());
+    EXPECT_TRUE(decompressData("dcm", 3).isErr());
+}
+
+TEST(Compression, unknownCodecIsRejected)
+{
+    Data input = textData(1000);
+    for (std::uint8_t codec : {3, 4, 127, 255}) {
+        bmcl::Buffer modified = withHeader(codec, input.size(), bmcl::Bytes(input.data(), input.size()));
+        EXPECT_TRUE(decompressData(modified.data(), modified.size()).isErr()) << "codec " << (int)codec;
+    }
+}
+
+TEST(Compression, truncatedDataIsRejected)
+{
+    Data input = textData(3000);
+    for (CompressionCodec codec : {CompressionCodec::Stored, CompressionCodec::Fast}) {
+        bmcl::Buffer compressed = compress(codec, input);
+        for (std::size_t size = 0; size < compressed.size(); size++) {
+            EXPECT_TRUE(decompressData(compressed.data(), size).isErr()) << compressionCodecName(codec) << " size " << size;
+        }
+    }
+}
+
+static LzResult lzRoundTrip(const Data& input)
+{
+    bmcl::Buffer compressed = lzCompress(input.data(), input.size());
+    return lzDecompress(compressed.data(), compressed.size(), input.size());
+}
+
+TEST(Lz, roundTripShortInputs)
+{
+    // lengths around minimal match, token nibble limit and tail handling
+    for (std::size_t size = 0; size < 300; size++) {
+        Data random = randomData(size, size);
+        Data text = textData(size);
+        Data same(size, 7);
+        for (const Data* input : {&random, &text, &same}) {
+            LzResult rv = lzRoundTrip(*input);
+            ASSERT_TRUE(rv.isOk()) << "size " << size;
+            EXPECT_EQ(*input, asData(rv.unwrap())) << "size " << size;
+        }
+    }
+}
+
+TEST(Lz, roundTripLongLengths)
+{
+    // literal and match lengths continued in several bytes
+    Data input = randomData(5000, 4);
+    input.insert(input.end(), 100000, 'z');
+    Data tail = randomData(700, 5);
+    input.insert(input.end(), tail.begin(), tail.end());
+    // match at maximal distance
+    Data distant(input.end() - 65535, input.end() - 65535 + 100);
+    input.insert(input.end(), distant.begin(), distant.end());
+    LzResult rv = lzRoundTrip(input);
+    ASSERT_TRUE(rv.isOk());
+    EXPECT_EQ(input, asData(rv.unwrap()));
+}
+
+TEST(Lz, truncatedStreamIsRejected)
+{
+    Data input = randomData(3000, 6);
+    Data text = textData(3000);
+    input.insert(input.end(), text.begin(), text.end());
+    bmcl::Buffer compressed = lzCompress(input.data(), input.size());
+    for (std::size_t size = 0; size < compressed.size(); size++) {
+        EXPECT_TRUE(lzDecompress(compressed.data(), size, input.size()).isErr()) << "size " << size;
+    }
+}
+
+TEST(Lz, corruptedStreamDoesNotReadOutOfBounds)
+{
+    Data input = textData(2000);
+    Data random = randomData(500, 7);
+    input.insert(input.begin() + 1000, random.begin(), random.end());
+    bmcl::Buffer compressed = lzCompress(input.data(), input.size());
+    for (std::size_t i = 0; i < compressed.size(); i++) {
+        for (std::uint8_t mask : {0x01, 0x0f, 0x10, 0xf0, 0xff}) {
+            Data corrupted = asData(compressed);
+            corrupted[i] ^= mask;
+            LzResult rv = lzDecompress(corrupted.data(), corrupted.size(), input.size());
+            if (rv.isOk()) {
+                EXPECT_EQ(input.size(), rv.unwrap().size());
+            }
+        }
+    }
+}
+
+static LzResult lzDecompressData(const Data& data, std::size_t decompressedSize)
+{
+    return lzDecompress(data.data(), data.size(), decompressedSize);
+}
+
+TEST(Lz, matchBeforeOutputStartIsRejected)
+{
+    // token with one literal and minimal match, followed by literal and 16 bit offset
+    EXPECT_TRUE(lzDecompressData(Data{0x10, 'a', 0x02, 0x00}, 5).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0x10, 'a', 0x00, 0x00}, 5).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0x10, 'a', 0xff, 0xff}, 5).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0x00, 0x01, 0x00}, 4).isErr());
+
+    // overlapping match
+    LzResult rv = lzDecompressData(Data{0x10, 'a', 0x01, 0x00}, 5);
+    ASSERT_TRUE(rv.isOk());
+    EXPECT_EQ(Data(5, 'a'), asData(rv.unwrap()));
+}
+
+TEST(Lz, invalidLengthsAreRejected)
+{
+    EXPECT_TRUE(lzDecompressData(Data{0xf0}, 100).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0xf0, 0xff}, 1000).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0x30, 'a', 'b'}, 3).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0x1f, 'a', 0x01, 0x00}, 100).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0x11, 'a', 0x01}, 6).isErr());
+}
+
+TEST(Lz, decompressedSizeMismatchIsRejected)
+{
+    Data input = textData(5000);
+    bmcl::Buffer compressed = lzCompress(input.data(), input.size());
+    EXPECT_TRUE(lzDecompress(compressed.data(), compressed.size(), 0).isErr());
+    EXPECT_TRUE(lzDecompress(compressed.data(), compressed.size(), input.size() - 1).isErr());
+    EXPECT_TRUE(lzDecompress(compressed.data(), compressed.size(), input.size() + 1).isErr());
+    EXPECT_TRUE(lzDecompress(compressed.data(), compressed.size(), SIZE_MAX).isErr());
+
+    // literals and matches beyond declared size
+    EXPECT_TRUE(lzDecompressData(Data{0x30, 'a', 'b', 'c'}, 2).isErr());
+    EXPECT_TRUE(lzDecompressData(Data{0x10, 'a', 0x01, 0x00}, 4).isErr());
+}
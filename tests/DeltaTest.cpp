@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Delta.h"
+#include "decode/core/Configuration.h"
+#include "decode/core/Diagnostics.h"
+#include "decode/core/PathUtils.h"
+#include "decode/core/Utils.h"
+#include "decode/parser/Project.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/Result.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+# include <unistd.h>
+#elif defined(_MSC_VER) || defined(__MINGW32__)
+# include <windows.h>
+#endif
+
+using namespace decode;
+
+using Data = std::vector<std::uint8_t>;
+
+static Data randomData(std::size_t size, std::uint32_t seed)
+{
+    Data data(size);
+    std::uint32_t state = seed;
+    for (std::uint8_t& byte : data) {
+        state = state * 1664525 + 1013904223;
+        byte = state >> 24;
+    }
+    return data;
+}
+
+static bmcl::Bytes asBytes(const Data& data)
+{
+    return bmcl::Bytes(data.data(), data.size());
+}
+
+static Data asData(bmcl::Bytes bytes)
+{
+    return Data(bytes.begin(), bytes.end());
+}
+
+static bmcl::Buffer expectRoundTrip(const Data& base, const Data& target)
+{
+    bmcl::Buffer delta = deltaEncode(asBytes(base), asBytes(target));
+    DeltaResult applied = deltaApply(asBytes(base), delta);
+    EXPECT_TRUE(applied.isOk());
+    if (applied.isOk()) {
+        EXPECT_EQ(target, asData(applied.unwrap()));
+    }
+    return delta;
+}
+
+TEST(Delta, editedTarget)
+{
+    Data base = randomData(64 * 1024, 1);
+    Data target = base;
+    target.erase(target.begin() + 1000, target.begin() + 1500);
+    Data inserted = randomData(300, 2);
+    target.insert(target.begin() + 20000, inserted.begin(), inserted.end());
+    target[40000] ^= 0xff;
+    // moved block is copied with negative offset
+    target.insert(target.end(), base.begin() + 100, base.begin() + 4100);
+
+    bmcl::Buffer delta = expectRoundTrip(base, target);
+    EXPECT_LT(delta.size(), 1024u);
+}
+
+TEST(Delta, identicalTarget)
+{
+    Data base = randomData(64 * 1024, 3);
+    bmcl::Buffer delta = expectRoundTrip(base, base);
+    EXPECT_LT(delta.size(), 32u);
+}
+
+TEST(Delta, emptyInputs)
+{
+    Data data = randomData(1000, 4);
+    expectRoundTrip(Data(), Data());
+    expectRoundTrip(Data(), data);
+    expectRoundTrip(data, Data());
+}
+
+TEST(Delta, shortInputs)
+{
+    // shorter than minimal copied run
+    Data base = randomData(10, 5);
+    Data target = base;
+    target.push_back(1);
+    expectRoundTrip(base, target);
+    expectRoundTrip(target, base);
+}
+
+TEST(Delta, fullyRewrittenTarget)
+{
+    Data base = randomData(16 * 1024, 6);
+    Data target = randomData(20 * 1024, 7);
+    bmcl::Buffer delta = expectRoundTrip(base, target);
+    EXPECT_GE(delta.size(), target.size());
+}
+
+TEST(Delta, truncatedDeltaIsRejected)
+{
+    Data base = randomData(8 * 1024, 8);
+    Data target = base;
+    target.erase(target.begin() + 100, target.begin() + 200);
+    Data inserted = randomData(50, 9);
+    target.insert(target.begin() + 4000, inserted.begin(), inserted.end());
+
+    bmcl::Buffer delta = expectRoundTrip(base, target);
+    for (std::size_t size = 0; size < delta.size(); size++) {
+        EXPECT_TRUE(deltaApply(asBytes(base), bmcl::Bytes(delta.data(), size)).isErr()) << "size " << size;
+    }
+}
+
+TEST(Delta, copyOutOfBaseIsRejected)
+{
+    Data base = randomData(1000, 10);
+    std::vector<std::int64_t> offsets = {-1, 985, 1000, std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min()};
+    for (std::int64_t offset : offsets) {
+        bmcl::Buffer delta;
+        delta.writeVarUint(16);
+        delta.writeVarUint((16 << 1) | 1);
+        delta.writeVarInt(offset);
+        EXPECT_TRUE(deltaApply(asBytes(base), delta).isErr()) << "offset " << offset;
+    }
+
+    // second copy overflows when added to end of first one
+    bmcl::Buffer delta;
+    delta.writeVarUint(32);
+    delta.writeVarUint((16 << 1) | 1);
+    delta.writeVarInt(500);
+    delta.writeVarUint((16 << 1) | 1);
+    delta.writeVarInt(std::numeric_limits<std::int64_t>::max());
+    EXPECT_TRUE(deltaApply(asBytes(base), delta).isErr());
+}
+
+TEST(Delta, sizeMismatchIsRejected)
+{
+    Data base = randomData(1000, 11);
+
+    bmcl::Buffer hugeCopy;
+    hugeCopy.writeVarUint(16);
+    hugeCopy.writeVarUint(std::numeric_limits<std::uint64_t>::max());
+    hugeCopy.writeVarInt(0);
+    EXPECT_TRUE(deltaApply(asBytes(base), hugeCopy).isErr());
+
+    bmcl::Buffer longInsert;
+    longInsert.writeVarUint(2);
+    longInsert.writeVarUint(3 << 1);
+    longInsert.write("abc", 3);
+    EXPECT_TRUE(deltaApply(asBytes(base), longInsert).isErr());
+
+    bmcl::Buffer shortInsert;
+    shortInsert.writeVarUint(4);
+    shortInsert.writeVarUint(3 << 1);
+    shortInsert.write("abc", 3);
+    EXPECT_TRUE(deltaApply(asBytes(base), shortInsert).isErr());
+}
+
+TEST(Delta, corruptedDeltaDoesNotReadOutOfBounds)
+{
+    Data base = randomData(8 * 1024, 12);
+    Data target = base;
+    target.erase(target.begin() + 3000, target.begin() + 3100);
+    bmcl::Buffer delta = expectRoundTrip(base, target);
+
+    for (std::size_t i = 0; i < delta.size(); i++) {
+        for (std::uint8_t mask : {0x01, 0x40, 0xff}) {
+            Data corrupted(delta.data(), delta.data() + delta.size());
+            corrupted[i] ^= mask;
+            DeltaResult applied = deltaApply(asBytes(base), asBytes(corrupted));
+            if (applied.isOk()) {
+                // changed inserted bytes or copy offsets can't be detected without package hashes
+                EXPECT_EQ(target.size(), applied.unwrap().size());
+            }
+        }
+    }
+}
+
+static const char* projectToml = R"([project]
+name = "delta"
+master = "dev"
+mcc_id = 0
+module_dirs = ["mod"]
+
+[[devices]]
+name = "dev"
+id = 1
+modules = ["test"]
+)";
+
+static const char* moduleToml = R"(id = 0
+name = "test"
+dest = "test"
+decode = "test.decode"
+)";
+
+static const char* baseModule = R"(module test
+
+struct A {
+    a: u8,
+    b: [u16; 4],
+}
+)";
+
+static const char* targetModule = R"(module test
+
+struct A {
+    a: u8,
+    b: [u16; 4],
+    c: u64,
+}
+
+struct B {
+    a: &[A; 2],
+}
+)";
+
+static bool makeTempDirectory(std::string* dest)
+{
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+    const char* tmp = std::getenv("TMPDIR");
+    std::string path = joinPath(tmp ? tmp : "/tmp", "decode_delta_XXXXXX");
+    if (!mkdtemp(&path[0])) {
+        return false;
+    }
+    *dest = path;
+    return true;
+#elif defined(_MSC_VER) || defined(__MINGW32__)
+    char tmp[MAX_PATH + 1];
+    DWORD size = GetTempPathA(sizeof(tmp), tmp);
+    if (size == 0 || size > MAX_PATH) {
+        return false;
+    }
+    std::string prefix = "decode_delta_" + std::to_string(GetCurrentProcessId()) + "_";
+    for (unsigned i = 0; i < 1000; i++) {
+        std::string path = joinPath(bmcl::StringView(tmp, size), prefix + std::to_string(i));
+        if (CreateDirectoryA(path.c_str(), NULL)) {
+            *dest = path;
+            return true;
+        }
+        if (GetLastError() != ERROR_ALREADY_EXISTS) {
+            return false;
+        }
+    }
+    return false;
+#endif
+}
+
+static void removeDirectory(const std::string& path)
+{
+#if defined(__linux__) || defined(BMCL_PLATFORM_APPLE)
+    rmdir(path.c_str());
+#elif defined(_MSC_VER) || defined(__MINGW32__)
+    RemoveDirectoryA(path.c_str());
+#endif
+}
+
+// every test gets its own temporary directory, created paths are removed in reverse order after test
+class ProjectDelta : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        diag = new Diagnostics;
+        ASSERT_TRUE(makeTempDirectory(&tempDir));
+        createdDirs.push_back(tempDir);
+        base = encodeProject("base", baseModule);
+        target = encodeProject("target", targetModule);
+        ASSERT_FALSE(base.isEmpty());
+        ASSERT_FALSE(target.isEmpty());
+
+        Rc<Configuration> cfg = new Configuration;
+        ProjectResult project = Project::fromFile(cfg.get(), diag.get(), joinPath(joinPath(tempDir, "target"), "project.toml").c_str());
+        ASSERT_TRUE(project.isOk());
+        BufferResult rv = project.unwrap()->encodeDelta(base, target);
+        ASSERT_TRUE(rv.isOk());
+        delta = rv.take();
+        ASSERT_FALSE(diag->hasReports());
+    }
+
+    // projects are destroyed at this point, so none of the files are mapped
+    void TearDown() override
+    {
+        for (auto it = createdFiles.rbegin(); it != createdFiles.rend(); it++) {
+            EXPECT_EQ(0, std::remove(it->c_str())) << *it;
+        }
+        for (auto it = createdDirs.rbegin(); it != createdDirs.rend(); it++) {
+            removeDirectory(*it);
+        }
+    }
+
+    void makeDir(const std::string& path)
+    {
+        EXPECT_TRUE(makeDirectory(path, diag.get()));
+        createdDirs.push_back(path);
+    }
+
+    void writeFile(const std::string& path, const char* contents)
+    {
+        EXPECT_TRUE(saveOutput(path, bmcl::StringView(contents), diag.get()));
+        createdFiles.push_back(path);
+    }
+
+    // projects are written to separate directories, files of loaded projects may be mapped into memory
+    bmcl::Buffer encodeProject(const char* name, const char* module)
+    {
+        std::string projectDir = joinPath(tempDir, name);
+        std::string modDir = joinPath(projectDir, "mod");
+        std::string projectPath = joinPath(projectDir, "project.toml");
+        makeDir(projectDir);
+        makeDir(modDir);
+        writeFile(projectPath, projectToml);
+        writeFile(joinPath(modDir, "mod.toml"), moduleToml);
+        writeFile(joinPath(modDir, "test.decode"), module);
+
+        Rc<Configuration> cfg = new Configuration;
+        ProjectResult project = Project::fromFile(cfg.get(), diag.get(), projectPath.c_str());
+        EXPECT_TRUE(project.isOk());
+        if (project.isErr()) {
+            return bmcl::Buffer();
+        }
+        BufferResult encoded = project.unwrap()->encode();
+        EXPECT_TRUE(encoded.isOk());
+        if (encoded.isErr()) {
+            return bmcl::Buffer();
+        }
+        return encoded.take();
+    }
+
+    Rc<Diagnostics> diag;
+    std::string tempDir;
+    std::vector<std::string> createdDirs;
+    std::vector<std::string> createdFiles;
+    bmcl::Buffer base;
+    bmcl::Buffer target;
+    bmcl::Buffer delta;
+};
+
+TEST_F(ProjectDelta, appliedDeltaGivesPackage)
+{
+    BufferResult applied = Project::applyDelta(diag.get(), base, delta);
+    ASSERT_TRUE(applied.isOk());
+    EXPECT_EQ(asData(target), asData(applied.unwrap()));
+    EXPECT_FALSE(diag->hasReports());
+}
+
+TEST_F(ProjectDelta, baseHashMismatchIsRejected)
+{
+    EXPECT_TRUE(Project::applyDelta(diag.get(), target, delta).isErr());
+    EXPECT_TRUE(diag->hasReports());
+
+    Data modifiedBase = asData(base);
+    modifiedBase.back() ^= 1;
+    EXPECT_TRUE(Project::applyDelta(diag.get(), asBytes(modifiedBase), delta).isErr());
+}
+
+TEST_F(ProjectDelta, targetHashMismatchIsRejected)
+{
+    // magic, one byte version and base hash are followed by target hash
+    Data corrupted = asData(delta);
+    corrupted[4 + 1 + 64] ^= 1;
+    EXPECT_TRUE(Project::applyDelta(diag.get(), base, asBytes(corrupted)).isErr());
+    EXPECT_TRUE(diag->hasReports());
+}
+
+TEST_F(ProjectDelta, corruptedDeltaIsRejected)
+{
+    // codec and level bytes are informational, so only result is checked
+    std::size_t numRejected = 0;
+    for (std::size_t i = 0; i < delta.size(); i++) {
+        Data corrupted = asData(delta);
+        corrupted[i] ^= 0x10;
+        BufferResult applied = Project::applyDelta(diag.get(), base, asBytes(corrupted));
+        if (applied.isOk()) {
+            EXPECT_EQ(asData(target), asData(applied.unwrap())) << "byte " << i;
+        } else {
+            numRejected++;
+        }
+    }
+    EXPECT_GE(numRejected, delta.size() - 2);
+}
+
+TEST_F(ProjectDelta, truncatedDeltaIsRejected)
+{
+    for (std::size_t size = 0; size < delta.size(); size++) {
+        EXPECT_TRUE(Project::applyDelta(diag.get(), base, bmcl::Bytes(delta.data(), size)).isErr()) << "size " << size;
+    }
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/parser/Lexer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace decode;
+
+// tokens are compared as "kind offset size" strings so that gtest prints readable mismatches
+static std::vector<std::string> lex(bmcl::StringView data, LexerBackend backend)
+{
+    Rc<Lexer> lexer = new Lexer(data, backend);
+    std::vector<std::string> tokens;
+    Token tok;
+    // every token except last one consumes at least one char
+    for (std::size_t i = 0; i <= data.size(); i++) {
+        lexer->consumeNextToken(&tok);
+        tokens.push_back(std::to_string((int)tok.kind()) + " " + std::to_string(tok.begin() - data.begin()) + " " + std::to_string(tok.size()));
+        if (tok.kind() == TokenKind::Eof || tok.kind() == TokenKind::Invalid) {
+            break;
+        }
+    }
+    return tokens;
+}
+
+static void expectSameTokens(const std::string& data)
+{
+    std::vector<std::string> scanned = lex(data, LexerBackend::Scanner);
+    std::vector<std::string> parsed = lex(data, LexerBackend::Pegtl);
+    EXPECT_EQ(parsed, scanned) << "input: `" << data << "`";
+}
+
+static const char* module = R"(module test
+
+import core::{Option, Result}
+
+/// Doc comment
+struct Point<T> {
+    x: T,
+    y: &mut [T; 16],
+    z: *const &[u8; 4],
+}
+
+enum Kind {
+    A = 1,
+    B = -2,
+}
+
+variant Value {
+    None,
+    Some(u64),
+    Pair { a: i8, b: Fn(u8) -> bool },
+}
+
+type Alias = Point<u16>;
+
+component test {
+    parameters {
+        value: u32,
+    }
+
+    variables {
+        points: &[Point<u8>; 8],
+    }
+
+    statuses {
+        [0, 1, true]: {points[..].x, value},
+        [1, 2, false]: {points[1..4]},
+    }
+
+    events {
+        event1 {
+            a: u8,
+        }
+    }
+
+    commands {
+        fn reset(self, num: u64) -> Option<u8>
+    }
+
+    autosave {
+        value,
+    }
+}
+
+impl Point {
+    fn get(&self) -> &T
+}
+
+const MAX: u8 = 255;
+#[cmd_call(test)]
+)";
+
+TEST(Lexer, sameTokensForModule)
+{
+    expectSameTokens(module);
+}
+
+TEST(Lexer, sameTokensForLargeInput)
+{
+    // exceeds scanner chunk size many times
+    std::string data;
+    for (int i = 0; i < 100; i++) {
+        data.append(module);
+    }
+    expectSameTokens(data);
+}
+
+TEST(Lexer, sameTokensForComments)
+{
+    expectSameTokens("/// doc\n");
+    expectSameTokens("/// doc at end");
+    expectSameTokens("///");
+    expectSameTokens("////\n////\n");
+    expectSameTokens("/// doc\r\nstruct A {}\r\n");
+    expectSameTokens("/// \t\xd0\xb4\xd0\xbe\xd0\xba \xff\n");
+    expectSameTokens("// not a doc comment\n");
+    expectSameTokens("/ // /// ////");
+    expectSameTokens("a /// b\nc");
+}
+
+TEST(Lexer, sameTokensForPunctuation)
+{
+    expectSameTokens("a->b - > c -- -> ->>-");
+    expectSameTokens(". .. ... ....");
+    expectSameTokens(": :: ::: ::::");
+    expectSameTokens("&*#=!/<>,;[]{}()");
+    expectSameTokens("-");
+    expectSameTokens(":");
+    expectSameTokens(".");
+}
+
+TEST(Lexer, sameTokensForKeywordPrefixes)
+{
+    expectSameTokens("module modules module_ modulE mod");
+    expectSameTokens("fn Fn fN FN fn_ Fn1");
+    expectSameTokens("self self_ selfish Self");
+    expectSameTokens("true true1 false_ falsey");
+    expectSameTokens("type types impl impls const constant mut muts");
+    expectSameTokens("struct enum variant component variables statuses events commands parameters autosave import");
+    expectSameTokens("_ __ _1 a_b_c ABC");
+}
+
+TEST(Lexer, sameTokensForNumbersAndInvalidInput)
+{
+    expectSameTokens("0 0123 12ab 1.5");
+    expectSameTokens("a @ b");
+    expectSameTokens("ident\xd0\xb0");
+    expectSameTokens("\xff");
+    expectSameTokens("\"string with \\\"escapes\\\"\\n\"");
+    expectSameTokens("'c'");
+    expectSameTokens(std::string("a\0b", 3));
+    expectSameTokens("\r");
+    expectSameTokens("a\rb");
+}
+
+TEST(Lexer, sameTokensForEmptyAndBlankInput)
+{
+    expectSameTokens("");
+    expectSameTokens(" ");
+    expectSameTokens("\n");
+    expectSameTokens("\r\n");
+    expectSameTokens("\t \t\n\n \r\n");
+}
+
+TEST(Lexer, sameTokensForRunsAtBufferTail)
+{
+    // blank and identifier runs are classified 16 bytes at a time, tails of every length are checked
+    for (std::size_t prefix = 0; prefix < 17; prefix++) {
+        for (std::size_t size = 1; size < 50; size++) {
+            std::string pad(prefix, ' ');
+            expectSameTokens(pad + std::string(size, 'a'));
+            expectSameTokens(pad + std::string(size, ' '));
+            expectSameTokens(pad + std::string(size, '\t') + "x");
+            expectSameTokens(pad + "_" + std::string(size, '9'));
+            expectSameTokens(pad + std::string(size, 'z') + ":");
+            expectSameTokens(pad + std::string(size, 'b') + "\xd0\xb0");
+            expectSameTokens(pad + "/// " + std::string(size, 'c'));
+        }
+    }
+}